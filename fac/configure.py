@@ -12,32 +12,55 @@ with open('testing-flags/test.c', 'w') as f:
   return 0;
 }
 """)
+# Setting DEFT_MPI=1 in the environment builds with mpicxx, so that a
+# grid can be split among MPI ranks (see src/new/Distributed.h).  This
+# needs fftw's MPI library.
+cxx = 'g++'
+if os.environ.get('DEFT_MPI', '') not in ['', '0']:
+    cxx = 'mpicxx'
 flags = ''
 flags_for_eigen = ['-fpermissive']
 # I also added a misspelling on Werror below to make things keep
 # working with Eigen.  I really want to eliminate Eigen from the
 # build!
 for flag in ['-Wall', '-O3', '-std=c++11', '-Isrc', '-Iinclude', '-g',
-             '-mtune=native', '-flto'] + flags_for_eigen:
-    if not os.system('cd testing-flags && g++ %s %s -c test.c' %
-                     (flags, flag)):
+             '-mtune=native', '-flto', '-fopenmp'] + flags_for_eigen:
+    if not os.system('cd testing-flags && %s %s %s -c test.c' %
+                     (cxx, flags, flag)):
         flags += ' ' + flag
     else:
         print('# g++ cannot use flag:', flag)
 if len(flags) > 0:
     flags = flags[1:]
 linkflags = ''
-for flag in ['-lpopt', '-lprofiler', '-g', '-lfftw3', '-flto']:
-    if not os.system('cd testing-flags && g++ %s %s -o test test.c' %
-                     (flags, flag)):
+mpiflags = ['-lfftw3_mpi'] if cxx == 'mpicxx' else []
+for flag in ['-lpopt', '-lprofiler', '-g'] + mpiflags + ['-lfftw3_threads', '-lfftw3',
+             '-lfftw3f_threads', '-lfftw3f', '-lpthread',
+             '-flto', '-fopenmp']:
+    if not os.system('cd testing-flags && %s %s %s -o test test.c' %
+                     (cxx, flags, flag)):
         linkflags += ' ' + flag
     else:
         print('# g++ linking cannot use flag:', flag)
 if len(linkflags) > 0:
     linkflags = linkflags[1:]
+libs = linkflags.split()
+if '-lfftw3f' in libs:
+    flags += ' -DDEFT_FFT_SINGLE'
+else:
+    print('# ffts will all be double precision, since we cannot link with -lfftw3f')
+if '-lfftw3_threads' in libs and ('-lfftw3f' not in libs or '-lfftw3f_threads' in libs):
+    flags += ' -DDEFT_FFT_THREADS'
+else:
+    print('# ffts will be single-threaded, since we cannot link with the fftw threads libraries')
+if cxx == 'mpicxx':
+    if '-lfftw3_mpi' in linkflags:
+        flags += ' -DDEFT_MPI'
+    else:
+        print('# cannot build with MPI, since we cannot link with -lfftw3_mpi')
 os.system('rm -rf testing-flags')
 
 print('# This module is autogenerated.  Edit configure.py if you want to change it.')
-print('cxx=', repr('g++')) # in future, we should set this dynamically
+print('cxx=', repr(cxx))
 print('cxxflags=', repr(flags))
 print('linkflags=', repr(linkflags))
@@ -7,7 +7,7 @@ src = facfile.facfile('.dft.fac')
 
 generic_sources = """
   lattice utilities Faddeeva
-  GridDescription Grid ReciprocalGrid
+  FFTPlanCache KernelCache ConvolutionMemo CoordinateCache FieldFile GridDescription Grid ReciprocalGrid
   IdealGas ChemicalPotential
   HardSpheres ExternalPotential
   Functional ContactDensity
@@ -30,6 +30,7 @@ generated_names = """
   SFMTFluid SFMTFluidVeff
   SPhi1 SPhi2 SPhi3
   SW_liquid SW_liquidVeff HomogeneousSW_liquid
+  WhiteBearFluidVeffPlanar SFMTFluidVeffPlanar SW_liquidVeffPlanar
   WaterSaftByHand WaterSaft WhiteBearFluid WhiteBear
 """.split()
 
@@ -43,7 +44,7 @@ old_generated = """
 """.split()
 
 slow_to_compile = """
-  SW_liquid SW_liquidVeff
+  SW_liquid SW_liquidVeff SW_liquidVeffPlanar
 """.split()
 
 imports = {}
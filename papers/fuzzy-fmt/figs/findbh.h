@@ -34,8 +34,11 @@ static inline HomogeneousWhiteBearFluid bh_homogeneous(double n, double T) {
   return hf;
 }
 
-static inline WhiteBearFluidVeff bh_inhomogeneous(double T, double Lx, double Ly, double Lz, double dx) {
-  WhiteBearFluidVeff f(Lx, Ly, Lz, dx);
+// bh_inhomogeneous creates either a WhiteBearFluidVeff or (for systems
+// that only vary in z) a WhiteBearFluidVeffPlanar.
+template <typename Functional>
+static inline Functional bh_inhomogeneous(double T, double Lx, double Ly, double Lz, double dx) {
+  Functional f(Lx, Ly, Lz, dx);
   f.R() = R_BH(T);
   f.kT() = T;
   f.mu() = 0;
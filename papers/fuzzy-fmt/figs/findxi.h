@@ -92,8 +92,11 @@ static inline HomogeneousSFMTFluid sfmt_homogeneous(double n, double T) {
 
 
 
-static inline SFMTFluidVeff sfmt_inhomogeneous(double T, double Lx, double Ly, double Lz, double dx) {
-  SFMTFluidVeff hf(Lx, Ly, Lz, dx);
+// sfmt_inhomogeneous creates either an SFMTFluidVeff or (for systems
+// that only vary in z) an SFMTFluidVeffPlanar.
+template <typename Functional>
+static inline Functional sfmt_inhomogeneous(double T, double Lx, double Ly, double Lz, double dx) {
+  Functional hf(Lx, Ly, Lz, dx);
   hf.Xi() = find_Xi(T);
   hf.sigma() = sigma;
   hf.epsilon() = epsilon;   //energy constant in the WCA fluid
@@ -18,17 +18,17 @@
 #include <stdlib.h>
 #include <time.h>
 #include <sys/stat.h>
-#include "new/WhiteBearFluidFast.h"
-#include "new/WhiteBearFluidVeffFast.h"
+#include "new/RadialWhiteBearFluid.h"
 #include "new/HomogeneousWhiteBearFluidFast.h"
 #include "new/Minimize.h"
 #include "version-identifier.h"
 
-// Here we set up the lattice.
-double zmax = 16;
-double ymax = zmax;
-double xmax = zmax;
-double dx = 0.05;
+// Here we set up the radial grid, which reaches out to rmax.  Since
+// the fluid is spherically symmetric about the solute, we only need a
+// one-dimensional grid, so we can afford a far finer dx than a 3D
+// grid would allow.
+double rmax = 16;
+double dx = 0.005;
 const double epsilon = 1.0;
 const double radius = 1.0;
 const double R = 2*radius;
@@ -57,7 +57,7 @@ double R_BH(const double kT) {
   return bh_diameter/2;
 }
 
-void run_minimization(double reduced_density,WhiteBearFluidVeff *f, double kT) {
+void run_minimization(double reduced_density, RadialWhiteBearFluid *f, double kT) {
   Minimize min(f);
   min.set_relative_precision(0);
   min.set_maxiter(1000);
@@ -76,11 +76,10 @@ void run_minimization(double reduced_density,WhiteBearFluidVeff *f, double kT) {
 
     took("Doing the minimization step");
 
-    const int Nz = f->Nz();
+    const int Nr = f->Nr();
     Vector Vext = f->Vext();
     Vector r = f->get_r();
     Vector n = f->get_n();
-    f->get_Fideal(); // FIXME this is a hokey trick to make dV be defined
     Vector n3 = f->get_n3();
 
     FILE *o = fopen(fname, "w");
@@ -88,7 +87,7 @@ void run_minimization(double reduced_density,WhiteBearFluidVeff *f, double kT) {
       fprintf(stderr, "error creating file %s\n", fname);
       exit(1);
     }
-    for (int i=0; i<Nz/2; i++) {
+    for (int i=0; i<Nr; i++) {
       fprintf(o, "%g\t%g\t%g\t%g\n", r[i]/sigma, n[i]*uipow(sigma, 3), Vext[i], n3[i]);
     }
     fclose(o);
@@ -135,9 +134,9 @@ int main(int argc, char **argv) {
   hf.mu() = 0;
   hf.mu() = hf.d_by_dn(); // set mu based on derivative of hf
   printf("bulk energy is %g\n", hf.energy());
-  printf("cell energy should be %g\n", hf.energy()*dx*dx*dx);
+  printf("cell energy should be %g\n", hf.energy()*4*M_PI/3*rmax*rmax*rmax);
 
-  WhiteBearFluidVeff f(xmax, ymax, zmax, dx);
+  RadialWhiteBearFluid f(long(rmax/dx), dx);
   f.R() = hf.R();
   f.kT() = hf.kT();
   f.mu() = hf.mu();
@@ -145,7 +144,7 @@ int main(int argc, char **argv) {
   f.Veff() = -temp*log(hf.n());
 
   {
-    const int Ntot = f.Nx()*f.Ny()*f.Nz();
+    const int Ntot = f.Nr();
     const Vector r = f.get_r();
     for (int i=0; i<Ntot; i++) {
       const double Vmax = 100*temp;
@@ -18,7 +18,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <sys/stat.h>
-#include "new/WhiteBearFluidVeffFast.h"
+#include "new/WhiteBearFluidVeffPlanarFast.h"
 #include "new/HomogeneousWhiteBearFluidFast.h"
 #include "new/Minimize.h"
 
@@ -45,7 +45,7 @@ static void took(const char *name) {
   last_time = t;
 }
 
-void run_walls(double reduced_density, WhiteBearFluidVeff *f, double kT) {
+void run_walls(double reduced_density, WhiteBearFluidVeffPlanar *f, double kT) {
   Minimize min(f);
   min.set_relative_precision(0);
   min.set_maxiter(10000);
@@ -113,7 +113,7 @@ int main(int argc, char **argv) {
   printf("cell energy should be %g\n", hf.energy()*dw*dw*width);
   hf.printme("homogeneous");
 
-  WhiteBearFluidVeff f = bh_inhomogeneous(temp, dw, dw, width, dx);
+  WhiteBearFluidVeffPlanar f = bh_inhomogeneous<WhiteBearFluidVeffPlanar>(temp, dw, dw, width, dx);
   f.mu() = hf.mu();
   f.Vext() = 0;
 
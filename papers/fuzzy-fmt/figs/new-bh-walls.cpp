@@ -18,16 +18,17 @@
 #include <stdlib.h>
 #include <time.h>
 #include <sys/stat.h>
-#include "new/WhiteBearFluidFast.h"
-#include "new/WhiteBearFluidVeffFast.h"
+#include "new/WallsWhiteBearFluid.h"
 #include "new/HomogeneousWhiteBearFluidFast.h"
 #include "new/Minimize.h"
 
-// Here we set up the lattice.
+// Here we set up the lattice.  We have a slit of the given width
+// between two walls, but since the walls of WallsWhiteBearFluid are
+// mirror planes, we need only the half of it from the wall at z = 0 to
+// the midplane of the slit, with no space for the walls themselves.
 static double width = 30;
 const double dx = 0.01;
 const double dw = 0.01;
-const double spacing = 3.0; // space on each side
 const int N = 1000000;
 
 double rad = 0;
@@ -55,7 +56,7 @@ double R_BH(const double kT) {
   return bh_diameter/2;
 }
 
-void run_walls(double reduced_density, WhiteBearFluidVeff *f, double kT) {
+void run_walls(double reduced_density, WallsWhiteBearFluid *f, double kT) {
   Minimize min(f);
   min.set_relative_precision(0);
   min.set_maxiter(100);
@@ -81,11 +82,12 @@ void run_walls(double reduced_density, WhiteBearFluidVeff *f, double kT) {
   }
   delete[] fname;
   const int Nz = f->Nz();
-  Vector rz = f->get_rz();
+  Vector z = f->get_z();
   Vector n = f->get_n();
   printf("multiplying by sigma = %g\n", sigma);
-  for (int i=0; i<Nz/2; i++) {
-    fprintf(o, "%g\t%g\n", (rz[i] - spacing)/sigma, n[i]*uipow(sigma, 3));
+  for (int i=0; i<Nz; i++) {
+    // The spheres can come no closer than rad to the wall.
+    fprintf(o, "%g\t%g\n", (z[i] - rad)/sigma, n[i]*uipow(sigma, 3));
   }
   fclose(o);
 }
@@ -122,9 +124,9 @@ int main(int argc, char **argv) {
   hf.mu() = 0;
   hf.mu() = hf.d_by_dn(); // set mu based on derivative of hf
   printf("bulk energy is %g\n", hf.energy());
-  printf("cell energy should be %g\n", hf.energy()*dw*dw*width);
+  printf("cell energy should be %g\n", hf.energy()*dw*dw*width/2);
 
-  WhiteBearFluidVeff f(dw, dw, width + spacing, dx);
+  WallsWhiteBearFluid f(dw, dw, width/2, dx);
   f.R() = hf.R();
   f.kT() = hf.kT();
   f.mu() = hf.mu();
@@ -132,10 +134,9 @@ int main(int argc, char **argv) {
   f.Veff() = -temp*log(hf.n());
 
   {
-    const int Ntot = f.Nx()*f.Ny()*f.Nz();
-    const Vector rz = f.get_rz();
-    for (int i=0; i<Ntot; i++) {
-      if (fabs(rz[i]) < spacing) {
+    const Vector z = f.get_z();
+    for (int i=0; i<f.Nz(); i++) {
+      if (z[i] < rad) {
         const double Vmax = 500*temp;
         f.Vext()[i] = Vmax; // this is "infinity" for our wall
         f.Veff()[i] = Vmax;
@@ -147,7 +148,7 @@ int main(int argc, char **argv) {
   for (double rd = 0.50; rd < 0.63; rd += 0.01) {
     hf.n() = rd/uipow(sigma,3);
     f.Veff() = -temp*log(hf.n());
-    printf("  %g\t%g\t%g\n", rd, f.energy(), hf.energy()*dw*dw*width);
+    printf("  %g\t%g\t%g\n", rd, f.energy(), hf.energy()*dw*dw*width/2);
   }
 
   printf("my energy is %g\n", f.energy());
@@ -22,6 +22,7 @@
 #include "new/SFMTFluidVeffFast.h"
 #include "new/HomogeneousSFMTFluidFast.h"
 #include "new/Minimize.h"
+#include "new/CubicSymmetry.h"
 #include "version-identifier.h"
 #include "vector3d.h"
 
@@ -214,33 +215,33 @@ weight find_weighted_den_aboutR_guasquad(vector3d r, vector3d R, double dx, doub
 
 weight find_weighted_den_aboutR_mc(vector3d r, vector3d R, double dx, double temp,  //dx is not used but keeping format
                                    double lattice_constant,
-                                   double gwidth, double fv) {
+                                   double gwidth, double fv, long num_points) {
   weight w_den_R = {0,0,0,0,vector3d(0,0,0), vector3d(0,0,0), zero_tensor()};
   if ((r-R).norm() > radius_of_peak(gwidth, temp)) {
     return w_den_R;
   }
 
-  for (long i=0; i<NUM_POINTS; i++) {
+  for (long i=0; i<num_points; i++) {
     vector3d dr = vector3d::ran(gwidth);  //A vector is randomly selected from a Gaussian distribution of width gwidth
     vector3d r_prime = R + dr;
     vector3d r_prime2 = R - dr; // using an "antithetic variate" to cancel out first-order error
     weight w = find_weights(r, r_prime, temp);
     weight w2 = find_weights(r, r_prime2, temp);
 
-    w_den_R.n_0 += (0.5/NUM_POINTS)*(1-fv)*(w.n_0 + w2.n_0);
-    w_den_R.n_1 += (0.5/NUM_POINTS)*(1-fv)*(w.n_1 + w2.n_1);
-    w_den_R.n_2 += (0.5/NUM_POINTS)*(1-fv)*(w.n_2 + w2.n_2);
-    w_den_R.n_3 += (0.5/NUM_POINTS)*(1-fv)*(w.n_3 + w2.n_3);
+    w_den_R.n_0 += (0.5/num_points)*(1-fv)*(w.n_0 + w2.n_0);
+    w_den_R.n_1 += (0.5/num_points)*(1-fv)*(w.n_1 + w2.n_1);
+    w_den_R.n_2 += (0.5/num_points)*(1-fv)*(w.n_2 + w2.n_2);
+    w_den_R.n_3 += (0.5/num_points)*(1-fv)*(w.n_3 + w2.n_3);
 
-    w_den_R.nv_1 += (0.5/NUM_POINTS)*(1-fv)*(w.nv_1 + w2.nv_1);
-    w_den_R.nv_2 += (0.5/NUM_POINTS)*(1-fv)*(w.nv_2 + w2.nv_2);
-    w_den_R.nm_2 += (0.5/NUM_POINTS)*(1-fv)*(w.nm_2 + w2.nm_2);
+    w_den_R.nv_1 += (0.5/num_points)*(1-fv)*(w.nv_1 + w2.nv_1);
+    w_den_R.nv_2 += (0.5/num_points)*(1-fv)*(w.nv_2 + w2.nv_2);
+    w_den_R.nm_2 += (0.5/num_points)*(1-fv)*(w.nm_2 + w2.nm_2);
   }
   return w_den_R;
 }
 
 weight find_weighted_den_aboutR_mc_accurately(vector3d r, vector3d R,
-    double gwidth, double fv, double alpha, double Xi) {
+    double gwidth, double fv, double alpha, double Xi, double max_error) {
   weight n = {0,0,0,0,vector3d(0,0,0), vector3d(0,0,0), zero_tensor()};
   double n3_sqr = 0;
 
@@ -276,7 +277,7 @@ weight find_weighted_den_aboutR_mc_accurately(vector3d r, vector3d R,
     // pretty easy to reason about, and the others are closely
     // related.
     n3_error = sqrt(fabs(n3_sqr/num_points - sqr(n.n_3/num_points))/(num_points-1));  //Standard Error of the Mean (SEM)
-  } while (n3_error > MC_ERROR);
+  } while (n3_error > max_error);
   //} while (n3_error > MC_ERROR || (n3_error > 0.25*fabs(1-n.n_3/num_points) && n3_error < 1e-15));
   //avoids downward spiral n3_error > ... so n3_error becomes smaller which makes ... smaller and so n3_error is still bigger etc...
   n.n_0 /= num_points;
@@ -384,7 +385,7 @@ long report_total_num_points(vector3d r, vector3d R,   //Temporary- FOR DEBUG ON
 
 ///////////////////////////EXPERIMENT!!!///////////////////////////////
 weight find_weighted_den_aboutR_mc_accurately_experiment(vector3d r, vector3d R,
-    double gwidth, double fv, double alpha, double Xi) {
+    double gwidth, double fv, double alpha, double Xi, double max_error) {
   weight w_den_R = {0,0,0,0,vector3d(0,0,0), vector3d(0,0,0), zero_tensor()};
   printf("SIZE of Gaussian is 3*gwidth=%g\n", 3*gwidth);
   printf("SIZE of weight function is 2*Xi*sqrt(1/2) + alpha/2=%g\n", 2*Xi*sqrt(1/2) + alpha/2);
@@ -450,7 +451,7 @@ weight find_weighted_den_aboutR_mc_accurately_experiment(vector3d r, vector3d R,
     // pretty easy to reason about, and the others are closely
     // related.
     n3_error = sqrt(fabs(n3_sqr/num_points - sqr(w_den_R.n_3/num_points))/num_points);  //Standard Error of the Mean (SEM)
-  } while (n3_error > MC_ERROR || (n3_error > 0.25*fabs(1-w_den_R.n_3/num_points) && n3_error < 1e-15));
+  } while (n3_error > max_error || (n3_error > 0.25*fabs(1-w_den_R.n_3/num_points) && n3_error < 1e-15));
   num_zeroterms=vec_count*(3*gwidth/(2*Xi*sqrt(1/2) + alpha/2))*(3*gwidth/(2*Xi*sqrt(1/2) + alpha/2))*(3*gwidth/(2*Xi*sqrt(1/2) + alpha/2));
   w_den_R.n_0 /= num_points + num_zeroterms;    //Added terms where weight function is zero but the Gaussian is not!
   w_den_R.n_1 /= num_points + num_zeroterms;    //Added terms where weight function is zero but the Gaussian is not!
@@ -568,30 +569,32 @@ data find_energy_new(double temp, double reduced_density, double fv, double gwid
              cFideal_of_primitive_cell/primitive_cell_volume);
     } else {
 
-      for (int i=0; i<Nl; i++) {  //integrate over one primitive cell
-        for (int j=0; j<Nl; j++) {
-          for (int k=0; k<Nl; k++) {
-            vector3d r=i*da1 + j*da2 + k*da3;
-
-            const int many_cells=2 + 6*gwidth*sqrt(2)/lattice_constant; // how many cells to sum over
-            //Gaussians father away won't contriubute much
-            double n = 0;
-            const double kT = temp;
-            for (int t=-many_cells; t <=many_cells; t++) {
-              for(int u=-many_cells; u<=many_cells; u++)  {
-                for (int v=-many_cells; v<= many_cells; v++) {
-                  const vector3d R = t*lattice_vectors[0] + u*lattice_vectors[1] + v*lattice_vectors[2];
-                  double deltar = (r-R).norm();
-                  n += (1-fv)*exp(-deltar*deltar*(0.5/(gwidth*gwidth)))/uipow(sqrt(2*M_PI)*gwidth,3);
-                }
-              }
-            }
-            if (n > 1e-200) { // Only use n values that are large enough - avoid underflow and n=0 issues ln(0)=ERROR
-              // printf("n = %g  dF = %g\n", n, dF);
-              cFideal_of_primitive_cell += kT*n*(log(n*2.646476976618268e-6/(sqrt(kT)*kT)) - 1.0)*dV;
+      // The density has the cubic symmetry of the crystal, so we need
+      // only integrate over the irreducible wedge of the cell.
+      const CubicSymmetry symmetry(Nl, CubicSymmetry::fcc_primitive_cell);
+      for (long w=0; w<symmetry.irreducible_size(); w++) {
+        const long ijk = symmetry.irreducible(w);
+        const int i = ijk/(Nl*Nl), j = (ijk/Nl) % Nl, k = ijk % Nl;
+        vector3d r=i*da1 + j*da2 + k*da3;
+        const double dVw = symmetry.multiplicity(w)*dV; // the volume this point stands for
+
+        const int many_cells=2 + 6*gwidth*sqrt(2)/lattice_constant; // how many cells to sum over
+        //Gaussians father away won't contriubute much
+        double n = 0;
+        const double kT = temp;
+        for (int t=-many_cells; t <=many_cells; t++) {
+          for(int u=-many_cells; u<=many_cells; u++)  {
+            for (int v=-many_cells; v<= many_cells; v++) {
+              const vector3d R = t*lattice_vectors[0] + u*lattice_vectors[1] + v*lattice_vectors[2];
+              double deltar = (r-R).norm();
+              n += (1-fv)*exp(-deltar*deltar*(0.5/(gwidth*gwidth)))/uipow(sqrt(2*M_PI)*gwidth,3);
             }
           }
         }
+        if (n > 1e-200) { // Only use n values that are large enough - avoid underflow and n=0 issues ln(0)=ERROR
+          // printf("n = %g  dF = %g\n", n, dF);
+          cFideal_of_primitive_cell += kT*n*(log(n*2.646476976618268e-6/(sqrt(kT)*kT)) - 1.0)*dVw;
+        }
       }  //End inhomogeneous Fideal calculation
       printf("crystal ideal gas free energy per volume = %.12g\n",
              cFideal_of_primitive_cell/primitive_cell_volume);
@@ -641,159 +644,154 @@ data find_energy_new(double temp, double reduced_density, double fv, double gwid
   const double Xi = find_Xi(temp);
 
   double mean_n0 = 0, mean_n1 = 0, mean_n2 = 0, mean_n3 = 0;
-  for (int i=0; i<Nl; i++) {
-    for (int j=0; j<Nl; j++) {
-      for (int k=0; k<Nl; k++) {
-        vector3d r= i*da1 + j*da2 + k*da3;
-
-        double n_0=0, n_1=0, n_2=0, n_3=0;  //weighted densities  (fundamental measures)
-        vector3d nv_1, nv_2;
-        tensor3d nm_2;
-        weight n_weight;
-
-        for (int t=-many_cells; t <=many_cells; t++) {
-          for(int u=-many_cells; u<=many_cells; u++)  {
-            for (int v=-many_cells; v<= many_cells; v++) {
-              const vector3d R = t*lattice_vectors[0] + u*lattice_vectors[1] + v*lattice_vectors[2];
-              if ((R-r).norm() < max_distance_considered) {
-                if (MC_ERROR == 0) {
-                  n_weight=find_weighted_den_aboutR_mc(r, R, dx, temp,
-                                                       lattice_constant, gwidth, fv);
-                } else {
-                  if (my_experiment > 0) {
-                    n_weight=find_weighted_den_aboutR_mc_accurately_experiment(r, R, gwidth, fv, alpha, Xi);
-                  } else {
-                    n_weight=find_weighted_den_aboutR_mc_accurately(r, R, gwidth, fv, alpha, Xi);
-                  }
-                  //double n3_error=report_my_error(r, R, gwidth, fv, alpha, Xi);  //FOR DEBUG - delete!
-                  //printf(">>>>n3_error=%g\n",n3_error);   //FOR DEBUG - delete!
-                  //long total_num_points=report_total_num_points(r, R, gwidth, fv, alpha, Xi);  //FOR DEBUG - delete!
-                  //printf(">>>>total_num_points=%ld\n", total_num_points);   //FOR DEBUG - delete!
-                }
-
-                n_0 +=n_weight.n_0;
-                n_1 +=n_weight.n_1;
-                n_2 +=n_weight.n_2;
-                n_3 +=n_weight.n_3;
-
-                nv_1 +=n_weight.nv_1;
-                nv_2 +=n_weight.nv_2;
-                nm_2 += n_weight.nm_2;
+  const CubicSymmetry symmetry(Nl, CubicSymmetry::fcc_primitive_cell);
+  for (long w=0; w<symmetry.irreducible_size(); w++) {  // integrate over the irreducible wedge
+    const long ijk = symmetry.irreducible(w);
+    const int i = ijk/(Nl*Nl), j = (ijk/Nl) % Nl, k = ijk % Nl;
+    vector3d r= i*da1 + j*da2 + k*da3;
+    const double dVw = symmetry.multiplicity(w)*dV; // the volume this point stands for
+    // Our Monte-Carlo error at this point is counted multiplicity times
+    // over, where on the full grid the independent errors of each
+    // point would partly cancel, so we need multiplicity times as many
+    // samples (or an error smaller by its square root) to be as
+    // accurate as the full grid.
+    const long num_points = NUM_POINTS*symmetry.multiplicity(w);
+    const double max_error = MC_ERROR/sqrt(symmetry.multiplicity(w));
+
+    double n_0=0, n_1=0, n_2=0, n_3=0;  //weighted densities  (fundamental measures)
+    vector3d nv_1, nv_2;
+    tensor3d nm_2;
+    weight n_weight;
+
+    for (int t=-many_cells; t <=many_cells; t++) {
+      for(int u=-many_cells; u<=many_cells; u++)  {
+        for (int v=-many_cells; v<= many_cells; v++) {
+          const vector3d R = t*lattice_vectors[0] + u*lattice_vectors[1] + v*lattice_vectors[2];
+          if ((R-r).norm() < max_distance_considered) {
+            if (MC_ERROR == 0) {
+              n_weight=find_weighted_den_aboutR_mc(r, R, dx, temp,
+                                                   lattice_constant, gwidth, fv, num_points);
+            } else {
+              if (my_experiment > 0) {
+                n_weight=find_weighted_den_aboutR_mc_accurately_experiment(r, R, gwidth, fv, alpha, Xi, max_error);
+              } else {
+                n_weight=find_weighted_den_aboutR_mc_accurately(r, R, gwidth, fv, alpha, Xi, max_error);
               }
+              //double n3_error=report_my_error(r, R, gwidth, fv, alpha, Xi);  //FOR DEBUG - delete!
+              //printf(">>>>n3_error=%g\n",n3_error);   //FOR DEBUG - delete!
+              //long total_num_points=report_total_num_points(r, R, gwidth, fv, alpha, Xi);  //FOR DEBUG - delete!
+              //printf(">>>>total_num_points=%ld\n", total_num_points);   //FOR DEBUG - delete!
             }
-          }
-        }
 
-        double phi_1 = -n_0*1.0*log(1.0-1.0*n_3);
-        double phi_2 = (n_1*n_2 - nv_1.dot(nv_2))/(1-n_3);
-        double phi_3;
-        if (use_tensor_weight) {
-          //double traceof_nm_2squared =  nm_2.x.x*nm_2.x.x +
-                                        //nm_2.y.y*nm_2.y.y +
-                                        //nm_2.z.z*nm_2.z.z +
-                                      //2*nm_2.x.y*nm_2.y.x +
-                                      //2*nm_2.x.z*nm_2.z.x +
-                                      //2*nm_2.y.z*nm_2.z.y;
-
-          double traceof_nm_2cubed =
-            nm_2.x.x*nm_2.x.x*nm_2.x.x +   // xx xx xx
-            nm_2.y.y*nm_2.y.y*nm_2.y.y +   // yy yy yy
-            nm_2.z.z*nm_2.z.z*nm_2.z.z +   // zz zz zz
-            3*nm_2.x.x*nm_2.x.y*nm_2.y.x + // xx xy yx three places to put xx
-            3*nm_2.x.x*nm_2.x.z*nm_2.z.x + // xx xz zx three places to put xx
-            3*nm_2.x.y*nm_2.y.y*nm_2.y.x + // xy yy yx three places to put yy
-            3*nm_2.y.y*nm_2.y.z*nm_2.z.y + // yy yz zy three places to put yy
-            3*nm_2.x.z*nm_2.z.z*nm_2.z.x + // xz zz zx three places to put zz
-            3*nm_2.y.z*nm_2.z.z*nm_2.z.y + // yz zz zy three places to put zz
-            3*nm_2.x.y*nm_2.y.z*nm_2.z.x + // xy yz zx three cyclic permutations
-            3*nm_2.x.z*nm_2.z.y*nm_2.y.x;  // xz zy yx == the above, but these are the non-cyclic permutations
-
-          //phi_3 = (uipow(n_2,3) - 3.0*n_2*nv_2.dot(nv_2) + (9/2.0)*(nv_2.dot(nm_2.dot(nv_2))-3.0*nm_2.determinant()))/(24*M_PI*uipow(1.0-1.0*n_3,2));        // Schmidt equation 5  (2000) - ok
-          phi_3 =( n_2*(uipow(n_2,2) - 3.0*nv_2.dot(nv_2)) + (9/2.0)*(nv_2.dot(nm_2.dot(nv_2)) - traceof_nm_2cubed))
-            /(24*M_PI*uipow(1-n_3,2));         // Santos (2012) - yes
-          //phi_3 = (nv_2.dot(nm_2.dot(nv_2))-n_2*nv_2.dot(nv_2) - traceof_nm_2cubed + n_2*traceof_nm_2squared)/((16/3.0)*M_PI*uipow(1.0-1.0*n_3,2));      // Sweatman, Groh & Schmidt  (2001) - same as Santos with different w_nm
-        } else {
-          // The following was Rosenfelds early vector version of the functional
-          //double phi_3 = (uipow(n_2,3) - 3*n_2*nv_2.normsquared())/(24*M_PI*uipow(1-n_3,2));
-          // This is the fixed version, which comes from dimensional crossover
-          phi_3 = uipow(n_2,3)*uipow(1.0 - nv_2.normsquared()/sqr(n_2),3)/(24*M_PI*sqr(1-n_3));
-        }
-        if (n_2 == 0 || sqr(n_2) <= nv_2.normsquared()) phi_3 = 0;
-        if (n_0 < 1e-5*reduced_density && n_3 >= 1 && n_3 < 1 + 1e-14) {
-          // This is a case where the prefactor on each of our free
-          // energy contributions is within roundoff error of zero.
-          // Sadly, n_3 may be greater than 1, in which case we would
-          // get a NaN when the true contribution to the free energy
-          // is probably actually zero.
-          phi_1 = 0;
-          phi_2 = 0;
-          phi_3 = 0;
-        }
+            n_0 +=n_weight.n_0;
+            n_1 +=n_weight.n_1;
+            n_2 +=n_weight.n_2;
+            n_3 +=n_weight.n_3;
 
-        mean_n0 += n_0*dV;
-        mean_n1 += n_1*dV;
-        mean_n2 += n_2*dV;
-        mean_n3 += n_3*dV;
-        total_phi_1 += temp*phi_1*dV;
-        total_phi_2 += temp*phi_2*dV;
-        total_phi_3 += temp*phi_3*dV;
-        cFexcess_of_primitive_cell += temp*(phi_1 + phi_2 + phi_3)*dV;  //NOTE: temp is Bolatzman constant times temperature divided by epsilon (which is 1)
-        if (isnan(cFexcess_of_primitive_cell)) {                        // temp is a reduced temperature given by t* in the paper
-          printf("free energy is a NaN!\n");
-          printf("position is: %g %g %g\n", r.x, r.y, r.z);
-          printf("n0 = %g\nn1 = %g\nn2=%g\nn3=%.17g = 1+%g\n", n_0, n_1, n_2, n_3, n_3-1);
-          printf("phi1 = %g\nphi2 = %g\n\n#phi3=%g\n", phi_1, phi_2, phi_3);
-          printf("             #NAN!\n"); //
-          if (free_energy_output_file) {
-            FILE *f = fopen(free_energy_output_file, "a");
-            fprintf(f, "\n# git  version: %s\n", version_identifier());
-            fprintf(f, "#dx\tmc-error\tphi1\tphi2\tphi3\tFtot\tFideal\t\t\tFEdiff\t\tmean_n3\t\t\trelerr\t\t\tmc_con\tmc_pf\tgw\t\tfv\tkT\tn\tseed\tmin\n");
-            fprintf(f, "%g\t%g\t\t%g\t%g\t%g\t%g\t%g\t\t%g\t\t%g\t\t%g\t\t%ld\t%ld\t%g\t%g\t%g\t%g\t%g\t%g\n",
-                    dx_input,
-                    MC_ERROR,
-                    total_phi_1/primitive_cell_volume,
-                    total_phi_2/primitive_cell_volume,
-                    total_phi_3/primitive_cell_volume,
-                    cfree_energy_per_vol,
-                    cFideal_of_primitive_cell/primitive_cell_volume,
-                    total_phi_1+total_phi_2+total_phi_3,
-                    mean_n3,
-                    0.0,
-                    mc_constant,
-                    mc_prefactor,
-                    gwidth,
-                    fv,
-                    temp,
-                    reduced_density,
-                    seed,
-                    0.0);
-            fclose(f);
+            nv_1 +=n_weight.nv_1;
+            nv_2 +=n_weight.nv_2;
+            nm_2 += n_weight.nm_2;
           }
-          data data_out;
-          // Note that I use cFexcess_of_primitive_cell here which is
-          // a NaN to represent the values that are actually
-          // undefined.
-          data_out.diff_free_energy_per_atom=cFexcess_of_primitive_cell;
-          data_out.cfree_energy_per_atom=cFexcess_of_primitive_cell;
-          data_out.hfree_energy_per_vol=hfree_energy_per_vol;
-          data_out.cfree_energy_per_vol=cFexcess_of_primitive_cell;
-          return data_out;
         }
-        //printf("cFexcess_of_primitive_cell is now... %g\n", cFexcess_of_primitive_cell);   //debug
-        //printf("      finished %.5f%% of the integral\n",
-        //       100*((i)/double(Nl)
-        //           +(j)/uipow(Nl, 2)
-        //           +(k + 1)/uipow(Nl, 3)));
       }
-      ////const double fraction_complete = ((i)/double(Nl) + (j + 1)/uipow(Nl, 2));
-      ////const double t = time()/60/60;
-      ////const double time_total = t/fraction_complete;
-      ////printf("   finished %.3f%% of the integral (%g/%g hours left)\n",
-      ////       100*fraction_complete, time_total - t, time_total);
     }
-    //printf("finished %.1f%% of the integral\n",
-    //       100*(i + 1)/double(Nl));
-    //printf("cFexcess_of_primitive_cell so far=%g, phi_1=%g, phi_2=%g, phi_3=%g\n",cFexcess_of_primitive_cell, phi_1, phi_2, phi_3);
+
+    double phi_1 = -n_0*1.0*log(1.0-1.0*n_3);
+    double phi_2 = (n_1*n_2 - nv_1.dot(nv_2))/(1-n_3);
+    double phi_3;
+    if (use_tensor_weight) {
+      //double traceof_nm_2squared =  nm_2.x.x*nm_2.x.x +
+                                    //nm_2.y.y*nm_2.y.y +
+                                    //nm_2.z.z*nm_2.z.z +
+                                  //2*nm_2.x.y*nm_2.y.x +
+                                  //2*nm_2.x.z*nm_2.z.x +
+                                  //2*nm_2.y.z*nm_2.z.y;
+
+      double traceof_nm_2cubed =
+        nm_2.x.x*nm_2.x.x*nm_2.x.x +   // xx xx xx
+        nm_2.y.y*nm_2.y.y*nm_2.y.y +   // yy yy yy
+        nm_2.z.z*nm_2.z.z*nm_2.z.z +   // zz zz zz
+        3*nm_2.x.x*nm_2.x.y*nm_2.y.x + // xx xy yx three places to put xx
+        3*nm_2.x.x*nm_2.x.z*nm_2.z.x + // xx xz zx three places to put xx
+        3*nm_2.x.y*nm_2.y.y*nm_2.y.x + // xy yy yx three places to put yy
+        3*nm_2.y.y*nm_2.y.z*nm_2.z.y + // yy yz zy three places to put yy
+        3*nm_2.x.z*nm_2.z.z*nm_2.z.x + // xz zz zx three places to put zz
+        3*nm_2.y.z*nm_2.z.z*nm_2.z.y + // yz zz zy three places to put zz
+        3*nm_2.x.y*nm_2.y.z*nm_2.z.x + // xy yz zx three cyclic permutations
+        3*nm_2.x.z*nm_2.z.y*nm_2.y.x;  // xz zy yx == the above, but these are the non-cyclic permutations
+
+      //phi_3 = (uipow(n_2,3) - 3.0*n_2*nv_2.dot(nv_2) + (9/2.0)*(nv_2.dot(nm_2.dot(nv_2))-3.0*nm_2.determinant()))/(24*M_PI*uipow(1.0-1.0*n_3,2));        // Schmidt equation 5  (2000) - ok
+      phi_3 =( n_2*(uipow(n_2,2) - 3.0*nv_2.dot(nv_2)) + (9/2.0)*(nv_2.dot(nm_2.dot(nv_2)) - traceof_nm_2cubed))
+        /(24*M_PI*uipow(1-n_3,2));         // Santos (2012) - yes
+      //phi_3 = (nv_2.dot(nm_2.dot(nv_2))-n_2*nv_2.dot(nv_2) - traceof_nm_2cubed + n_2*traceof_nm_2squared)/((16/3.0)*M_PI*uipow(1.0-1.0*n_3,2));      // Sweatman, Groh & Schmidt  (2001) - same as Santos with different w_nm
+    } else {
+      // The following was Rosenfelds early vector version of the functional
+      //double phi_3 = (uipow(n_2,3) - 3*n_2*nv_2.normsquared())/(24*M_PI*uipow(1-n_3,2));
+      // This is the fixed version, which comes from dimensional crossover
+      phi_3 = uipow(n_2,3)*uipow(1.0 - nv_2.normsquared()/sqr(n_2),3)/(24*M_PI*sqr(1-n_3));
+    }
+    if (n_2 == 0 || sqr(n_2) <= nv_2.normsquared()) phi_3 = 0;
+    if (n_0 < 1e-5*reduced_density && n_3 >= 1 && n_3 < 1 + 1e-14) {
+      // This is a case where the prefactor on each of our free
+      // energy contributions is within roundoff error of zero.
+      // Sadly, n_3 may be greater than 1, in which case we would
+      // get a NaN when the true contribution to the free energy
+      // is probably actually zero.
+      phi_1 = 0;
+      phi_2 = 0;
+      phi_3 = 0;
+    }
+
+    mean_n0 += n_0*dVw;
+    mean_n1 += n_1*dVw;
+    mean_n2 += n_2*dVw;
+    mean_n3 += n_3*dVw;
+    total_phi_1 += temp*phi_1*dVw;
+    total_phi_2 += temp*phi_2*dVw;
+    total_phi_3 += temp*phi_3*dVw;
+    cFexcess_of_primitive_cell += temp*(phi_1 + phi_2 + phi_3)*dVw;  //NOTE: temp is Bolatzman constant times temperature divided by epsilon (which is 1)
+    if (isnan(cFexcess_of_primitive_cell)) {                        // temp is a reduced temperature given by t* in the paper
+      printf("free energy is a NaN!\n");
+      printf("position is: %g %g %g\n", r.x, r.y, r.z);
+      printf("n0 = %g\nn1 = %g\nn2=%g\nn3=%.17g = 1+%g\n", n_0, n_1, n_2, n_3, n_3-1);
+      printf("phi1 = %g\nphi2 = %g\n\n#phi3=%g\n", phi_1, phi_2, phi_3);
+      printf("             #NAN!\n"); //
+      if (free_energy_output_file) {
+        FILE *f = fopen(free_energy_output_file, "a");
+        fprintf(f, "\n# git  version: %s\n", version_identifier());
+        fprintf(f, "#dx\tmc-error\tphi1\tphi2\tphi3\tFtot\tFideal\t\t\tFEdiff\t\tmean_n3\t\t\trelerr\t\t\tmc_con\tmc_pf\tgw\t\tfv\tkT\tn\tseed\tmin\n");
+        fprintf(f, "%g\t%g\t\t%g\t%g\t%g\t%g\t%g\t\t%g\t\t%g\t\t%g\t\t%ld\t%ld\t%g\t%g\t%g\t%g\t%g\t%g\n",
+                dx_input,
+                MC_ERROR,
+                total_phi_1/primitive_cell_volume,
+                total_phi_2/primitive_cell_volume,
+                total_phi_3/primitive_cell_volume,
+                cfree_energy_per_vol,
+                cFideal_of_primitive_cell/primitive_cell_volume,
+                total_phi_1+total_phi_2+total_phi_3,
+                mean_n3,
+                0.0,
+                mc_constant,
+                mc_prefactor,
+                gwidth,
+                fv,
+                temp,
+                reduced_density,
+                seed,
+                0.0);
+        fclose(f);
+      }
+      data data_out;
+      // Note that I use cFexcess_of_primitive_cell here which is
+      // a NaN to represent the values that are actually
+      // undefined.
+      data_out.diff_free_energy_per_atom=cFexcess_of_primitive_cell;
+      data_out.cfree_energy_per_atom=cFexcess_of_primitive_cell;
+      data_out.hfree_energy_per_vol=hfree_energy_per_vol;
+      data_out.cfree_energy_per_vol=cFexcess_of_primitive_cell;
+      return data_out;
+    }
+    //printf("cFexcess_of_primitive_cell is now... %g\n", cFexcess_of_primitive_cell);   //debug
   }
   mean_n0 /= primitive_cell_volume;
   mean_n1 /= primitive_cell_volume;
@@ -1386,7 +1384,7 @@ int main(int argc, const char **argv) {
     vector3d r = vector3d(0,0,.55);
     vector3d R = vector3d(0,0,0);
     weight w_R = find_weighted_den_aboutR_guasquad(r, R, dx, temp, a, gw, fv);
-    weight w_MC = find_weighted_den_aboutR_mc(r, R, dx, temp, a, gw, fv);
+    weight w_MC = find_weighted_den_aboutR_mc(r, R, dx, temp, a, gw, fv, NUM_POINTS);
 
     printf("\n\nreduced_density = %g, fv = %g, gw = %g  alpha=%g Xi=%g\n", reduced_density, fv, gw,
            find_alpha(temp), find_Xi(temp));
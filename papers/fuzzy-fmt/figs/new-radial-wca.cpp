@@ -112,7 +112,7 @@ int main(int argc, char **argv) {
   //hf.printme("XXX:");
   printf("cell energy should be %g\n", hf.energy()*xmax*ymax*zmax);
 
-  SFMTFluidVeff f = sfmt_inhomogeneous(temp, xmax, ymax, zmax, dx);
+  SFMTFluidVeff f = sfmt_inhomogeneous<SFMTFluidVeff>(temp, xmax, ymax, zmax, dx);
   f.mu() = hf.mu();
   f.Vext() = 0;
   f.Veff() = -temp*log(hf.n()); // start with a uniform density as a guess
@@ -18,7 +18,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <sys/stat.h>
-#include "new/SFMTFluidVeffFast.h"
+#include "new/SFMTFluidVeffPlanarFast.h"
 #include "new/HomogeneousSFMTFluidFast.h"
 #include "new/Minimize.h"
 
@@ -42,7 +42,7 @@ static void took(const char *name) {
   last_time = t;
 }
 
-void run_walls(double reduced_density, SFMTFluidVeff *f, double kT) {
+void run_walls(double reduced_density, SFMTFluidVeffPlanar *f, double kT) {
   Minimize min(f);
   min.set_relative_precision(0);
   min.set_maxiter(10000);
@@ -110,7 +110,7 @@ int main(int argc, char **argv) {
   printf("cell energy should be %g\n", hf.energy()*dw*dw*width);
   hf.printme("homogeneous");
 
-  SFMTFluidVeff f = sfmt_inhomogeneous(temp, dw, dw, width, dx);
+  SFMTFluidVeffPlanar f = sfmt_inhomogeneous<SFMTFluidVeffPlanar>(temp, dw, dw, width, dx);
   f.mu() = hf.mu();
   f.Vext() = 0;
 
@@ -18,12 +18,18 @@
 #include <stdlib.h>
 #include <time.h>
 #include <sys/stat.h>
-#include "new/SFMTFluidVeffFast.h"
+#include "new/SFMTFluidVeffPlanarFast.h"
 #include "new/HomogeneousSFMTFluidFast.h"
 #include "new/Minimize.h"
 
 #include "findxi.h"
 
+// Unlike new-bh-walls.cpp, this still puts its wall in a periodic cell
+// with spacing on either side, rather than using the mirror walls of
+// WallsWhiteBearFluid.h, since that is a White Bear fluid, and this is
+// the soft-sphere SFMT fluid, whose smeared weights we have no
+// hand-written wall version of.
+
 // Here we set up the lattice.
 static double width = 30;
 const double dx = 0.01;
@@ -40,7 +46,7 @@ static void took(const char *name) {
   last_time = t;
 }
 
-void run_walls(double reduced_density, SFMTFluidVeff *f, double kT) {
+void run_walls(double reduced_density, SFMTFluidVeffPlanar *f, double kT) {
   Minimize min(f);
   min.set_relative_precision(0);
   min.set_maxiter(10000);
@@ -105,7 +111,7 @@ int main(int argc, char **argv) {
   printf("cell energy should be %g\n", hf.energy()*dw*dw*width);
   hf.printme("homogeneous");
 
-  SFMTFluidVeff f = sfmt_inhomogeneous(temp, dw, dw, width + spacing, dx);
+  SFMTFluidVeffPlanar f = sfmt_inhomogeneous<SFMTFluidVeffPlanar>(temp, dw, dw, width + spacing, dx);
   f.mu() = hf.mu();
   f.Vext() = 0;
   //f.n() = hf.n();
@@ -50,7 +50,7 @@ int main(int argc, char **argv) {
 
   sscanf(argv[1], "%lg", &temp);
 
-  SFMTFluidVeff f = sfmt_inhomogeneous(temp, xmax, ymax, zmax, dx);
+  SFMTFluidVeff f = sfmt_inhomogeneous<SFMTFluidVeff>(temp, xmax, ymax, zmax, dx);
   f.Vext() = 0;
   f.Veff() = -temp*log(0.00001); // essentially zero everywhere else
   f.Veff()[0] = -temp*log(1.0/uipow(dx, 3)); // here is the delta function.
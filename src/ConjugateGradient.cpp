@@ -59,6 +59,7 @@ public:
 bool ConjugateGradientType::improve_energy(bool verbose) {
   iter++;
   //printf("I am running ConjugateGradient::improve_energy\n");
+  grad(); // compute the gradient first, since that computes the energy too.
   const double E0 = energy();
   if (E0 != E0) {
     // There is no point continuing, since we're starting with a NaN!
@@ -115,6 +116,7 @@ void ConjugateGradientType::print_info(const char *prefix) const {
 bool PreconditionedConjugateGradientType::improve_energy(bool verbose) {
   iter++;
   //printf("I am running ConjugateGradient::improve_energy\n");
+  pgrad(); // compute pgrad first, since that computes the gradient and energy too.
   const double E0 = energy();
   if (E0 != E0) {
     // There is no point continuing, since we're starting with a NaN!
@@ -134,7 +136,6 @@ bool PreconditionedConjugateGradientType::improve_energy(bool verbose) {
     // Note that we could save some memory by using Fletcher-Reeves, and
     // it seems worth implementing that as an option for
     // memory-constrained problems (then we wouldn't need to store oldgrad).
-    pgrad(); // compute pgrad first, since that computes both.
     beta = -pgrad().dot(-grad() - oldgrad)/oldgradsqr;
     oldgrad = -grad();
     if (beta < 0 || beta != beta || oldgradsqr == 0) beta = 0;
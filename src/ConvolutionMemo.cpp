@@ -0,0 +1,174 @@
+#include "ConvolutionMemo.h"
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <mutex>
+
+namespace {
+  struct ConvolutionKey {
+    KernelFunction f;
+    double parameter;
+    int Nx, Ny, Nz;
+    double lattice[9];
+    unsigned long hash; // of the input
+    bool operator<(const ConvolutionKey &b) const {
+      if (f != b.f) return std::less<KernelFunction>()(f, b.f);
+      if (parameter != b.parameter) return parameter < b.parameter;
+      if (hash != b.hash) return hash < b.hash;
+      if (Nx != b.Nx) return Nx < b.Nx;
+      if (Ny != b.Ny) return Ny < b.Ny;
+      if (Nz != b.Nz) return Nz < b.Nz;
+      for (int i=0; i<9; i++) {
+        if (lattice[i] != b.lattice[i]) return lattice[i] < b.lattice[i];
+      }
+      return false;
+    }
+  };
+
+  typedef std::shared_ptr<const VectorXd> FieldPtr;
+
+  struct Memoized {
+    FieldPtr input, output;
+  };
+
+  // As in the kernel cache, we never free the mutex or the map, so that
+  // convolutions performed by static destructors still work.
+  std::mutex &memo_mutex() {
+    static std::mutex *m = new std::mutex;
+    return *m;
+  }
+  std::map<ConvolutionKey, Memoized> &memo() {
+    static std::map<ConvolutionKey, Memoized> *m = new std::map<ConvolutionKey, Memoized>;
+    return *m;
+  }
+  long limit = 32; // in fields (see ConvolutionMemo.h)
+  int depth = 0; // how many scopes we are in
+  long total_fields = 0, total_bytes = 0, num_saved = 0, num_computed = 0, num_evaluations = 0, peak_bytes = 0;
+
+  ConvolutionKey make_key(const GridDescription &gd, KernelFunction f, double parameter,
+                          unsigned long hash) {
+    ConvolutionKey k;
+    k.f = f;
+    k.parameter = parameter;
+    k.hash = hash;
+    k.Nx = gd.Nx;
+    k.Ny = gd.Ny;
+    k.Nz = gd.Nz;
+    const Cartesian a[3] = { gd.Lat.a1(), gd.Lat.a2(), gd.Lat.a3() };
+    for (int i=0; i<3; i++) {
+      for (int j=0; j<3; j++) k.lattice[3*i + j] = a[i](j);
+    }
+    return k;
+  }
+
+  // hash_field is an FNV-1a hash of the bits of x.  It only needs to
+  // tell different fields apart quickly, since we compare the fields
+  // themselves before using a memoized result.
+  unsigned long hash_field(const VectorXd &x) {
+    unsigned long long h = 14695981039346656037ULL;
+    const unsigned long long *bits = reinterpret_cast<const unsigned long long *>(x.data());
+    for (long i=0; i<x.rows(); i++) {
+      h ^= bits[i];
+      h *= 1099511628211ULL;
+    }
+    return h ^ x.rows();
+  }
+
+  bool same_field(const VectorXd &a, const VectorXd &b) {
+    return a.rows() == b.rows() && !memcmp(a.data(), b.data(), a.rows()*sizeof(double));
+  }
+}
+
+ConvolutionMemoScope::ConvolutionMemoScope() {
+  std::lock_guard<std::mutex> lock(memo_mutex());
+  depth++;
+}
+
+ConvolutionMemoScope::~ConvolutionMemoScope() {
+  std::lock_guard<std::mutex> lock(memo_mutex());
+  if (--depth == 0) {
+    num_evaluations++;
+    memo().clear();
+    total_fields = 0;
+    total_bytes = 0;
+  }
+}
+
+ConvolutionMemo::ConvolutionMemo(const GridDescription &g, KernelFunction ff, double p,
+                                 const VectorXd &input)
+  : gd(g), f(ff), parameter(p), x(input), hash(0) {
+  {
+    std::lock_guard<std::mutex> lock(memo_mutex());
+    if (!depth || !limit) return;
+  }
+  hash = hash_field(x);
+  std::lock_guard<std::mutex> lock(memo_mutex());
+  std::map<ConvolutionKey, Memoized>::iterator i = memo().find(make_key(gd, f, parameter, hash));
+  if (i != memo().end() && same_field(*i->second.input, x)) {
+    output = i->second.output;
+    num_saved++;
+  }
+}
+
+void ConvolutionMemo::remember(const VectorXd &result) {
+  std::lock_guard<std::mutex> lock(memo_mutex());
+  if (!depth || !limit) return;
+  num_computed++;
+  const ConvolutionKey k = make_key(gd, f, parameter, hash);
+  if (memo().find(k) != memo().end()) return; // a hash collision, or another thread
+  // Many convolutions share an input (e.g. the density), so we only
+  // keep one copy of it.
+  Memoized m;
+  long fields = 1, bytes = result.rows()*sizeof(double);
+  for (std::map<ConvolutionKey, Memoized>::iterator i = memo().begin(); i != memo().end(); ++i) {
+    if (i->first.hash == hash && same_field(*i->second.input, x)) {
+      m.input = i->second.input;
+      break;
+    }
+  }
+  if (!m.input) {
+    fields++;
+    bytes += x.rows()*sizeof(double);
+  }
+  if (total_fields + fields > limit) return;
+  if (!m.input) m.input = FieldPtr(new VectorXd(x));
+  m.output = FieldPtr(new VectorXd(result));
+  memo()[k] = m;
+  total_fields += fields;
+  total_bytes += bytes;
+  if (total_bytes > peak_bytes) peak_bytes = total_bytes;
+}
+
+void set_convolution_memo_limit(long fields) {
+  std::lock_guard<std::mutex> lock(memo_mutex());
+  limit = fields;
+  if (total_fields > limit) {
+    memo().clear();
+    total_fields = 0;
+    total_bytes = 0;
+  }
+}
+
+ConvolutionMemoStats convolution_memo_stats() {
+  std::lock_guard<std::mutex> lock(memo_mutex());
+  ConvolutionMemoStats s;
+  s.saved = num_saved;
+  s.computed = num_computed;
+  s.evaluations = num_evaluations;
+  s.peak_bytes = peak_bytes;
+  return s;
+}
+
+void print_convolution_memo_stats(const char *prefix) {
+  ConvolutionMemoStats s = convolution_memo_stats();
+  printf("%sconvolution memo: %ld saved, %ld computed in %ld evaluations, peak %g M\n",
+         prefix, s.saved, s.computed, s.evaluations, s.peak_bytes/1024.0/1024);
+}
+
+void reset_convolution_memo_stats() {
+  std::lock_guard<std::mutex> lock(memo_mutex());
+  num_saved = 0;
+  num_computed = 0;
+  num_evaluations = 0;
+  peak_bytes = total_bytes;
+}
@@ -0,0 +1,87 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include "KernelCache.h"
+
+// A functional such as SaftFluidSlow or the contact densities in
+// ContactDensity.cpp is built from many terms, each of which creates
+// its own weighted densities: n2, n3 and the vector n2v appear over
+// and over, each as a separate ConvolveWith.  Rather than performing
+// the same convolution again for each of them, ConvolveWith remembers
+// the result of each convolution for the rest of the evaluation (e.g.
+// one call to integral() or integral_and_grad()), and uses it whenever
+// the same kernel is applied to the same field.
+//
+// A convolution is identified the same way as in the kernel cache, by
+// its kernel function, its parameter and the grid, together with its
+// input.  We recognize the input by a hash of its contents, and then
+// compare it with a copy of the input we convolved, so a field that
+// happens to have the same address (or hash) as an earlier one is
+// never mistaken for it.  Since the sub-expressions above the
+// convolutions in these functionals are all local, and thus cheap,
+// this is where sharing them pays off.
+//
+// The memo is only used while a ConvolutionMemoScope exists, and is
+// emptied when the outermost scope ends, so that we never hold on to
+// memory between evaluations.  The Functional methods that evaluate a
+// functional on a grid each create a scope.
+//
+// The memo keeps a copy of each convolution it remembers, and of each
+// distinct input, so it costs one field's memory (8 Nx Ny Nz bytes)
+// for each.  With no limit, the hard-sphere and association terms of
+// SaftFluidSlow would keep about 220 fields in one integral_and_grad,
+// which is 1.8 GB on a 100^3 grid.  The convolutions they repeat are
+// nearly all weighted densities of the density itself, which come
+// first, so a limit of 32 fields (256 MB at 100^3) saves just as many.
+// That is the default limit, which set_convolution_memo_limit changes.
+//
+// Only composed functionals (built from ConvolveWith) use the memo.
+// Generated functionals such as WaterSaft and SaftFluid2 perform their
+// own FFTs, so the memo saves them nothing.
+
+class ConvolutionMemoScope {
+public:
+  ConvolutionMemoScope();
+  ~ConvolutionMemoScope();
+private:
+  ConvolutionMemoScope(const ConvolutionMemoScope &); // not implemented
+  void operator=(const ConvolutionMemoScope &); // not implemented
+};
+
+// A ConvolutionMemo looks up the convolution of x with the kernel
+// f(gd, parameter).  If found() is false, the caller should compute
+// it, and then remember() the result.
+class ConvolutionMemo {
+public:
+  ConvolutionMemo(const GridDescription &gd, KernelFunction f, double parameter,
+                  const VectorXd &x);
+  bool found() const { return bool(output); }
+  const VectorXd &result() const { return *output; }
+  void remember(const VectorXd &result);
+private:
+  const GridDescription &gd;
+  KernelFunction f;
+  double parameter;
+  const VectorXd &x;
+  unsigned long hash;
+  std::shared_ptr<const VectorXd> output;
+};
+
+// set_convolution_memo_limit sets the most fields (each the size of
+// the grid being convolved) that the memo may keep within one
+// evaluation, beyond which further convolutions aren't remembered.  The
+// default is 32, and a limit of zero disables the memo.
+void set_convolution_memo_limit(long fields);
+
+struct ConvolutionMemoStats {
+  long saved;       // number of convolutions we didn't need to perform
+  long computed;    // number of convolutions performed within a scope
+  long evaluations; // number of outermost scopes
+  long peak_bytes;  // most memory used by the memo
+};
+ConvolutionMemoStats convolution_memo_stats();
+void print_convolution_memo_stats(const char *prefix = "");
+
+// reset_convolution_memo_stats sets the counters to zero.
+void reset_convolution_memo_stats();
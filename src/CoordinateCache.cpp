@@ -0,0 +1,127 @@
+#include "CoordinateCache.h"
+#include "GridDescription.h"
+#include <stdio.h>
+#include <map>
+#include <mutex>
+
+namespace {
+  struct GridKey {
+    int Nx, Ny, Nz;
+    double lattice[9];
+    bool operator<(const GridKey &b) const {
+      if (Nx != b.Nx) return Nx < b.Nx;
+      if (Ny != b.Ny) return Ny < b.Ny;
+      if (Nz != b.Nz) return Nz < b.Nz;
+      for (int i=0; i<9; i++) {
+        if (lattice[i] != b.lattice[i]) return lattice[i] < b.lattice[i];
+      }
+      return false;
+    }
+  };
+
+  struct CachedTable {
+    CoordinatePtr table;
+    long last_used; // a count of lookups, for finding the least recently used
+  };
+
+  // The number of grids whose tables we keep.
+  const unsigned max_tables = 4;
+
+  // As in FFTPlanCache, we never free the mutex or the map, so that
+  // grids set up by static destructors still work.
+  std::mutex &cache_mutex() {
+    static std::mutex *m = new std::mutex;
+    return *m;
+  }
+  std::map<GridKey, CachedTable> &tables() {
+    static std::map<GridKey, CachedTable> *t = new std::map<GridKey, CachedTable>;
+    return *t;
+  }
+  long num_hits = 0, num_misses = 0, use_count = 0;
+
+  GridKey make_key(const GridDescription &gd) {
+    GridKey k;
+    k.Nx = gd.Nx;
+    k.Ny = gd.Ny;
+    k.Nz = gd.Nz;
+    const Cartesian a[3] = { gd.Lat.a1(), gd.Lat.a2(), gd.Lat.a3() };
+    for (int i=0; i<3; i++) {
+      for (int j=0; j<3; j++) k.lattice[3*i + j] = a[i](j);
+    }
+    return k;
+  }
+
+  CoordinateTable *compute_table(const GridDescription &gd) {
+    CoordinateTable *t = new CoordinateTable;
+    t->x.resize(gd.NxNyNz);
+    t->y.resize(gd.NxNyNz);
+    t->z.resize(gd.NxNyNz);
+    int i = 0;
+    for (int x=0; x<gd.Nx; x++) {
+      for (int y=0; y<gd.Ny; y++) {
+        for (int z=0; z<gd.Nz; z++) {
+          const Cartesian r(gd.Lat.wignerSeitz(gd.Lat.toCartesian(Relative(x*gd.dx,y*gd.dy,z*gd.dz))));
+          t->x[i] = r(0);
+          t->y[i] = r(1);
+          t->z[i] = r(2);
+          i++;
+        }
+      }
+    }
+    return t;
+  }
+}
+
+CoordinatePtr wigner_seitz_coordinates(const GridDescription &gd) {
+  const GridKey k = make_key(gd);
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex());
+    std::map<GridKey, CachedTable>::iterator i = tables().find(k);
+    if (i != tables().end()) {
+      num_hits++;
+      i->second.last_used = ++use_count;
+      return i->second.table;
+    }
+  }
+  // We compute the table without holding the lock, since it is slow.
+  CoordinatePtr p(compute_table(gd));
+  std::lock_guard<std::mutex> lock(cache_mutex());
+  num_misses++;
+  if (tables().find(k) != tables().end()) {
+    // Another thread computed this table at the same time as we did.
+    return tables()[k].table;
+  }
+  while (tables().size() >= max_tables) {
+    std::map<GridKey, CachedTable>::iterator oldest = tables().begin();
+    for (std::map<GridKey, CachedTable>::iterator i = tables().begin(); i != tables().end(); ++i) {
+      if (i->second.last_used < oldest->second.last_used) oldest = i;
+    }
+    tables().erase(oldest);
+  }
+  CachedTable &c = tables()[k];
+  c.table = p;
+  c.last_used = ++use_count;
+  return p;
+}
+
+CoordinateCacheStats coordinate_cache_stats() {
+  std::lock_guard<std::mutex> lock(cache_mutex());
+  CoordinateCacheStats s;
+  s.hits = num_hits;
+  s.misses = num_misses;
+  s.tables = tables().size();
+  return s;
+}
+
+void print_coordinate_cache_stats(const char *prefix) {
+  CoordinateCacheStats s = coordinate_cache_stats();
+  printf("%scoordinate cache: %ld hits, %ld misses, %ld tables\n",
+         prefix, s.hits, s.misses, s.tables);
+}
+
+void forget_coordinates() {
+  std::lock_guard<std::mutex> lock(cache_mutex());
+  tables().clear();
+  num_hits = 0;
+  num_misses = 0;
+}
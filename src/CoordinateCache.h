@@ -0,0 +1,46 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <memory>
+#include "lattice.h"
+
+// We don't include GridDescription.h, since it includes
+// RealSpaceOperators.h, which includes us.
+class GridDescription;
+
+// This file provides a process-wide cache of the real-space position
+// of every point of a grid, reduced to the Wigner-Seitz cell.  Finding
+// that position means decoding the index and calling
+// Lattice::wignerSeitz, which tries seven lattice vectors, and yet it
+// depends only on the grid.  Since Grid::Set and the real-space
+// operators (r2, rx and so on) are applied to the same grids over and
+// over, we compute the positions once per grid and look them up after
+// that.
+//
+// The positions are stored as three separate arrays of x, y and z, in
+// the same order as the points of a Grid, so a loop over the grid
+// reads each of them sequentially.  A table takes three times the
+// memory of a Grid, so we only keep the tables for the few most
+// recently used grids.
+
+struct CoordinateTable {
+  VectorXd x, y, z;
+  Cartesian operator[](int i) const { return Cartesian(x[i], y[i], z[i]); }
+};
+typedef std::shared_ptr<const CoordinateTable> CoordinatePtr;
+
+// wigner_seitz_coordinates returns the positions of the points of gd,
+// computing them only if they aren't already cached.
+CoordinatePtr wigner_seitz_coordinates(const GridDescription &gd);
+
+struct CoordinateCacheStats {
+  long hits;   // number of tables found in the cache
+  long misses; // number of tables we had to compute
+  long tables; // number of tables currently held in the cache
+};
+CoordinateCacheStats coordinate_cache_stats();
+void print_coordinate_cache_stats(const char *prefix = "");
+
+// forget_coordinates empties the cache and resets the counters.
+void forget_coordinates();
@@ -44,8 +44,8 @@ public:
 
 bool DownhillType::improve_energy(bool verbose) {
   iter++;
-  const double old_energy = energy();
   const VectorXd g = grad();
+  const double old_energy = energy(); // computed along with g
   // Let's immediately free the cached gradient stored internally!
   invalidate_cache();
   // We waste some memory storing newx (besides *x itself), but this
@@ -80,8 +80,8 @@ void DownhillType::print_info(const char *prefix) const {
 
 bool PreconditionedDownhillType::improve_energy(bool verbose) {
   iter++;
-  const double old_energy = energy();
   const VectorXd g = pgrad();
+  const double old_energy = energy(); // computed along with g
   // Let's immediately free the cached gradient stored internally!
   invalidate_cache();
   // We waste some memory storing newx (besides *x itself), but this
@@ -0,0 +1,135 @@
+#include "FFTPlanCache.h"
+#include "FFTThreads.h"
+#include "FFTWisdom.h"
+#include <stdio.h>
+#include <map>
+#include <mutex>
+
+namespace {
+  enum Direction { r2c, c2r };
+
+  struct PlanKey {
+    int Nx, Ny, Nz;
+    Direction dir;
+    bool aligned, inplace;
+    int nthreads;
+    bool operator<(const PlanKey &b) const {
+      if (nthreads != b.nthreads) return nthreads < b.nthreads;
+      if (Nx != b.Nx) return Nx < b.Nx;
+      if (Ny != b.Ny) return Ny < b.Ny;
+      if (Nz != b.Nz) return Nz < b.Nz;
+      if (dir != b.dir) return dir < b.dir;
+      if (aligned != b.aligned) return aligned < b.aligned;
+      return inplace < b.inplace;
+    }
+  };
+
+  // We never free the mutex or the map, so that transforms performed
+  // by static destructors still work.
+  std::mutex &cache_mutex() {
+    static std::mutex *m = new std::mutex;
+    return *m;
+  }
+  std::map<PlanKey, fftw_plan> &plans() {
+    static std::map<PlanKey, fftw_plan> *p = new std::map<PlanKey, fftw_plan>;
+    return *p;
+  }
+  long num_hits = 0, num_misses = 0, num_executions = 0;
+
+  // make_plan must be called with the mutex held, since fftw's planner
+  // is not thread-safe.  We plan on scratch arrays, since FFTW_MEASURE
+  // overwrites its arrays.
+  fftw_plan make_plan(const PlanKey &k) {
+    const long nreal = long(k.Nx)*k.Ny*k.Nz;
+    const long ncomplex = long(k.Nx)*k.Ny*(k.Nz/2 + 1);
+    const unsigned flags = k.aligned ? FFTW_MEASURE : FFTW_MEASURE | FFTW_UNALIGNED;
+    use_fft_wisdom();
+    plan_with_fft_threads(k.nthreads);
+    fftw_complex *c = (fftw_complex *)fftw_malloc(ncomplex*sizeof(fftw_complex));
+    double *r = k.inplace ? (double *)c : (double *)fftw_malloc(nreal*sizeof(double));
+    fftw_plan p;
+    if (k.dir == r2c) p = fftw_plan_dft_r2c_3d(k.Nx, k.Ny, k.Nz, r, c, flags);
+    else p = fftw_plan_dft_c2r_3d(k.Nx, k.Ny, k.Nz, c, r, flags);
+    if (!k.inplace) fftw_free(r);
+    fftw_free(c);
+    return p;
+  }
+
+  fftw_plan get_plan(PlanKey k) {
+    std::lock_guard<std::mutex> lock(cache_mutex());
+    k.nthreads = fft_threads();
+    num_executions++;
+    std::map<PlanKey, fftw_plan>::iterator i = plans().find(k);
+    if (i != plans().end()) {
+      num_hits++;
+      return i->second;
+    }
+    num_misses++;
+    fftw_plan p = make_plan(k);
+    plans()[k] = p;
+    return p;
+  }
+
+  PlanKey make_key(int Nx, int Ny, int Nz, Direction dir, double *r, fftw_complex *c) {
+    PlanKey k;
+    k.Nx = Nx;
+    k.Ny = Ny;
+    k.Nz = Nz;
+    k.dir = dir;
+    k.aligned = fftw_alignment_of(r) == 0 && fftw_alignment_of((double *)c) == 0;
+    k.inplace = (r == (double *)c);
+    return k;
+  }
+}
+
+void fft_r2c_3d(int Nx, int Ny, int Nz, double *in, fftw_complex *out) {
+  // The new-array execute functions are thread-safe, so we don't need
+  // to hold the lock while transforming.
+  fftw_execute_dft_r2c(get_plan(make_key(Nx, Ny, Nz, r2c, in, out)), in, out);
+}
+
+void fft_c2r_3d(int Nx, int Ny, int Nz, fftw_complex *in, double *out) {
+  fftw_execute_dft_c2r(get_plan(make_key(Nx, Ny, Nz, c2r, out, in)), in, out);
+}
+
+void plan_fft_3d(int Nx, int Ny, int Nz) {
+  std::lock_guard<std::mutex> lock(cache_mutex());
+  PlanKey k;
+  k.Nx = Nx;
+  k.Ny = Ny;
+  k.Nz = Nz;
+  k.aligned = true;
+  k.inplace = false;
+  k.nthreads = fft_threads();
+  for (int d = r2c; d <= c2r; d++) {
+    k.dir = Direction(d);
+    if (plans().find(k) == plans().end()) plans()[k] = make_plan(k);
+  }
+}
+
+FFTPlanCacheStats fft_plan_cache_stats() {
+  std::lock_guard<std::mutex> lock(cache_mutex());
+  FFTPlanCacheStats s;
+  s.hits = num_hits;
+  s.misses = num_misses;
+  s.plans = plans().size();
+  s.executions = num_executions;
+  return s;
+}
+
+void print_fft_plan_cache_stats(const char *prefix) {
+  FFTPlanCacheStats s = fft_plan_cache_stats();
+  printf("%sfft plan cache: %ld transforms, %ld hits, %ld misses, %ld plans\n",
+         prefix, s.executions, s.hits, s.misses, s.plans);
+}
+
+void forget_fft_plans() {
+  std::lock_guard<std::mutex> lock(cache_mutex());
+  for (std::map<PlanKey, fftw_plan>::iterator i = plans().begin(); i != plans().end(); ++i) {
+    fftw_destroy_plan(i->second);
+  }
+  plans().clear();
+  num_hits = 0;
+  num_misses = 0;
+  num_executions = 0;
+}
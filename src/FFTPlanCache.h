@@ -0,0 +1,44 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <fftw3.h>
+
+// This file provides a process-wide cache of FFTW plans.  Making an
+// FFTW_MEASURE plan is far more expensive than executing it, so rather
+// than planning and destroying a plan for every transform, we plan
+// each distinct transform once and then keep reusing it via fftw's
+// "new-array execute" functions.
+//
+// A plan is identified by the grid size, the direction of the
+// transform, whether the arrays are aligned, whether the transform is
+// in-place, and the number of threads (see FFTThreads.h).  Plans are
+// always made on scratch arrays, so planning never clobbers the
+// caller's data.  The cache is protected by a mutex, so it is safe to
+// transform from more than one thread.  Planning is cheap when fftw
+// already has wisdom for a transform, which is saved between runs (see
+// FFTWisdom.h).
+
+// fft_r2c_3d and fft_c2r_3d perform an unnormalized transform, just
+// like the corresponding fftw functions.  As with fftw, the c2r
+// transform overwrites its input.
+void fft_r2c_3d(int Nx, int Ny, int Nz, double *in, fftw_complex *out);
+void fft_c2r_3d(int Nx, int Ny, int Nz, fftw_complex *in, double *out);
+
+// plan_fft_3d creates (aligned, out-of-place) plans for both
+// directions without executing them, for when we want to pay the
+// planning cost up front.
+void plan_fft_3d(int Nx, int Ny, int Nz);
+
+// The following allows us to check that plans are actually reused.
+struct FFTPlanCacheStats {
+  long hits;       // number of transforms that reused a cached plan
+  long misses;     // number of transforms that had to create a plan
+  long plans;      // number of plans currently held in the cache
+  long executions; // total number of transforms executed
+};
+FFTPlanCacheStats fft_plan_cache_stats();
+void print_fft_plan_cache_stats(const char *prefix = "");
+
+// forget_fft_plans destroys every cached plan and resets the counters.
+void forget_fft_plans();
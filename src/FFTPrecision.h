@@ -0,0 +1,55 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+// By default our FFTs are done in double precision.  Early in a
+// minimization, when we are far from converged, we don't need 15
+// digits, and can save time by doing the FFTs in single precision
+// instead.  This is done by Minimize::set_single_precision_until,
+// which asks for single precision (with an FFTPrecisionScope) around
+// each energy and gradient that it computes, and for double precision
+// once the gradient is small.  The precision is thus a property of a
+// particular evaluation, not of the program: any FFT outside such a
+// scope, or in another thread, is done in double precision.
+//
+// This applies to fft()/ifft() on the new Vector type, and only to
+// the transforms themselves, which is where the time goes.  Our fields
+// are still stored in double precision, and each single-precision
+// transform is done in place within the double-precision array that
+// holds its output, so it needs no memory beyond what a double
+// transform needs.  Each precision has its own plans, so switching
+// back and forth doesn't cause any replanning.
+//
+// Single precision needs fftw's single-precision library (fftw3f).
+// fac/configure.py defines DEFT_FFT_SINGLE when it can link with it.
+// Without it, every transform is done in double precision.
+
+inline bool &fft_single_precision_setting() {
+  static thread_local bool single = false;
+  return single;
+}
+
+inline bool fft_single_precision() {
+#ifdef DEFT_FFT_SINGLE
+  return fft_single_precision_setting();
+#else
+  return false;
+#endif
+}
+
+// An FFTPrecisionScope sets the precision of the FFTs done (by this
+// thread) during its lifetime, and restores the old precision when it
+// goes out of scope.
+class FFTPrecisionScope {
+public:
+  explicit FFTPrecisionScope(bool single) : old(fft_single_precision_setting()) {
+    fft_single_precision_setting() = single;
+  }
+  ~FFTPrecisionScope() {
+    fft_single_precision_setting() = old;
+  }
+private:
+  FFTPrecisionScope(const FFTPrecisionScope &); // not copyable
+  void operator=(const FFTPrecisionScope &);
+  bool old;
+};
@@ -0,0 +1,74 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <fftw3.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// By default our FFTs are single-threaded.  You can ask fftw to split
+// each transform across several threads either by setting the
+// environment variable DEFT_FFT_THREADS, or by calling
+// set_fft_threads() before (or between) minimizations.  This applies
+// both to fft()/ifft() on Grids and to fft()/ifft() on the new Vector
+// type.  A plan made for one thread count is never used for another,
+// so changing the number of threads just means that the next transform
+// of each size gets replanned.  The same thread count is used for
+// single-precision transforms (see FFTPrecision.h).
+//
+// Threads need fftw's threads libraries (fftw3_threads, and
+// fftw3f_threads if we use fftw3f).  fac/configure.py defines
+// DEFT_FFT_THREADS when it can link with them.  Without them we always use one thread, and the
+// planning functions below do nothing.
+
+inline int &fft_thread_count() {
+  static int n = 0; // zero means we haven't yet checked the environment
+  return n;
+}
+
+inline void set_fft_threads(int n) {
+#ifdef DEFT_FFT_THREADS
+  static bool initialized = false;
+  if (!initialized) {
+    fftw_init_threads();
+#ifdef DEFT_FFT_SINGLE
+    fftwf_init_threads();
+#endif
+    initialized = true;
+  }
+  fft_thread_count() = (n < 1) ? 1 : n;
+#else
+  static bool warned = false;
+  if (n > 1 && !warned) {
+    fprintf(stderr, "deft was built without fftw's threads libraries, so ffts use one thread.\n");
+    warned = true;
+  }
+  fft_thread_count() = 1;
+#endif
+}
+
+inline int fft_threads() {
+  if (!fft_thread_count()) {
+    const char *env = getenv("DEFT_FFT_THREADS");
+    set_fft_threads(env ? atoi(env) : 1);
+  }
+  return fft_thread_count();
+}
+
+// plan_with_fft_threads and plan_with_fftf_threads set the number of
+// threads for the double and single-precision plans made next.
+inline void plan_with_fft_threads(int n) {
+#ifdef DEFT_FFT_THREADS
+  fftw_plan_with_nthreads(n);
+#else
+  (void)n;
+#endif
+}
+
+inline void plan_with_fftf_threads(int n) {
+#if defined(DEFT_FFT_THREADS) && defined(DEFT_FFT_SINGLE)
+  fftwf_plan_with_nthreads(n);
+#else
+  (void)n;
+#endif
+}
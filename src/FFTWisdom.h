@@ -0,0 +1,136 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <fftw3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+
+// FFTW_MEASURE planning can take a large fraction of the run time of
+// a short job, so we can save fftw's "wisdom" (what it learned while
+// planning) to a file when the program exits, and load it again
+// before we make our first plan.  That way the planning cost is paid
+// once per machine, rather than once per process.
+//
+// This is off unless the DEFT_FFTW_WISDOM environment variable names
+// the wisdom file, or set_fft_wisdom_file() is called, so that tests
+// and one-off runs don't write files.  Wisdom is specific to a
+// particular machine, so if home directories are shared across a
+// cluster, include the host name, e.g.
+//
+//   export DEFT_FFTW_WISDOM=$HOME/.deft-fftw-wisdom.$(hostname)
+//
+// An empty DEFT_FFTW_WISDOM, or set_fft_wisdom_file(0), turns it off.
+//
+// Since many processes may start and stop at once during a parameter
+// sweep, we guard the file with flock on a separate lock file (the
+// wisdom file name with ".lock" appended), and when saving we first
+// merge in whatever wisdom other processes have saved in the
+// meantime.  Single-precision wisdom (see FFTPrecision.h) is kept
+// separately by fftw, so we save it alongside, in a file with ".float"
+// appended to the name.
+
+inline std::string &fft_wisdom_file_setting() {
+  static std::string *fname = 0;
+  if (!fname) {
+    const char *env = getenv("DEFT_FFTW_WISDOM");
+    fname = new std::string(env ? env : "");
+  }
+  return *fname;
+}
+
+inline bool &fft_wisdom_loaded() {
+  static bool loaded = false;
+  return loaded;
+}
+
+inline bool &fft_wisdom_changed() {
+  static bool changed = false;
+  return changed;
+}
+
+// fft_wisdom_lock opens (creating if needed) the lock file for fname
+// and locks it, returning the file descriptor to pass to
+// fft_wisdom_unlock, or -1 if we couldn't lock.
+inline int fft_wisdom_lock(const std::string &fname, int operation) {
+  const int fd = open((fname + ".lock").c_str(), O_RDWR | O_CREAT, 0644);
+  if (fd < 0) return -1;
+  if (flock(fd, operation)) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+inline void fft_wisdom_unlock(int fd) {
+  if (fd < 0) return;
+  flock(fd, LOCK_UN);
+  close(fd);
+}
+
+// merge_and_save_wisdom saves one precision's wisdom to fname, first
+// merging in whatever is already there.  The caller must hold the lock.
+inline void merge_and_save_wisdom(const std::string &fname,
+                                  int (*import_wisdom)(const char *),
+                                  int (*export_wisdom)(const char *)) {
+  import_wisdom(fname.c_str());
+  char pid[32];
+  snprintf(pid, sizeof(pid), ".%d", int(getpid()));
+  const std::string tmpname = fname + pid;
+  if (export_wisdom(tmpname.c_str())) {
+    // rename is atomic, so a reader never sees half a file.
+    if (rename(tmpname.c_str(), fname.c_str())) unlink(tmpname.c_str());
+  } else {
+    unlink(tmpname.c_str());
+  }
+}
+
+// save_fft_wisdom is called automatically at exit, but you may call
+// it yourself, e.g. before a long-running job gets killed.
+inline void save_fft_wisdom() {
+  const std::string &fname = fft_wisdom_file_setting();
+  if (fname == "" || !fft_wisdom_changed()) return;
+  const int fd = fft_wisdom_lock(fname, LOCK_EX);
+  if (fd < 0) return; // we can live without saving wisdom
+  merge_and_save_wisdom(fname, fftw_import_wisdom_from_filename,
+                        fftw_export_wisdom_to_filename);
+#ifdef DEFT_FFT_SINGLE
+  merge_and_save_wisdom(fname + ".float", fftwf_import_wisdom_from_filename,
+                        fftwf_export_wisdom_to_filename);
+#endif
+  fft_wisdom_unlock(fd);
+  fft_wisdom_changed() = false;
+}
+
+// use_fft_wisdom must be called before making each fftw plan.  The
+// first time, it loads the wisdom file and arranges for the wisdom to
+// be saved at exit.
+inline void use_fft_wisdom() {
+  if (!fft_wisdom_loaded()) {
+    fft_wisdom_loaded() = true;
+    static bool registered = false;
+    if (!registered) {
+      atexit(save_fft_wisdom);
+      registered = true;
+    }
+    const std::string &fname = fft_wisdom_file_setting();
+    if (fname != "") {
+      const int fd = fft_wisdom_lock(fname, LOCK_SH);
+      fftw_import_wisdom_from_filename(fname.c_str()); // fails harmlessly if there is no file
+#ifdef DEFT_FFT_SINGLE
+      fftwf_import_wisdom_from_filename((fname + ".float").c_str());
+#endif
+      fft_wisdom_unlock(fd);
+    }
+  }
+  fft_wisdom_changed() = true;
+}
+
+inline void set_fft_wisdom_file(const char *fname) {
+  fft_wisdom_file_setting() = fname ? fname : "";
+  fft_wisdom_loaded() = false; // load from the new file before planning again
+}
@@ -0,0 +1,153 @@
+#include "FieldFile.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+  const char magic[8] = { 'd', 'e', 'f', 't', 'f', 'l', 'd', '\n' };
+  const int32_t version = 1;
+  const int32_t byte_order_mark = 0x01020304;
+
+  // The header is padded to header_bytes, so that the values that
+  // follow it are well aligned, both in the file and in a mapping.
+  const long header_bytes = 256;
+  struct Header {
+    char magic[8];
+    int32_t version;
+    int32_t byte_order; // reads as byte_order_mark on a machine like the writer's
+    int64_t Nx, Ny, Nz, size;
+    double lattice[3][3];
+  };
+
+  bool check_header(const char *fname, const Header &h, FieldFileInfo *info) {
+    if (memcmp(h.magic, magic, sizeof(magic))) {
+      fprintf(stderr, "%s is not a field file!\n", fname);
+      return false;
+    }
+    if (h.byte_order != byte_order_mark) {
+      fprintf(stderr, "%s was written on a machine with a different byte order!\n", fname);
+      return false;
+    }
+    if (h.version != version) {
+      fprintf(stderr, "%s has unknown version %d of the field file format!\n", fname, h.version);
+      return false;
+    }
+    info->Nx = h.Nx;
+    info->Ny = h.Ny;
+    info->Nz = h.Nz;
+    info->size = h.size;
+    memcpy(info->lattice, h.lattice, sizeof(h.lattice));
+    return true;
+  }
+
+  bool read_header(const char *fname, FILE *f, FieldFileInfo *info) {
+    char buffer[header_bytes];
+    if (fread(buffer, 1, header_bytes, f) != size_t(header_bytes)) {
+      fprintf(stderr, "%s is too short to be a field file!\n", fname);
+      return false;
+    }
+    Header h;
+    memcpy(&h, buffer, sizeof(h));
+    return check_header(fname, h, info);
+  }
+}
+
+bool write_field_file(const char *fname, const FieldFileInfo &info, const double *data) {
+  FILE *f = fopen(fname, "wb");
+  if (!f) {
+    fprintf(stderr, "Unable to create file %s!\n", fname);
+    return false;
+  }
+  char buffer[header_bytes];
+  memset(buffer, 0, header_bytes);
+  Header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, magic, sizeof(magic));
+  h.version = version;
+  h.byte_order = byte_order_mark;
+  h.Nx = info.Nx;
+  h.Ny = info.Ny;
+  h.Nz = info.Nz;
+  h.size = info.size;
+  memcpy(h.lattice, info.lattice, sizeof(h.lattice));
+  memcpy(buffer, &h, sizeof(h));
+  // We write the values with a single call, so that we are limited
+  // only by the bandwidth of the disk.
+  const bool ok = fwrite(buffer, 1, header_bytes, f) == size_t(header_bytes)
+    && fwrite(data, sizeof(double), info.size, f) == size_t(info.size);
+  if (fclose(f) != 0 || !ok) {
+    fprintf(stderr, "Error writing file %s!\n", fname);
+    return false;
+  }
+  return true;
+}
+
+bool read_field_file_info(const char *fname, FieldFileInfo *info) {
+  FILE *f = fopen(fname, "rb");
+  if (!f) {
+    fprintf(stderr, "Unable to open file %s!\n", fname);
+    return false;
+  }
+  const bool ok = read_header(fname, f, info);
+  fclose(f);
+  return ok;
+}
+
+bool read_field_file(const char *fname, FieldFileInfo *info, double *data, long max_size) {
+  FILE *f = fopen(fname, "rb");
+  if (!f) {
+    fprintf(stderr, "Unable to open file %s!\n", fname);
+    return false;
+  }
+  bool ok = read_header(fname, f, info);
+  if (ok && info->size > max_size) {
+    fprintf(stderr, "%s holds %ld values, more than the %ld we have room for!\n",
+            fname, info->size, max_size);
+    ok = false;
+  }
+  if (ok && fread(data, sizeof(double), info->size, f) != size_t(info->size)) {
+    fprintf(stderr, "%s is truncated!\n", fname);
+    ok = false;
+  }
+  fclose(f);
+  return ok;
+}
+
+MappedFieldFile::MappedFieldFile(const char *fname) : mapping(0), mapped_bytes(0), values(0) {
+  memset(&header, 0, sizeof(header));
+  const int fd = open(fname, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Unable to open file %s!\n", fname);
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size < header_bytes) {
+    fprintf(stderr, "%s is too short to be a field file!\n", fname);
+    close(fd);
+    return;
+  }
+  void *p = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // the mapping keeps the file open for us
+  if (p == MAP_FAILED) {
+    fprintf(stderr, "Unable to map file %s!\n", fname);
+    return;
+  }
+  mapping = p;
+  mapped_bytes = st.st_size;
+  Header h;
+  memcpy(&h, p, sizeof(h));
+  if (!check_header(fname, h, &header)) return;
+  if (header_bytes + header.size*long(sizeof(double)) > mapped_bytes) {
+    fprintf(stderr, "%s is truncated!\n", fname);
+    return;
+  }
+  values = (const double *)((const char *)p + header_bytes);
+}
+
+MappedFieldFile::~MappedFieldFile() {
+  if (mapping) munmap(mapping, mapped_bytes);
+}
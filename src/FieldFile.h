@@ -0,0 +1,49 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+// This file defines a binary file format for fields on a grid, which
+// is fast to write and read, and which can be mapped into memory so a
+// field can be used without copying it at all.  A field file is a
+// fixed-size header followed by the values as raw doubles (in native
+// byte order, with z varying fastest, as in memory).  The header
+// records the grid size and the lattice vectors, along with the number
+// of values, which may be more than Nx*Ny*Nz, so that a file can hold
+// several fields on the same grid, or the entire data of a
+// NewFunctional.  For the rectangular cells of the new code, the
+// lattice vectors are just (ax,0,0), (0,ay,0) and (0,0,az).
+//
+// Errors (a missing file, or one that isn't a field file) are reported
+// on stderr, and make the functions here return false.
+
+struct FieldFileInfo {
+  long Nx, Ny, Nz;
+  long size; // the number of doubles in the file
+  double lattice[3][3]; // lattice[i] is the lattice vector a_{i+1}
+};
+
+bool write_field_file(const char *fname, const FieldFileInfo &info, const double *data);
+bool read_field_file_info(const char *fname, FieldFileInfo *info);
+// read_field_file reads the header into info, and the values into data,
+// which must have room for max_size doubles.
+bool read_field_file(const char *fname, FieldFileInfo *info, double *data, long max_size);
+
+// A MappedFieldFile maps a field file into memory (read only), so its
+// values can be used in place.  The pages are read from disk as they
+// are first touched, and the mapping lasts as long as the object.
+class MappedFieldFile {
+public:
+  explicit MappedFieldFile(const char *fname);
+  ~MappedFieldFile();
+  bool ok() const { return values != 0; }
+  const FieldFileInfo &info() const { return header; }
+  const double *data() const { return values; }
+private:
+  MappedFieldFile(const MappedFieldFile &); // not copyable, since we own the mapping
+  void operator=(const MappedFieldFile &);
+
+  FieldFileInfo header;
+  void *mapping;
+  long mapped_bytes;
+  const double *values;
+};
@@ -0,0 +1,144 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <stdlib.h>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Elementwise arithmetic and reductions over whole fields (sums, dot
+// products and integrals) can be split across several threads, when
+// we are compiled with OpenMP.  As with the ffts (see FFTThreads.h),
+// we use one thread unless the environment variable
+// DEFT_FIELD_THREADS is set, or set_field_threads() is called.
+// Arrays smaller than min_parallel_size are always handled by a single
+// thread, since starting threads would cost more than it saves, and
+// in the generated code many tiny Vectors (such as the k vector at
+// each k point) are created.
+//
+// Reductions add up fixed-size blocks, and then add the partial sums
+// in order, so a sum doesn't depend on the number of threads, and is
+// reproducible bit for bit.  Within a block, the sum of doubles is
+// vectorized, which changes its order, but always in the same way.
+
+const long min_parallel_size = 1 << 15;
+const long sum_block_size = 1 << 11;
+
+// DEFT_PRAGMA(omp ...) is an OpenMP pragma, or nothing without OpenMP.
+#ifdef _OPENMP
+#define DEFT_PRAGMA(x) _Pragma(#x)
+#else
+#define DEFT_PRAGMA(x)
+#endif
+
+inline int &field_thread_count() {
+  static int n = 0; // zero means we haven't yet checked the environment
+  return n;
+}
+
+inline void set_field_threads(int n) {
+  field_thread_count() = (n < 1) ? 1 : n;
+}
+
+inline int field_threads() {
+  if (!field_thread_count()) {
+    const char *env = getenv("DEFT_FIELD_THREADS");
+    set_field_threads(env ? atoi(env) : 1);
+  }
+  return field_thread_count();
+}
+
+// parallel_threads returns how many threads to use for n elements.
+// An elementwise loop is then written as
+//
+//   DEFT_PRAGMA(omp parallel for simd num_threads(field_threads()) if(parallel_threads(n) > 1))
+//   for (long i=0; i<n; i++) ...
+inline int parallel_threads(long n) {
+  return (n < min_parallel_size) ? 1 : field_threads();
+}
+
+// sum_block adds e[start..end).  The version for doubles is
+// vectorized.
+template<typename T, typename E>
+inline T sum_block(const E &e, long start, long end, T) {
+  T s = 0;
+  for (long i=start; i<end; i++) s += e[i];
+  return s;
+}
+template<typename E>
+inline double sum_block(const E &e, long start, long end, double) {
+  double s = 0;
+  DEFT_PRAGMA(omp simd reduction(+:s))
+  for (long i=start; i<end; i++) s += e[i];
+  return s;
+}
+
+// sum_blocks is the number of blocks in n elements, and block b ends
+// just before element sum_block_end(b, n).
+inline long sum_blocks(long n) {
+  return (n + sum_block_size - 1)/sum_block_size;
+}
+inline long sum_block_end(long b, long n) {
+  const long end = (b+1)*sum_block_size;
+  return end < n ? end : n;
+}
+
+// deterministic_sum returns the sum of e[0..n), where e is anything
+// that can be indexed, such as a pointer or an expression.
+template<typename T, typename E>
+inline T deterministic_sum(long n, const E &e) {
+  if (n <= sum_block_size) return sum_block(e, 0, n, T());
+  const long nblocks = sum_blocks(n);
+  std::vector<T> partial(nblocks);
+  DEFT_PRAGMA(omp parallel for num_threads(field_threads()) if(parallel_threads(n) > 1))
+  for (long b=0; b<nblocks; b++) {
+    partial[b] = sum_block(e, b*sum_block_size, sum_block_end(b, n), T());
+  }
+  T out = 0;
+  for (long b=0; b<nblocks; b++) out += partial[b];
+  return out;
+}
+
+// Products and Squares let deterministic_sum compute dot products and
+// norms, without storing the products.
+template<typename A, typename B, typename T>
+class Products {
+public:
+  Products(const A &x, const B &y) : a(x), b(y) {}
+  T operator[](long i) const { return a[i]*b[i]; }
+private:
+  A a;
+  B b;
+};
+
+template<typename A, typename T>
+class Squares {
+public:
+  explicit Squares(const A &x) : a(x) {}
+  T operator[](long i) const {
+    const T x = a[i];
+    return x*x;
+  }
+private:
+  A a;
+};
+
+// Values lets deterministic_sum add up f(i) for a function f, and
+// sum_of returns the sum of f(i) for i in [0,n).  This is how the
+// generated code computes its integrals, with f a lambda that computes
+// the integrand at point i.
+template<typename F>
+class Values {
+public:
+  explicit Values(const F &func) : f(func) {}
+  double operator[](long i) const { return f(i); }
+private:
+  F f;
+};
+
+template<typename F>
+inline double sum_of(long n, const F &f) {
+  return deterministic_sum<double>(n, Values<F>(f));
+}
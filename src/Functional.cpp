@@ -17,6 +17,7 @@
 #include "Functionals.h"
 #include "handymath.h"
 #include "Grid.h"
+#include "FieldThreads.h"
 
 bool FunctionalInterface::I_have_analytic_grad() const {
   return true;
@@ -65,7 +66,21 @@ void FunctionalInterface::print_summary(const char *prefix, double e, std::strin
 }
 
 double FunctionalInterface::integral(const GridDescription &gd, double kT, const VectorXd &x) const {
-  return transform(gd, kT, x).sum()*gd.dvolume;
+  const VectorXd t = transform(gd, kT, x);
+  return deterministic_sum<double>(t.rows(), t.data())*gd.dvolume;
+}
+
+void FunctionalInterface::transform_add(const GridDescription &gd, double kT, const VectorXd &x,
+                                        VectorXd *out) const {
+  *out += transform(gd, kT, x);
+}
+
+double FunctionalInterface::integral_and_grad(const GridDescription &gd, double kT, const VectorXd &x,
+                                              const VectorXd &ingrad, VectorXd *outgrad,
+                                              VectorXd *outpgrad) const {
+  const double e = integral(gd, kT, x);
+  grad(gd, kT, x, ingrad, outgrad, outpgrad);
+  return e;
 }
 
 // The following is a "fake" functional, used for dumping code to
@@ -140,6 +155,19 @@ int Functional::run_finite_difference_test(const char *testname, double temp, co
       retval++;
     }
 
+    // integral_and_grad() should agree with integral() and
+    // integralgrad(), since it does the same work in one pass.
+    VectorXd fused_grad(x);
+    fused_grad.setZero();
+    const double Efused = integral_and_grad(temp, x, &fused_grad);
+    const double lderiv_fused = my_direction.dot(fused_grad);
+    if (fabs(Efused - Eold) > 1e-12*fabs(Eold) || fabs(lderiv_fused/lderiv - 1) > 1e-12) {
+      printf("Different results from integral_and_grad() and integral()/integralgrad()\n");
+      printf("FAIL: Energy error is %g and gradient error is %g\n\n",
+             Efused - Eold, lderiv_fused/lderiv - 1);
+      retval++;
+    }
+
     if (I_have_analytic_grad()) {
       // We have an analytic grad, so let's make sure it matches the
       // other one...
@@ -324,6 +352,9 @@ public:
   VectorXd transform(const GridDescription &gd, double, const VectorXd &) const {
     return gd.dvolume*VectorXd::Ones(gd.NxNyNz);
   }
+  void transform_add(const GridDescription &gd, double, const VectorXd &, VectorXd *out) const {
+    out->cwise() += gd.dvolume;
+  }
   double transform(double, double) const {
     return 1;
   }
@@ -358,6 +389,9 @@ public:
   VectorXd transform(const GridDescription &, double, const VectorXd &data) const {
     return c*VectorXd::Ones(data.rows());
   }
+  void transform_add(const GridDescription &, double, const VectorXd &, VectorXd *out) const {
+    out->cwise() += c;
+  }
   double transform(double, double) const {
     return c;
   }
@@ -410,6 +444,9 @@ public:
   VectorXd transform(const GridDescription &, double, const VectorXd &) const {
     return c;
   }
+  void transform_add(const GridDescription &, double, const VectorXd &, VectorXd *out) const {
+    *out += c;
+  }
   double transform(double, double) const {
     return c.sum()/c.rows();
   }
@@ -477,18 +514,23 @@ public:
     // the sum, just in case we want to print it!
     VectorXd f2data(f2(gd, kT, data));
     VectorXd f1f2data(f1.justMe(gd, kT, f2data));
-    double e = gd.dvolume*f1f2data.sum();
+    double e = gd.dvolume*deterministic_sum<double>(f1f2data.rows(), f1f2data.data());
     f1.set_last_energy(e);
     Functional *nxt = f1.next();
     while (nxt) {
-      f1f2data += nxt->justMe(gd, kT, f2data);
-      double etot = gd.dvolume*f1f2data.sum();
+      nxt->justMeAdd(gd, kT, f2data, &f1f2data);
+      double etot = gd.dvolume*deterministic_sum<double>(f1f2data.rows(), f1f2data.data());
       nxt->set_last_energy(etot - e);
       e = etot;
       nxt = nxt->next();
     }
     return f1f2data;
   }
+  void transform_add(const GridDescription &gd, double kT, const VectorXd &data,
+                     VectorXd *out) const {
+    if (!f1.next()) f1.justMeAdd(gd, kT, f2(gd, kT, data), out);
+    else *out += transform(gd, kT, data);
+  }
   double transform(double kT, double n) const {
     return f1(kT, f2(kT, n));
   }
@@ -521,6 +563,19 @@ public:
     f1.grad(gd, kT, f2(gd, kT, data), ingrad, &outgrad1, 0);
     f2.grad(gd, kT, data, outgrad1, outgrad, outpgrad);
   }
+  double integral_and_grad(const GridDescription &gd, double kT, const VectorXd &data,
+                           const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const {
+    // We only need to evaluate f2 once for both the energy and the
+    // gradient.  f1 adds up (and saves) the energies of its terms one
+    // at a time and in order, just as integral() does above, so the
+    // energy is the same to the last bit whether or not f1 is a sum.
+    VectorXd f2data(f2(gd, kT, data));
+    Grid outgrad1(gd);
+    outgrad1.setZero();
+    double e = f1.integral_and_grad(gd, kT, f2data, ingrad, &outgrad1, 0);
+    f2.grad(gd, kT, data, outgrad1, outgrad, outpgrad);
+    return e;
+  }
   void print_summary(const char *prefix, double e, std::string name) const {
     f1.print_summary(prefix, e, name);
   }
@@ -552,6 +607,10 @@ public:
   VectorXd transform(const GridDescription &gd, double kT, const VectorXd &data) const {
     return f1(gd, kT, data).cwise()/f2(gd, kT, data);
   }
+  void transform_add(const GridDescription &gd, double kT, const VectorXd &data,
+                     VectorXd *out) const {
+    *out += f1(gd, kT, data).cwise()/f2(gd, kT, data);
+  }
   double transform(double kT, double n) const {
     return f1(kT, n)/f2(kT, n);
   }
@@ -576,6 +635,18 @@ public:
     f2.grad(gd, kT, data, (ingrad.cwise()*f1(gd, kT, data)).cwise()/((-out2).cwise()*out2),
             outgrad, outpgrad);
   }
+  // f1 and f2 are each needed for both the energy and the gradient, so
+  // we evaluate them just once.
+  double integral_and_grad(const GridDescription &gd, double kT, const VectorXd &data,
+                           const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const {
+    const VectorXd out1 = f1(gd, kT, data), out2 = f2(gd, kT, data);
+    const VectorXd t = out1.cwise()/out2;
+    const double e = deterministic_sum<double>(t.rows(), t.data())*gd.dvolume;
+    f1.grad(gd, kT, data, ingrad.cwise()/out2, outgrad, outpgrad);
+    f2.grad(gd, kT, data, (ingrad.cwise()*out1).cwise()/((-out2).cwise()*out2),
+            outgrad, outpgrad);
+    return e;
+  }
   bool I_have_analytic_grad() const {
     return f1.I_have_analytic_grad() && f2.I_have_analytic_grad();
   }
@@ -605,6 +676,10 @@ public:
   VectorXd transform(const GridDescription &gd, double kT, const VectorXd &data) const {
     return f1(gd, kT, data).cwise()*f2(gd, kT, data);
   }
+  void transform_add(const GridDescription &gd, double kT, const VectorXd &data,
+                     VectorXd *out) const {
+    *out += f1(gd, kT, data).cwise()*f2(gd, kT, data);
+  }
   double transform(double kT, double n) const {
     return f1(kT, n)*f2(kT, n);
   }
@@ -625,6 +700,17 @@ public:
     f1.grad(gd, kT, data, ingrad.cwise()*f2(gd, kT, data), outgrad, outpgrad);
     f2.grad(gd, kT, data, ingrad.cwise()*f1(gd, kT, data), outgrad, outpgrad);
   }
+  // f1 and f2 are each needed for both the energy and the gradient, so
+  // we evaluate them just once.
+  double integral_and_grad(const GridDescription &gd, double kT, const VectorXd &data,
+                           const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const {
+    const VectorXd out1 = f1(gd, kT, data), out2 = f2(gd, kT, data);
+    const VectorXd t = out1.cwise()*out2;
+    const double e = deterministic_sum<double>(t.rows(), t.data())*gd.dvolume;
+    f1.grad(gd, kT, data, ingrad.cwise()*out2, outgrad, outpgrad);
+    f2.grad(gd, kT, data, ingrad.cwise()*out1, outgrad, outpgrad);
+    return e;
+  }
   bool I_have_analytic_grad() const {
     return f1.I_have_analytic_grad() && f2.I_have_analytic_grad();
   }
@@ -648,6 +734,9 @@ public:
   VectorXd transform(const GridDescription &, double, const VectorXd &data) const {
     return data.cwise().log();
   }
+  void transform_add(const GridDescription &, double, const VectorXd &data, VectorXd *out) const {
+    *out += data.cwise().log();
+  }
   double transform(double, double n) const {
     return log(n);
   }
@@ -668,6 +757,18 @@ public:
     *outgrad += ingrad.cwise()/data;
     if (outpgrad) *outpgrad += ingrad.cwise()/data;
   }
+  // We compute the field and the gradient in one pass over the data.
+  double integral_and_grad(const GridDescription &gd, double, const VectorXd &data,
+                           const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const {
+    VectorXd t(data.rows());
+    for (int i=0; i<data.rows(); i++) {
+      t[i] = log(data[i]);
+      const double g = ingrad[i]/data[i];
+      (*outgrad)[i] += g;
+      if (outpgrad) (*outpgrad)[i] += g;
+    }
+    return deterministic_sum<double>(t.rows(), t.data())*gd.dvolume;
+  }
 };
 
 Functional log(const Functional &f) {
@@ -682,6 +783,9 @@ public:
   VectorXd transform(const GridDescription &, double, const VectorXd &data) const {
     return data.cwise().exp();
   }
+  void transform_add(const GridDescription &, double, const VectorXd &data, VectorXd *out) const {
+    *out += data.cwise().exp();
+  }
   double transform(double, double n) const {
     return exp(n);
   }
@@ -702,6 +806,15 @@ public:
     *outgrad += ingrad.cwise() * data.cwise().exp();
     if (outpgrad) *outpgrad += ingrad.cwise() * data.cwise().exp();
   }
+  // The exponential is both the field and (times ingrad) the gradient,
+  // so we compute it just once.
+  double integral_and_grad(const GridDescription &gd, double, const VectorXd &data,
+                           const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const {
+    const VectorXd t = data.cwise().exp();
+    *outgrad += ingrad.cwise() * t;
+    if (outpgrad) *outpgrad += ingrad.cwise() * t;
+    return deterministic_sum<double>(t.rows(), t.data())*gd.dvolume;
+  }
 };
 
 Functional exp(const Functional &f) {
@@ -716,6 +829,9 @@ public:
   VectorXd transform(const GridDescription &, double, const VectorXd &data) const {
     return data.cwise().abs();
   }
+  void transform_add(const GridDescription &, double, const VectorXd &data, VectorXd *out) const {
+    *out += data.cwise().abs();
+  }
   double transform(double, double n) const {
     return fabs(n);
   }
@@ -2,7 +2,10 @@
 
 #pragma once
 
+#include <vector>
 #include "ReciprocalGrid.h"
+#include "KernelCache.h"
+#include "ConvolutionMemo.h"
 
 class Functional;
 
@@ -15,6 +18,10 @@ public:
   virtual double integral(const GridDescription &gd, double kT, const VectorXd &data) const;
   virtual VectorXd transform(const GridDescription &gd, double kT, const VectorXd &data) const = 0;
   virtual double transform(double kT, double x) const = 0;
+  // transform_add adds our field to *out, so the terms of a sum can
+  // accumulate into one array, rather than each creating its own.
+  virtual void transform_add(const GridDescription &gd, double kT, const VectorXd &data,
+                             VectorXd *out) const;
 
   virtual void pgrad(const GridDescription &gd, double kT, const VectorXd &x,
                      const VectorXd &ingrad, VectorXd *outpgrad) const;
@@ -23,6 +30,11 @@ public:
   // its output field (i.e. it applies the chain rule).
   virtual void grad(const GridDescription &gd, double kT, const VectorXd &data,
                     const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const = 0;
+  // This returns the integral and adds its gradient to outgrad (and
+  // outpgrad), where ingrad is gd.dvolume everywhere.  Override it
+  // when the two share work that needn't be done twice.
+  virtual double integral_and_grad(const GridDescription &gd, double kT, const VectorXd &data,
+                                   const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const;
   virtual double derive(double kT, double data) const = 0;
   virtual double d_by_dT(double kT, double data) const = 0;
   virtual Functional grad(const Functional &ingrad, const Functional &x, bool ispgrad) const = 0;
@@ -52,11 +64,11 @@ public:
   explicit Functional(Derived (*f)(const GridDescription &, extra), extra e,
                       bool iseven)
     : itsCounter(0) {
-    Lattice lat(Cartesian(1,0,0), Cartesian(0,1,0), Cartesian(0,0,1));
-    GridDescription gd(lat, 2, 2, 2);
-    // This handles constant ephemeral fields!
-    std::string n = f(gd, e).name();
-    init(new ConvolveWith<Derived,extra>(f,e,iseven), n);
+    // This handles constant ephemeral fields!  We get the name from
+    // the kernel type, since creating a kernel requires a
+    // GridDescription, and we don't want to construct one (much less
+    // plan any ffts) just to name a Functional.
+    init(new ConvolveWith<Derived,extra>(f,e,iseven), Derived::kernel_name());
   }
   explicit Functional(FunctionalInterface* p = 0, const std::string name = "") // allocate a new counter
     : itsCounter(0) {
@@ -108,6 +120,9 @@ public:
   VectorXd justMe(const GridDescription &gd, double kT, const VectorXd &data) const {
     return itsCounter->ptr->transform(gd, kT, data);
   }
+  void justMeAdd(const GridDescription &gd, double kT, const VectorXd &data, VectorXd *out) const {
+    itsCounter->ptr->transform_add(gd, kT, data, out);
+  }
   double justMeIntegral(const GridDescription &gd, double kT, const VectorXd &data) const {
     return itsCounter->ptr->integral(gd, kT, data);
   }
@@ -115,8 +130,15 @@ public:
     return (*this)(gd, kT, data);
   }
   VectorXd operator()(const GridDescription &gd, double kT, const VectorXd &data) const {
-    VectorXd out = itsCounter->ptr->transform(gd, kT, data);
-    if (mynext) out += (*mynext)(gd, kT, data);
+    ConvolutionMemoScope scope; // share convolutions among our terms
+    if (!mynext) return itsCounter->ptr->transform(gd, kT, data);
+    // Every term of the sum adds itself into one output, rather than
+    // each term holding the sum of those after it.  Starting from the
+    // last term adds them up exactly as that recursion did.
+    std::vector<const Functional *> terms;
+    for (const Functional *nxt = this; nxt; nxt = nxt->next()) terms.push_back(nxt);
+    VectorXd out = terms.back()->justMe(gd, kT, data);
+    for (int i=int(terms.size())-2; i>=0; i--) terms[i]->justMeAdd(gd, kT, data, &out);
     return out;
   }
   VectorXd operator()(double kT, const Grid &g) const {
@@ -129,6 +151,7 @@ public:
     return integral(gd, kT, data);
   }
   double integral(const GridDescription &gd, double kT, const VectorXd &data) const {
+    ConvolutionMemoScope scope;
     // This takes care to save the energies of each term in the sum.
     double e = itsCounter->ptr->integral(gd, kT, data);
     set_last_energy(e);
@@ -147,6 +170,32 @@ public:
   void integralgrad(double kT, const GridDescription &gd, const VectorXd &x, VectorXd *g, VectorXd *pg=0) const {
     grad(kT, gd, x, gd.dvolume*VectorXd::Ones(gd.NxNyNz), g, pg);
   }
+  // integral_and_grad returns the same energy as integral(), and adds
+  // the same gradient to *g (and *pg) as integralgrad(), but visits
+  // each term of the sum just once, so work shared by a term's energy
+  // and gradient (such as the inner functional of a composition) is
+  // done once, and the ingrad of dvolume is created once for them all.
+  double integral_and_grad(double kT, const Grid &g, VectorXd *gr, VectorXd *pg=0) const {
+    return integral_and_grad(kT, g.description(), g, gr, pg);
+  }
+  double integral_and_grad(double kT, const GridDescription &gd, const VectorXd &x,
+                           VectorXd *g, VectorXd *pg=0) const {
+    return integral_and_grad(gd, kT, x, gd.dvolume*VectorXd::Ones(gd.NxNyNz), g, pg);
+  }
+  double integral_and_grad(const GridDescription &gd, double kT, const VectorXd &data,
+                           const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const {
+    ConvolutionMemoScope scope;
+    double e = itsCounter->ptr->integral_and_grad(gd, kT, data, ingrad, outgrad, outpgrad);
+    set_last_energy(e);
+    Functional *nxt = next();
+    while (nxt) {
+      double enext = nxt->itsCounter->ptr->integral_and_grad(gd, kT, data, ingrad, outgrad, outpgrad);
+      nxt->set_last_energy(enext);
+      e += enext;
+      nxt = nxt->next();
+    }
+    return e;
+  }
   void integralpgrad(double kT, const Grid &g, VectorXd *gr) const {
     pgrad(kT, g.description(), g, g.description().dvolume*VectorXd::Ones(g.description().NxNyNz), gr);
   }
@@ -183,6 +232,7 @@ public:
   }
   void grad(const GridDescription &gd, double kT, const VectorXd &data,
             const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const {
+    ConvolutionMemoScope scope;
     itsCounter->ptr->grad(gd, kT, data, ingrad, outgrad, outpgrad);
     if (mynext) mynext->grad(gd, kT, data, ingrad, outgrad, outpgrad);
   }
@@ -192,6 +242,7 @@ public:
   }
   void pgrad(const GridDescription &gd, double kT, const VectorXd &data,
              const VectorXd &ingrad, VectorXd *outpgrad) const {
+    ConvolutionMemoScope scope;
     itsCounter->ptr->pgrad(gd, kT, data, ingrad, outpgrad);
     if (mynext) mynext->pgrad(gd, kT, data, ingrad, outpgrad);
   }
@@ -360,9 +411,10 @@ class ConvolveWith : public FunctionalInterface {
 public:
   ConvolveWith(Derived (*ff)(const GridDescription &, extra),
                extra e, bool isev)
-    : f(ff), data(e), iseven(isev) {}
+    : f(ff), data(e), iseven(isev), have_gzero(false), gzero_value(0) {}
   ConvolveWith(const ConvolveWith &cw)
-    : f(cw.f), data(cw.data), iseven(cw.iseven) {}
+    : f(cw.f), data(cw.data), iseven(cw.iseven),
+      have_gzero(cw.have_gzero), gzero_value(cw.gzero_value) {}
   bool I_am_local() const {
     return false;
   }
@@ -374,15 +426,19 @@ public:
   }
 
   EIGEN_STRONG_INLINE VectorXd transform(const GridDescription &gd, double, const VectorXd &x) const {
-    Grid out(gd, x);
-    ReciprocalGrid recip = out.fft();
-    recip.cwise() *= Eigen::CwiseNullaryOp<Derived, VectorXcd>(gd.NxNyNzOver2, 1, f(gd, data));
-    return recip.ifft();
+    return convolve(gd, x);
   }
+  // gzero is needed for every homogeneous evaluation, so we compute it
+  // just once.  The k=0 value doesn't depend on the grid, so any grid
+  // will do.
   double gzero() const {
-    Lattice lat(Cartesian(1,0,0), Cartesian(0,1,0), Cartesian(0,0,1));
-    GridDescription gd(lat, 2, 2, 2);
-    return f(gd, data).func(Reciprocal(0,0,0)).real();
+    if (!have_gzero) {
+      Lattice lat(Cartesian(1,0,0), Cartesian(0,1,0), Cartesian(0,0,1));
+      GridDescription gd(lat, 2, 2, 2);
+      gzero_value = f(gd, data).func(Reciprocal(0,0,0)).real();
+      have_gzero = true;
+    }
+    return gzero_value;
   }
   double transform(double, double n) const {
     return n*gzero();
@@ -406,17 +462,34 @@ public:
   }
   EIGEN_STRONG_INLINE void grad(const GridDescription &gd, double, const VectorXd &,
                                 const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const {
-    Grid out(gd, ingrad);
-    ReciprocalGrid recip = out.fft();
-    recip.cwise() *= Eigen::CwiseNullaryOp<Derived, VectorXcd>(gd.NxNyNzOver2, 1, f(gd, data));
-    if (iseven) out = recip.ifft();
-    else out = -recip.ifft();
+    VectorXd out = convolve(gd, ingrad);
+    if (!iseven) out *= -1;
     *outgrad += out;
     // FIXME: we will want to propogate preexisting preconditioning
     if (outpgrad) *outpgrad += out;
   }
 private:
+  // convolve transforms in place, so that we only need one array for
+  // the field in both real and reciprocal space.  The kernel itself
+  // comes from the kernel cache, so we only evaluate it once per grid,
+  // and the result is memoized, so that other terms convolving the
+  // same field with the same kernel needn't do so again.
+  VectorXd convolve(const GridDescription &gd, const VectorXd &x) const {
+    ConvolutionMemo memo(gd, reinterpret_cast<KernelFunction>(f), data, x);
+    if (memo.found()) return memo.result();
+    VectorXcd padded;
+    pad_for_fft(gd, x, &padded);
+    fft_in_place(gd, &padded);
+    padded.cwise() *= *cached_kernel(gd, f, data);
+    ifft_in_place(gd, &padded);
+    VectorXd out;
+    unpad_from_fft(gd, padded, &out);
+    memo.remember(out);
+    return out;
+  }
   Derived (*f)(const GridDescription &, extra);
   extra data;
   bool iseven;
+  mutable bool have_gzero;
+  mutable double gzero_value;
 };
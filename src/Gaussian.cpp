@@ -16,13 +16,13 @@
 
 #include "Functionals.h"
 #include "ReciprocalGrid.h"
+#include "KernelCache.h"
 #include <stdio.h>
 
 class GaussianType : public FunctionalInterface {
 public:
   GaussianType(double w) {
     width = w;
-    kfac = -0.5*width*width; // FIXME: get width right in k space!
   }
   bool append_to_name(const std::string) {
     return true;
@@ -34,7 +34,7 @@ public:
   VectorXd transform(const GridDescription &gd, double, const VectorXd &data) const {
     Grid out(gd, data);
     ReciprocalGrid recip = out.fft();
-    recip.cwise() *= (kfac*g2(gd)).cwise().exp();
+    recip.cwise() *= *kernel(gd);
     return recip.ifft();
   }
   double transform(double, double n) const {
@@ -56,7 +56,7 @@ public:
             const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const {
     Grid out(gd, ingrad);
     ReciprocalGrid recip = out.fft();
-    recip.cwise() *= (kfac*g2(gd)).cwise().exp();
+    recip.cwise() *= *kernel(gd);
     out = recip.ifft();
     *outgrad += out;
 
@@ -64,7 +64,12 @@ public:
     if (outpgrad) *outpgrad += out;
   }
 private:
-  double width, kfac;
+  // kernel returns exp(-k^2 width^2/2), from the kernel cache.
+  // FIXME: get width right in k space!
+  KernelPtr kernel(const GridDescription &gd) const {
+    return cached_kernel(gd, function_for_convolve<gaussian_op<complex> >, width);
+  }
+  double width;
 };
 
 Functional Gaussian(double width) {
@@ -2,36 +2,31 @@
 #include "ReciprocalGrid.h"
 #include "handymath.h"
 #include "Functionals.h"
-#include <fftw3.h>
+#include "FFTPlanCache.h"
+#include "interpolation.h"
+#include "FieldFile.h"
 
 double Grid::operator()(const Relative &r) const {
-  double rx = r(0)*gd.Nx, ry = r(1)*gd.Ny, rz = r(2)*gd.Nz;
-  int ix = floor(rx), iy = floor(ry), iz = floor(rz);
-  double wx = rx-ix, wy = ry-iy, wz = rz-iz;
-  while (ix < 0) ix += gd.Nx;
-  while (iy < 0) iy += gd.Ny;
-  while (iz < 0) iz += gd.Nz;
-  while (ix >= gd.Nx) ix -= gd.Nx;
-  while (iy >= gd.Ny) iy -= gd.Ny;
-  while (iz >= gd.Nz) iz -= gd.Nz;
-  int ixp1 = (ix+1)%gd.Nx, iyp1 = (iy+1)%gd.Ny, izp1 = (iz+1)%gd.Nz;
-  while (ixp1 < 0) ixp1 += gd.Nx;
-  while (iyp1 < 0) iyp1 += gd.Ny;
-  while (izp1 < 0) izp1 += gd.Nz;
-  while (ixp1 >= gd.Nx) ixp1 -= gd.Nx;
-  while (iyp1 >= gd.Ny) iyp1 -= gd.Ny;
-  while (izp1 >= gd.Nz) izp1 -= gd.Nz;
-  assert(wx>=0);
-  assert(wy>=0);
-  assert(wz>=0);
-  return (1-wx)*(1-wy)*(1-wz)*(*this)(ix,iy,iz)
-    + wx*(1-wy)*(1-wz)*(*this)(ixp1,iy,iz)
-    + (1-wx)*wy*(1-wz)*(*this)(ix,iyp1,iz)
-    + (1-wx)*(1-wy)*wz*(*this)(ix,iy,izp1)
-    + wx*(1-wy)*wz*(*this)(ixp1,iy,izp1)
-    + (1-wx)*wy*wz*(*this)(ix,iyp1,izp1)
-    + wx*wy*(1-wz)*(*this)(ixp1,iyp1,iz)
-    + wx*wy*wz*(*this)(ixp1,iyp1,izp1);
+  return trilinear(data(), gd.Nx, gd.Ny, gd.Nz, r(0), r(1), r(2));
+}
+
+VectorXd Grid::Interpolate(const VectorXd &x, const VectorXd &y, const VectorXd &z) const {
+  assert(x.rows() == y.rows() && x.rows() == z.rows());
+  VectorXd out(x.rows());
+  const double *f = data();
+  for (int i=0; i<x.rows(); i++) out[i] = trilinear(f, gd.Nx, gd.Ny, gd.Nz, x[i], y[i], z[i]);
+  return out;
+}
+
+Grid Grid::Resample(const GridDescription &newgd) const {
+  assert((newgd.Lat.a1() - gd.Lat.a1()).norm() < 1e-12*gd.Lat.a1().norm());
+  assert((newgd.Lat.a2() - gd.Lat.a2()).norm() < 1e-12*gd.Lat.a2().norm());
+  assert((newgd.Lat.a3() - gd.Lat.a3()).norm() < 1e-12*gd.Lat.a3().norm());
+  const ReciprocalGrid recip = fft();
+  ReciprocalGrid newrecip(newgd);
+  spectral_resample(gd.Nx, gd.Ny, gd.Nz, recip.data(),
+                    newgd.Nx, newgd.Ny, newgd.Nz, newrecip.data());
+  return newrecip.ifft();
 }
 
 Grid::Grid(const GridDescription &gdin) : VectorXd(gdin.NxNyNz), gd(gdin) {
@@ -41,14 +36,47 @@ Grid::Grid(const Grid &x) : VectorXd(x), gd(x.gd) {
 }
 
 void Grid::Set(double f(Cartesian)) {
-  for (int x=0; x<gd.Nx; x++) {
-    for (int y=0; y<gd.Ny; y++) {
-      for (int z=0; z<gd.Nz; z++) {
-        Cartesian h(gd.Lat.wignerSeitz(gd.Lat.toCartesian(Relative(x*gd.dx,y*gd.dy,z*gd.dz))));
-        (*this)(x,y,z) = f(h);
-      }
+  const CoordinatePtr r = wigner_seitz_coordinates(gd);
+  for (int i=0; i<gd.NxNyNz; i++) (*this)[i] = f((*r)[i]);
+}
+
+bool Grid::DumpBinary(const char *fname) const {
+  FieldFileInfo info;
+  info.Nx = gd.Nx;
+  info.Ny = gd.Ny;
+  info.Nz = gd.Nz;
+  info.size = gd.NxNyNz;
+  const Cartesian a[3] = { gd.Lat.a1(), gd.Lat.a2(), gd.Lat.a3() };
+  for (int i=0; i<3; i++) {
+    for (int j=0; j<3; j++) info.lattice[i][j] = a[i](j);
+  }
+  return write_field_file(fname, info, data());
+}
+
+bool Grid::LoadBinary(const char *fname) {
+  MappedFieldFile file(fname);
+  if (!file.ok()) return false;
+  const FieldFileInfo &info = file.info();
+  const Cartesian a[3] = { gd.Lat.a1(), gd.Lat.a2(), gd.Lat.a3() };
+  for (int i=0; i<3; i++) {
+    const Cartesian ai(info.lattice[i][0], info.lattice[i][1], info.lattice[i][2]);
+    if ((ai - a[i]).norm() > 1e-12*a[i].norm()) {
+      fprintf(stderr, "%s is for a different lattice!\n", fname);
+      return false;
     }
   }
+  if (info.size != info.Nx*info.Ny*info.Nz) {
+    fprintf(stderr, "%s doesn't hold a single field!\n", fname);
+    return false;
+  }
+  if (info.Nx == gd.Nx && info.Ny == gd.Ny && info.Nz == gd.Nz) {
+    memcpy(data(), file.data(), gd.NxNyNz*sizeof(double));
+  } else {
+    Grid original(GridDescription(gd.Lat, info.Nx, info.Ny, info.Nz));
+    memcpy(original.data(), file.data(), info.size*sizeof(double));
+    *this = original.Resample(gd);
+  }
+  return true;
 }
 
 void Grid::epsSlice(const char *fname,
@@ -470,33 +498,112 @@ ReciprocalGrid Grid::fft() const {
 ReciprocalGrid fft(const GridDescription &gd, const VectorXd &g) {
   ReciprocalGrid out(gd);
   const double *mydata = g.data();
-  fftw_plan p = fftw_plan_dft_r2c_3d(gd.Nx, gd.Ny, gd.Nz, (double *)mydata, (fftw_complex *)out.data(), FFTW_MEASURE);
-  fftw_execute(p);
-  fftw_destroy_plan(p);
+  fft_r2c_3d(gd.Nx, gd.Ny, gd.Nz, (double *)mydata, (fftw_complex *)out.data());
   out *= gd.dvolume;
   return out;
 }
 
-void Grid::ShellProjection(const VectorXd &R, VectorXd *output) const {
-  output->setZero();
-  VectorXd norm(*output);
-  const double wid = 0.5*pow(gd.fineLat.volume(), 1.0/3);
+void pad_for_fft(const GridDescription &gd, const VectorXd &g, VectorXcd *padded) {
+  padded->resize(gd.NxNyNzOver2);
+  double *p = (double *)padded->data();
+  const double *mydata = g.data();
+  for (int row=0; row<gd.Nx*gd.Ny; row++) {
+    memcpy(p + row*2*gd.NzOver2, mydata + row*gd.Nz, gd.Nz*sizeof(double));
+  }
+}
+
+void unpad_from_fft(const GridDescription &gd, const VectorXcd &padded, VectorXd *g) {
+  g->resize(gd.NxNyNz);
+  const double *p = (const double *)padded.data();
+  double *mydata = g->data();
+  for (int row=0; row<gd.Nx*gd.Ny; row++) {
+    memcpy(mydata + row*gd.Nz, p + row*2*gd.NzOver2, gd.Nz*sizeof(double));
+  }
+}
+
+void fft_in_place(const GridDescription &gd, VectorXcd *padded) {
+  fftw_complex *p = (fftw_complex *)padded->data();
+  fft_r2c_3d(gd.Nx, gd.Ny, gd.Nz, (double *)p, p);
+  *padded *= gd.dvolume;
+}
+
+// RadialBins sums the grid over spherical shells of width dr about the
+// origin, in a single pass over the grid.  Shell i holds the points
+// with i*dr <= r < (i+1)*dr, and we record the number of points in
+// it, the sum of their values, and the sum of their radii.
+void Grid::RadialBins(double dr, std::vector<double> *counts, std::vector<double> *sums,
+                      std::vector<double> *rsums) const {
+  counts->clear();
+  sums->clear();
+  rsums->clear();
+  const CoordinatePtr coords = wigner_seitz_coordinates(gd);
+  for (int i=0; i<gd.NxNyNz; i++) {
+    const double r = (*coords)[i].norm();
+    const unsigned bin = unsigned(r/dr);
+    if (bin >= counts->size()) {
+      counts->resize(bin+1, 0);
+      sums->resize(bin+1, 0);
+      rsums->resize(bin+1, 0);
+    }
+    (*counts)[bin] += 1;
+    (*sums)[bin] += (*this)[i];
+    (*rsums)[bin] += r;
+  }
+}
+
+// smooth_bins projects the shells found by RadialBins onto the radii R
+// with a gaussian of width wid, treating each shell as though all its
+// points were at their mean radius.  A radius with no points within
+// 3*wid gives a NaN.
+static void smooth_bins(double dr, const std::vector<double> &counts,
+                        const std::vector<double> &sums, const std::vector<double> &rsums,
+                        const VectorXd &R, double wid, VectorXd *output) {
   const double oowid2 = 1/(wid*wid);
-  for (int x=0; x<gd.Nx; x++) {
-    for (int y=0; y<gd.Ny; y++) { 
-      for (int z=0; z<gd.Nz; z++) {
-        Cartesian h(gd.Lat.wignerSeitz(gd.Lat.toCartesian(Relative(x*gd.dx,y*gd.dy,z*gd.dz))));
-        double r = h.norm();
-        for (int ir=0;ir<R.rows();ir++) {
-          double dr = fabs(r-R[ir]);
-          if (dr < 3*wid) {
-            double w = exp(-oowid2*dr*dr);
-            norm[ir] += w;
-            (*output)[ir] += w*(*this)(x,y,z);
-          }
-        }
+  const int nbins = counts.size();
+  for (int ir=0; ir<R.rows(); ir++) {
+    const int lo = std::max(0, int(floor((R[ir] - 3*wid)/dr)));
+    const int hi = std::min(nbins - 1, int(ceil((R[ir] + 3*wid)/dr)));
+    double norm = 0, total = 0;
+    for (int b=lo; b<=hi; b++) {
+      if (counts[b] == 0) continue;
+      const double dist = fabs(rsums[b]/counts[b] - R[ir]);
+      if (dist < 3*wid) {
+        const double w = exp(-oowid2*dist*dist);
+        norm += w*counts[b];
+        total += w*sums[b];
       }
     }
+    (*output)[ir] = total/norm;
+  }
+}
+
+// ShellProjection averages the grid over shells at radii R, weighting
+// each point with a gaussian of its distance from the shell.  Rather
+// than visiting every grid point for every radius, we first bin the
+// grid into shells much finer than the gaussian, so the cost is linear
+// in the size of the grid, and the error is of order (wid/20)^2.
+void Grid::ShellProjection(const VectorXd &R, VectorXd *output) const {
+  const double wid = 0.5*pow(gd.fineLat.volume(), 1.0/3);
+  const double dr = 0.05*wid;
+  std::vector<double> counts, sums, rsums;
+  RadialBins(dr, &counts, &sums, &rsums);
+  smooth_bins(dr, counts, sums, rsums, R, wid, output);
+}
+
+void Grid::RadialAverage(double dr, VectorXd *output, double smoothing) const {
+  std::vector<double> counts, sums, rsums;
+  if (smoothing > 0) {
+    const double bin_width = std::min(dr, 0.05*smoothing);
+    RadialBins(bin_width, &counts, &sums, &rsums);
+    VectorXd R(int(counts.size()*bin_width/dr) + 1);
+    for (int i=0; i<R.rows(); i++) R[i] = (i + 0.5)*dr;
+    output->resize(R.rows());
+    smooth_bins(bin_width, counts, sums, rsums, R, smoothing, output);
+  } else {
+    RadialBins(dr, &counts, &sums, &rsums);
+    output->resize(counts.size());
+    for (unsigned i=0; i<counts.size(); i++) {
+      (*output)[i] = counts[i] ? sums[i]/counts[i] : 0;
+    }
   }
-  output->cwise() /= norm;
 }
@@ -3,7 +3,9 @@
 #pragma once
 
 #include "GridDescription.h"
+#include "FieldThreads.h"
 #include <stdio.h>
+#include <vector>
 
 #pragma GCC diagnostic push
 #if __GNUC__ > 5
@@ -19,6 +21,17 @@ class ReciprocalGrid;
 
 ReciprocalGrid fft(const GridDescription &gd, const VectorXd &g);
 
+// The following allow a field to be transformed in place, so it only
+// ever needs a single array of gd.NxNyNzOver2 complex numbers.  In
+// real space this array holds the field in fftw's padded layout, in
+// which each row of Nz doubles is followed by two doubles of padding.
+// pad_for_fft copies g into such an array, and unpad_from_fft copies
+// it back out.  fft_in_place and ifft_in_place (in ReciprocalGrid.h)
+// are normalized just like fft and ifft.
+void pad_for_fft(const GridDescription &gd, const VectorXd &g, VectorXcd *padded);
+void unpad_from_fft(const GridDescription &gd, const VectorXcd &padded, VectorXd *g);
+void fft_in_place(const GridDescription &gd, VectorXcd *padded);
+
 class Grid : public VectorXd {
 public:
   explicit Grid(const GridDescription &);
@@ -44,6 +57,13 @@ public:
     return (*this)(gd.Lat.toRelative(r));
   }
   double operator()(const Relative &r) const;
+  // Interpolate finds the values at many points at once, given their
+  // relative coordinates, by the same trilinear interpolation.
+  VectorXd Interpolate(const VectorXd &x, const VectorXd &y, const VectorXd &z) const;
+  // Resample returns this field on another grid over the same
+  // lattice, found by Fourier interpolation, which is exact for a
+  // field with no modes near the Nyquist frequency of either grid.
+  Grid Resample(const GridDescription &newgd) const;
   
   void Set(double f(Cartesian));
   void epsSlice(const char *fname, Cartesian xmax, Cartesian ymax,
@@ -52,17 +72,29 @@ public:
                       Cartesian xmax, Cartesian ymax, Cartesian corner) const;
   void epsNative1d(const char *fname, Cartesian xmin, Cartesian xmax, double yscale = 1, double xscale = 1, const char *comment = 0) const;
   void Dump1D(const char *fname, Cartesian xmin, Cartesian xmax) const;
+  // DumpBinary writes the grid as a field file (see FieldFile.h),
+  // returning false if it couldn't.  LoadBinary reads one back, resampling it if it was written on a
+  // grid of another size over the same lattice.  It returns false
+  // (leaving the grid unchanged) if it can't read the file, or if the
+  // file is for another lattice.
+  bool DumpBinary(const char *fname) const;
+  bool LoadBinary(const char *fname);
   void epsRadial1d(const char *fname, double rmin = 0, double rmax = 0, double yscale = 1, double rscale = 1, const char *comment = 0) const;
   void ShellProjection(const VectorXd &R, VectorXd *output) const;
+  // RadialAverage sets output[i] to the average of the grid over the
+  // spherical shell from i*dr to (i+1)*dr about the origin, out to the
+  // farthest point in the cell, in time linear in the size of the grid.
+  // Shells with no grid points in them get zero.  If smoothing is
+  // positive, the average is instead taken at r = (i+1/2)*dr with a
+  // gaussian weight of that width, as in ShellProjection.
+  void RadialAverage(double dr, VectorXd *output, double smoothing = 0) const;
   double integrate() const {
-    double val = 0;
-    for (int i=0; i<gd.NxNyNz; i++) {
-      val += (*this)[i];
-    }
-    return val*gd.dvolume;
+    return deterministic_sum<double>(gd.NxNyNz, data())*gd.dvolume;
   }
   GridDescription description() const { return gd; }
 private:
+  void RadialBins(double dr, std::vector<double> *counts, std::vector<double> *sums,
+                  std::vector<double> *rsums) const;
   GridDescription gd;
 };
 
@@ -1,7 +1,5 @@
 #include "GridDescription.h"
-#include "Grid.h"
-#include "ReciprocalGrid.h"
-#include <fftw3.h>
+#include "FFTPlanCache.h"
 
 GridDescription::GridDescription(Lattice lat, int nx, int ny, int nz)
   : Lat(lat), fineLat(Cartesian(lat.a1()/nx), Cartesian(lat.a2()/ny),
@@ -11,17 +9,6 @@ GridDescription::GridDescription(Lattice lat, int nx, int ny, int nz)
   NzOver2 = Nz/2 + 1; NyNzOver2 = Ny*NzOver2; NxNyNzOver2 = Nx*NyNzOver2;
   dx = 1.0/Nx; dy = 1.0/Ny; dz = 1.0/Nz;
   dvolume = fineLat.volume();
-
-  // Make a couple of FFTW plans with FFTW_MEASURE, to speed things up
-  // for later...
-  Grid rspace(*this);
-  ReciprocalGrid kspace(*this);
-  fftw_destroy_plan(fftw_plan_dft_r2c_3d(Nx, Ny, Nz, rspace.data(),
-                                         (fftw_complex *)kspace.data(),
-                                         FFTW_MEASURE));
-  fftw_destroy_plan(fftw_plan_dft_c2r_3d(Nx, Ny, Nz,
-                                         (fftw_complex *)kspace.data(),
-                                         rspace.data(), FFTW_MEASURE));
 }
 
 GridDescription::GridDescription(Lattice lat, double delta)
@@ -34,15 +21,8 @@ GridDescription::GridDescription(Lattice lat, double delta)
   NzOver2 = Nz/2 + 1; NyNzOver2 = Ny*NzOver2; NxNyNzOver2 = Nx*NyNzOver2;
   dx = 1.0/Nx; dy = 1.0/Ny; dz = 1.0/Nz;
   dvolume = fineLat.volume();
+}
 
-  // Make a couple of FFTW plans with FFTW_MEASURE, to speed things up
-  // for later...
-  Grid rspace(*this);
-  ReciprocalGrid kspace(*this);
-  fftw_destroy_plan(fftw_plan_dft_r2c_3d(Nx, Ny, Nz, rspace.data(),
-                                         (fftw_complex *)kspace.data(),
-                                         FFTW_MEASURE));
-  fftw_destroy_plan(fftw_plan_dft_c2r_3d(Nx, Ny, Nz,
-                                         (fftw_complex *)kspace.data(),
-                                         rspace.data(), FFTW_MEASURE));
+void GridDescription::plan_ffts() const {
+  plan_fft_3d(Nx, Ny, Nz);
 }
@@ -21,6 +21,12 @@ public:
   explicit GridDescription(Lattice lat, double dx);
   // Default copy constructor is just fine!
 
+  // We don't plan any ffts when a GridDescription is created, since
+  // many are created that are never used for an fft (e.g. by
+  // Functional), and plans are made (and cached) on first use anyway.
+  // Call plan_ffts if you'd rather pay the planning cost up front.
+  void plan_ffts() const;
+
   double dx, dy, dz, dvolume;
   int Nx, Ny, Nz, NyNz, NxNyNz, NzOver2, NyNzOver2, NxNyNzOver2;
   Lattice Lat, fineLat;
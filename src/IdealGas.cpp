@@ -24,6 +24,9 @@ public:
   VectorXd transform(const GridDescription &gd, double kT, const VectorXd &) const {
     return kT*VectorXd::Ones(gd.NxNyNz);
   }
+  void transform_add(const GridDescription &, double kT, const VectorXd &, VectorXd *out) const {
+    out->cwise() += kT;
+  }
   double transform(double kT, double) const {
     return kT;
   }
@@ -0,0 +1,134 @@
+#include "KernelCache.h"
+#include <stdio.h>
+#include <map>
+#include <mutex>
+
+namespace {
+  struct KernelKey {
+    KernelFunction f;
+    double parameter;
+    int Nx, Ny, Nz;
+    double lattice[9];
+    bool operator<(const KernelKey &b) const {
+      if (f != b.f) return std::less<KernelFunction>()(f, b.f);
+      if (parameter != b.parameter) return parameter < b.parameter;
+      if (Nx != b.Nx) return Nx < b.Nx;
+      if (Ny != b.Ny) return Ny < b.Ny;
+      if (Nz != b.Nz) return Nz < b.Nz;
+      for (int i=0; i<9; i++) {
+        if (lattice[i] != b.lattice[i]) return lattice[i] < b.lattice[i];
+      }
+      return false;
+    }
+  };
+
+  struct CachedKernel {
+    KernelPtr values;
+    long bytes;
+    long last_used; // a count of lookups, for finding the least recently used
+  };
+
+  // As in FFTPlanCache, we never free the mutex or the map, so that
+  // convolutions performed by static destructors still work.
+  std::mutex &cache_mutex() {
+    static std::mutex *m = new std::mutex;
+    return *m;
+  }
+  std::map<KernelKey, CachedKernel> &kernels() {
+    static std::map<KernelKey, CachedKernel> *k = new std::map<KernelKey, CachedKernel>;
+    return *k;
+  }
+  long limit = 256*1024*1024;
+  long num_hits = 0, num_misses = 0, num_evictions = 0, total_bytes = 0, use_count = 0;
+
+  KernelKey make_key(const GridDescription &gd, KernelFunction f, double parameter) {
+    KernelKey k;
+    k.f = f;
+    k.parameter = parameter;
+    k.Nx = gd.Nx;
+    k.Ny = gd.Ny;
+    k.Nz = gd.Nz;
+    const Cartesian a[3] = { gd.Lat.a1(), gd.Lat.a2(), gd.Lat.a3() };
+    for (int i=0; i<3; i++) {
+      for (int j=0; j<3; j++) k.lattice[3*i + j] = a[i](j);
+    }
+    return k;
+  }
+
+  // shrink_to must be called with the mutex held.  It forgets the
+  // least recently used kernels until we use at most bytes.
+  void shrink_to(long bytes) {
+    while (total_bytes > bytes) {
+      std::map<KernelKey, CachedKernel>::iterator oldest = kernels().begin();
+      for (std::map<KernelKey, CachedKernel>::iterator i = kernels().begin();
+           i != kernels().end(); ++i) {
+        if (i->second.last_used < oldest->second.last_used) oldest = i;
+      }
+      total_bytes -= oldest->second.bytes;
+      kernels().erase(oldest);
+      num_evictions++;
+    }
+  }
+}
+
+KernelPtr find_cached_kernel(const GridDescription &gd, KernelFunction f, double parameter) {
+  std::lock_guard<std::mutex> lock(cache_mutex());
+  std::map<KernelKey, CachedKernel>::iterator i = kernels().find(make_key(gd, f, parameter));
+  if (i == kernels().end()) return KernelPtr();
+  num_hits++;
+  i->second.last_used = ++use_count;
+  return i->second.values;
+}
+
+KernelPtr cache_kernel(const GridDescription &gd, KernelFunction f, double parameter,
+                       VectorXcd *values) {
+  KernelPtr p(values);
+  const long bytes = values->size()*sizeof(complex);
+  std::lock_guard<std::mutex> lock(cache_mutex());
+  num_misses++;
+  if (bytes > limit) return p; // it would never fit, so don't even try
+  const KernelKey k = make_key(gd, f, parameter);
+  if (kernels().find(k) != kernels().end()) {
+    // Another thread computed this kernel at the same time as we did.
+    return kernels()[k].values;
+  }
+  shrink_to(limit - bytes);
+  CachedKernel &c = kernels()[k];
+  c.values = p;
+  c.bytes = bytes;
+  c.last_used = ++use_count;
+  total_bytes += bytes;
+  return p;
+}
+
+void set_kernel_cache_limit(long bytes) {
+  std::lock_guard<std::mutex> lock(cache_mutex());
+  limit = bytes;
+  shrink_to(limit);
+}
+
+KernelCacheStats kernel_cache_stats() {
+  std::lock_guard<std::mutex> lock(cache_mutex());
+  KernelCacheStats s;
+  s.hits = num_hits;
+  s.misses = num_misses;
+  s.kernels = kernels().size();
+  s.bytes = total_bytes;
+  s.evictions = num_evictions;
+  return s;
+}
+
+void print_kernel_cache_stats(const char *prefix) {
+  KernelCacheStats s = kernel_cache_stats();
+  printf("%skernel cache: %ld hits, %ld misses, %ld kernels using %g M, %ld evictions\n",
+         prefix, s.hits, s.misses, s.kernels, s.bytes/1024.0/1024, s.evictions);
+}
+
+void forget_kernels() {
+  std::lock_guard<std::mutex> lock(cache_mutex());
+  kernels().clear();
+  total_bytes = 0;
+  num_hits = 0;
+  num_misses = 0;
+  num_evictions = 0;
+}
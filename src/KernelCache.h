@@ -0,0 +1,65 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <memory>
+#include "GridDescription.h"
+
+// This file provides a process-wide cache of convolution kernels in
+// reciprocal space.  A kernel such as step_op or shell_op is evaluated
+// at every k point by a virtual function call that decodes the index
+// and calls sin, cos and exp, and yet it depends only on the grid and
+// on its radius.  So rather than evaluating it afresh on every
+// application, ConvolveWith fetches a ready-made array of its values
+// from this cache.
+//
+// A kernel is identified by the function that creates it (e.g.
+// function_for_convolve<step_op<complex> >), its parameter, and the
+// grid: the number of points and the lattice vectors.  Since kernels
+// are as big as a field in reciprocal space, the cache has a limit on
+// the memory it may use, beyond which the least recently used kernels
+// are forgotten.  The cache is protected by a mutex, and hands out
+// shared pointers, so a kernel that is forgotten while in use stays
+// alive until its user is done with it.
+
+typedef std::shared_ptr<const VectorXcd> KernelPtr;
+typedef void (*KernelFunction)();
+
+// find_cached_kernel returns the cached kernel, or an empty pointer if
+// we don't have it.  cache_kernel takes ownership of values, and
+// returns a pointer to them, which may or may not end up in the cache,
+// depending on its size and the limit.
+KernelPtr find_cached_kernel(const GridDescription &gd, KernelFunction f, double parameter);
+KernelPtr cache_kernel(const GridDescription &gd, KernelFunction f, double parameter,
+                       VectorXcd *values);
+
+// cached_kernel returns the values of the kernel f(gd, parameter) at
+// every k point, computing them only if they aren't already cached.
+template<typename Derived, typename extra>
+KernelPtr cached_kernel(const GridDescription &gd, Derived (*f)(const GridDescription &, extra),
+                        extra parameter) {
+  const KernelFunction key = reinterpret_cast<KernelFunction>(f);
+  KernelPtr k = find_cached_kernel(gd, key, parameter);
+  if (k) return k;
+  VectorXcd *values = new VectorXcd(gd.NxNyNzOver2);
+  *values = Eigen::CwiseNullaryOp<Derived, VectorXcd>(gd.NxNyNzOver2, 1, f(gd, parameter));
+  return cache_kernel(gd, key, parameter, values);
+}
+
+// set_kernel_cache_limit sets the most memory (in bytes) that cached
+// kernels may use, forgetting kernels if we are already over the
+// limit.  A limit of zero disables the cache.  The default is 256 MB.
+void set_kernel_cache_limit(long bytes);
+
+struct KernelCacheStats {
+  long hits;      // number of kernels found in the cache
+  long misses;    // number of kernels we had to compute
+  long kernels;   // number of kernels currently held in the cache
+  long bytes;     // memory used by those kernels
+  long evictions; // number of kernels forgotten to stay under the limit
+};
+KernelCacheStats kernel_cache_stats();
+void print_kernel_cache_stats(const char *prefix = "");
+
+// forget_kernels empties the cache and resets the counters.
+void forget_kernels();
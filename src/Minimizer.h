@@ -22,7 +22,7 @@ public: // yuck, this shouldn't be public!
   double kT;
 public:
   MinimizerInterface(Functional myf, const GridDescription &gdin, double kT_in, VectorXd *data)
-    : f(myf), x(data), gd(gdin), kT(kT_in), last_grad(0), last_pgrad(0) {
+    : f(myf), x(data), gd(gdin), kT(kT_in), last_grad(0), last_pgrad(0), last_energy(0) {
     iter = 0;
   }
   virtual ~MinimizerInterface() {
@@ -48,13 +48,28 @@ public:
   // also call it manually.
   virtual void print_info(const char *prefix = "") const;
 
-  // energy returns the current energy.
-  double energy() const { return f.integral(kT, gd, *x); }
+  // energy returns the current energy.  If the gradient is cached,
+  // and x is still where it was computed, the energy was computed
+  // along with it, so we needn't compute it again.  Since energy
+  // checks x, it is right even if x has been changed without a call to
+  // invalidate_cache (as a driver may do between calls to
+  // improve_energy).
+  double energy() const {
+    if (last_grad && x->rows() == last_x.rows() && *x == last_x) return last_energy;
+    return f.integral(kT, gd, *x);
+  }
+  // grad and pgrad compute the energy in the same pass as the gradient
+  // (see Functional::integral_and_grad), and cache it along with them
+  // until invalidate_cache is called.  So a minimizer that wants both
+  // should ask for the gradient first.  Unlike energy, they don't
+  // check x, so anything that changes x must call invalidate_cache
+  // before asking for the gradient again.
   const VectorXd &grad() const {
     if (!last_grad) {
       last_grad = new VectorXd(*x); // hokey
       last_grad->setZero(); // Have to remember to zero it out first!
-      f.integralgrad(kT, gd, *x, last_grad);
+      last_energy = f.integral_and_grad(kT, gd, *x, last_grad);
+      last_x = *x;
     }
     return *last_grad;
   }
@@ -64,7 +79,8 @@ public:
       last_pgrad->setZero(); // Have to remember to zero it out first!
       if (!last_grad) last_grad = new VectorXd(*x); // hokey
       last_grad->setZero(); // Have to remember to zero it out first!
-      f.integralgrad(kT, gd, *x, last_grad, last_pgrad);
+      last_energy = f.integral_and_grad(kT, gd, *x, last_grad, last_pgrad);
+      last_x = *x;
     }
     return *last_pgrad;
   }
@@ -75,9 +91,12 @@ public:
     last_grad = 0;
     delete last_pgrad;
     last_pgrad = 0;
+    last_x.resize(0);
   }
 private:
   mutable VectorXd *last_grad, *last_pgrad;
+  mutable double last_energy; // the energy at last_x
+  mutable VectorXd last_x; // where last_grad was computed
 };
 
 class Minimizer : public MinimizerInterface {
@@ -15,6 +15,7 @@
 // Please see the file AUTHORS for a list of authors.
 
 #include "Functionals.h"
+#include "FieldThreads.h"
 #include <stdio.h>
 
 class PowType : public FunctionalInterface {
@@ -35,6 +36,17 @@ public:
         out[i] *= data[i];
     return out;
   }
+  void transform_add(const GridDescription &gd, double, const VectorXd &data, VectorXd *out) const {
+    switch (n) {
+    case 0: out->cwise() += 1; return;
+    case 1: *out += data; return;
+    }
+    for (int i=0; i<gd.NxNyNz; i++) {
+      double v = data[i];
+      for (int p=1; p < n; p++) v *= data[i];
+      (*out)[i] += v;
+    }
+  }
   double transform(double, double x) const {
     switch (n) {
     case 0: return 1;
@@ -79,6 +91,28 @@ public:
       if (outpgrad) (*outpgrad)[i] += foo;
     }
   }
+  // We compute the field and the gradient in one pass over the data,
+  // and for n = 1 we needn't copy the data at all.
+  double integral_and_grad(const GridDescription &gd, double kT, const VectorXd &data,
+                           const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const {
+    if (n == 0) return FunctionalInterface::integral(gd, kT, data);
+    if (n == 1) {
+      grad(gd, kT, data, ingrad, outgrad, outpgrad);
+      return deterministic_sum<double>(data.rows(), data.data())*gd.dvolume;
+    }
+    VectorXd t(data.rows());
+    for (int i=0; i<gd.NxNyNz; i++) {
+      double v = data[i], foo = n*ingrad[i];
+      for (int p=1; p < n; p++) {
+        v *= data[i];
+        foo *= data[i];
+      }
+      t[i] = v;
+      (*outgrad)[i] += foo;
+      if (outpgrad) (*outpgrad)[i] += foo;
+    }
+    return deterministic_sum<double>(t.rows(), t.data())*gd.dvolume;
+  }
   bool I_give_zero_for_zero() const {
     return n > 0;
   }
@@ -155,6 +189,30 @@ public:
       }
     }
   }
+  // The square root is needed for both the field and the gradient, so
+  // we compute it just once.
+  double integral_and_grad(const GridDescription &gd, double, const VectorXd &data,
+                           const VectorXd &ingrad, VectorXd *outgrad, VectorXd *outpgrad) const {
+    VectorXd t(data.rows());
+    for (int i=0; i<gd.NxNyNz; i++) {
+      const double di = data[i], sqrtdi = sqrt(di);
+      double v = sqrtdi, foo = (n+0.5)*ingrad[i]/sqrtdi;
+      if (n < 0) {
+        const double oodi = 1.0/di; // one over d_i
+        for (int p=0; p > n; p--) {
+          v /= di;
+          foo *= oodi;
+        }
+      } else {
+        for (int p=0; p < n; p++) v *= di;
+        for (int p=1; p < n; p++) foo *= di;
+      }
+      t[i] = v;
+      (*outgrad)[i] += foo;
+      if (outpgrad) (*outpgrad)[i] += foo;
+    }
+    return deterministic_sum<double>(t.rows(), t.data())*gd.dvolume;
+  }
   bool I_give_zero_for_zero() const {
     return n >= 0;
   }
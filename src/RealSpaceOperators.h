@@ -4,26 +4,23 @@
 // very little memory (they just involve an additional copy of the
 // GridDescription, since I'm lazy, but that's small), and allow us to
 // treat things like "r^2" and "r_x" (almost) as VectorXd's that take
-// up no space, although they do take some time to work out what the
-// position is for each grid point.
+// up no space.  The position of each grid point comes from the
+// coordinate cache, so we only work out the positions once per grid.
 
 #pragma once
 
 #include "GridDescription.h"
+#include "CoordinateCache.h"
 
 template<typename Scalar>
 struct base_op : private GridDescription {
-  EIGEN_STRONG_INLINE base_op(const GridDescription &gdin) : GridDescription(gdin) {}
+  EIGEN_STRONG_INLINE base_op(const GridDescription &gdin)
+    : GridDescription(gdin), r(wigner_seitz_coordinates(gdin)) {}
   EIGEN_STRONG_INLINE const Scalar operator() (int row, int col) const {
-    int n = row + col;
-    const int z = n % Nz;
-    n = (n-z)/Nz;
-    const int y = n % Ny;
-    const int x = (n-y)/Ny;
-    const Relative rvec(x*dx,y*dy,z*dz);
-    return func(Lat.wignerSeitz(Lat.toCartesian(rvec)));
+    return func((*r)[row + col]);
   }
   virtual Scalar func(Cartesian) const = 0;
+  CoordinatePtr r;
 };
 
 template<typename Scalar>
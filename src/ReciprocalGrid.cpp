@@ -1,5 +1,5 @@
 #include "ReciprocalGrid.h"
-#include <fftw3.h>
+#include "FFTPlanCache.h"
 
 complex ReciprocalGrid::operator()(const RelativeReciprocal &r) const {
   double rx = r(0)*gd.Nx, ry = r(1)*gd.Ny, rz = r(2)*gd.Nz;
@@ -52,19 +52,20 @@ Grid ifft(const GridDescription &gd, const VectorXcd &rg) {
 Grid ifft(const GridDescription &gd, VectorXcd *rg) {
   Grid out(gd);
   const complex *mydata = rg->data();
-  fftw_plan p = fftw_plan_dft_c2r_3d(gd.Nx, gd.Ny, gd.Nz, (fftw_complex *)mydata, out.data(), FFTW_MEASURE);
-  fftw_execute(p);
+  fft_c2r_3d(gd.Nx, gd.Ny, gd.Nz, (fftw_complex *)mydata, out.data());
   // FFTW overwrites the input on a c2r transform, so let's throw it
-  // away so we don't accidentally try to reuse an invalid array! An
-  // alternative approach would be to copy it first into a scratch
-  // array.  If we saved that scratch array, we could even keep
-  // reusing the same plan.
+  // away so we don't accidentally try to reuse an invalid array!
   rg->resize(0);
-  fftw_destroy_plan(p);
   out *= 1.0/gd.Lat.volume();
   return out;
 }
 
+void ifft_in_place(const GridDescription &gd, VectorXcd *rg) {
+  fftw_complex *p = (fftw_complex *)rg->data();
+  fft_c2r_3d(gd.Nx, gd.Ny, gd.Nz, p, (double *)p);
+  *rg *= 1.0/gd.Lat.volume();
+}
+
 void ReciprocalGrid::MultiplyBy(double f(Reciprocal)) {
   for (int x=0; x<gd.Nx; x++) {
     for (int y=0; y<gd.Ny; y++) {
@@ -21,6 +21,7 @@ class Grid;
 
 Grid ifft(const GridDescription &gd, VectorXcd *rg);
 Grid ifft(const GridDescription &gd, const VectorXcd &rg);
+void ifft_in_place(const GridDescription &gd, VectorXcd *rg); // see Grid.h
 
 class ReciprocalGrid : public VectorXcd {
 public:
@@ -46,7 +46,8 @@ struct g2_op : public base_rop<Scalar> {
   Scalar func(Reciprocal g) const {
     return g.squaredNorm();
   }
-  const char *name() const { return "g2"; }
+  static const char *kernel_name() { return "g2"; }
+  const char *name() const { return kernel_name(); }
 };
 
 template<typename Scalar>
@@ -55,7 +56,8 @@ struct gx_op : public base_rop<Scalar> {
   Scalar func(Reciprocal g) const {
     return g(0);
   }
-  const char *name() const { return "gx"; }
+  static const char *kernel_name() { return "gx"; }
+  const char *name() const { return kernel_name(); }
 };
 
 template<typename Scalar>
@@ -64,7 +66,8 @@ struct gy_op : public base_rop<Scalar> {
   Scalar func(Reciprocal g) const {
     return g(1);
   }
-  const char *name() const { return "gy"; }
+  static const char *kernel_name() { return "gy"; }
+  const char *name() const { return kernel_name(); }
 };
 
 template<typename Scalar>
@@ -73,14 +76,16 @@ struct gz_op : public base_rop<Scalar> {
   Scalar func(Reciprocal g) const {
     return g(2);
   }
-  const char *name() const { return "gz"; }
+  static const char *kernel_name() { return "gz"; }
+  const char *name() const { return kernel_name(); }
 };
 
 template<typename Scalar>
 struct gaussian_op : public base_rop<Scalar> {
   gaussian_op(const GridDescription &gd, double width) : base_rop<Scalar>(gd), w(width) {
   }
-  const char *name() const { return "gaussian"; }
+  static const char *kernel_name() { return "gaussian"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kw = k*w;
@@ -97,7 +102,8 @@ struct step_op : public base_rop<Scalar> {
     R3 = R*R*R;
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "step"; }
+  static const char *kernel_name() { return "step"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -122,7 +128,8 @@ struct shell_op : public base_rop<Scalar> {
   shell_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "shell"; }
+  static const char *kernel_name() { return "shell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -146,7 +153,8 @@ struct shellprime_op : public base_rop<Scalar> {
   shellprime_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "shell"; }
+  static const char *kernel_name() { return "shell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -164,7 +172,8 @@ struct xshell_op : public base_rop<Scalar> {
   xshell_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "xshell"; }
+  static const char *kernel_name() { return "xshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -189,7 +198,8 @@ struct yshell_op : public base_rop<Scalar> {
   yshell_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "yshell"; }
+  static const char *kernel_name() { return "yshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -214,7 +224,8 @@ struct zshell_op : public base_rop<Scalar> {
   zshell_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "zshell"; }
+  static const char *kernel_name() { return "zshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -239,7 +250,8 @@ struct xshellprime_op : public base_rop<Scalar> {
   xshellprime_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "xshell"; }
+  static const char *kernel_name() { return "xshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -257,7 +269,8 @@ struct yshellprime_op : public base_rop<Scalar> {
   yshellprime_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "yshell"; }
+  static const char *kernel_name() { return "yshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -275,7 +288,8 @@ struct zshellprime_op : public base_rop<Scalar> {
   zshellprime_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "zshell"; }
+  static const char *kernel_name() { return "zshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -294,7 +308,8 @@ struct xyshell_op : public base_rop<Scalar> {
   xyshell_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "xyshell"; }
+  static const char *kernel_name() { return "xyshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -311,7 +326,8 @@ struct yzshell_op : public base_rop<Scalar> {
   yzshell_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "yzshell"; }
+  static const char *kernel_name() { return "yzshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -328,7 +344,8 @@ struct zxshell_op : public base_rop<Scalar> {
   zxshell_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "zxshell"; }
+  static const char *kernel_name() { return "zxshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double kR = k*R;
@@ -345,7 +362,8 @@ struct xxshell_op : public base_rop<Scalar> {
   xxshell_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "xxshell"; }
+  static const char *kernel_name() { return "xxshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double k2 = k*k;
@@ -366,7 +384,8 @@ struct yyshell_op : public base_rop<Scalar> {
   yyshell_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "yyshell"; }
+  static const char *kernel_name() { return "yyshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double k2 = k*k;
@@ -387,7 +406,8 @@ struct zzshell_op : public base_rop<Scalar> {
   zzshell_op(const GridDescription &gd, double r) : base_rop<Scalar>(gd), R(r) {
     dr = pow(gd.fineLat.volume(), 1.0/3);
   }
-  const char *name() const { return "zzshell"; }
+  static const char *kernel_name() { return "zzshell"; }
+  const char *name() const { return kernel_name(); }
   Scalar func(Reciprocal kvec) const {
     double k = kvec.norm();
     double k2 = k*k;
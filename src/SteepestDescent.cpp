@@ -46,6 +46,7 @@ public:
 bool SteepestDescentType::improve_energy(bool verbose) {
   iter++;
   //printf("I am running SteepestDescent::improve_energy\n");
+  grad(); // compute the gradient first, since that computes the energy too.
   const double E0 = energy();
   if (E0 != E0) {
     // There is no point continuing, since we're starting with a NaN!
@@ -81,6 +82,7 @@ void SteepestDescentType::print_info(const char *prefix) const {
 bool PreconditionedSteepestDescentType::improve_energy(bool verbose) {
   iter++;
   //printf("I am running PreconditionedSteepestDescent::improve_energy\n");
+  pgrad(); // compute pgrad first, since that computes the gradient and energy too.
   const double E0 = energy();
   if (E0 != E0) {
     // There is no point continuing, since we're starting with a NaN!
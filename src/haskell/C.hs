@@ -4,7 +4,7 @@ import Expression ( Code(..) )
 
 -- Type None means it is a constructor or destructor
 data Type = Void | Double | Int | Vector | ComplexVector | ConstCharPtr |
-            Bool | EnergyGradAndPrecond | None | Reference Type
+            Bool | EnergyGradAndPrecond | None | Reference Type | ConstReference Type
 
 instance Code Type where
   codePrec _ Void = showString "void "
@@ -29,6 +29,8 @@ instance Code Type where
   newcodePrec _ (Reference Vector) = showString "Vector "
   newcodePrec _ (Reference ComplexVector) = showString "ComplexVector "
   newcodePrec _ (Reference x) = error ("Cannot create reference to type " ++ newcode x)
+  newcodePrec _ (ConstReference Vector) = showString "const Vector &"
+  newcodePrec _ (ConstReference x) = error ("Cannot create const reference to type " ++ newcode x)
   latexPrec _ Void = showString "\\textrm{void}"
   latexPrec _ Double = showString "\\textrm{double}"
   latexPrec _ Int = showString "\\textrm{int}"
@@ -6,6 +6,7 @@ module Expression (Exprn(..),
                    rx, ry, rz, rmag, rvec,
                    lat1, lat2, lat3, rlat1, rlat2, rlat3, volume,
                    KSpace(..), k_var, imaginary, kvec, kx, ky, kz, k, ksqr, setkzero, setKequalToZero,
+                   setZero,
                    Scalar(..), scalar,
                    Vector, t_var, cross, dot, (/.), (*.), (.*), xhat, yhat, zhat,
                    Tensor, tensoridentity, tracetensor, tracetensorcube, (.*.), (.*..), outerproductsquare,
@@ -71,6 +72,12 @@ data Tensor a = SymmetricTensor { tensor_xx, tensor_yy, tensor_zz,
                                   tensor_xy, tensor_yz, tensor_zx :: Expression a }
      deriving ( Eq, Ord, Show )
 
+-- parallelFor is the pragma that splits a loop over n points of a
+-- grid across threads in the new code (see FieldThreads.h).
+parallelFor :: String -> String
+parallelFor n = "DEFT_PRAGMA(omp parallel for num_threads(field_threads()) if(parallel_threads(" ++
+                n ++ ") > 1))"
+
 kinversion :: Expression KSpace -> Expression KSpace
 kinversion (Var _ _ _ _ (Just e)) = kinversion e
 kinversion e@(Var _ _ _ _ Nothing) = e
@@ -227,7 +234,8 @@ instance Type RealSpace where
     error ("It is a bug to generate newcode for a non-var input to ifft\n"++ latex e)
   newcodeStatementHelper a op (Var _ _ _ _ (Just e)) = newcodeStatementHelper a op e
   newcodeStatementHelper a op e =
-    unlines $ ["for (int i=0; i<Nx*Ny*Nz; i++) {"] ++
+    unlines $ [parallelFor "slab_size(Nx,Ny,Nz)",
+               "\tfor (int i=0; i<int(slab_size(Nx,Ny,Nz)); i++) {"] ++
               initialize_position ++
               [newcodes (1 :: Int) e,
                "\t}"]
@@ -240,18 +248,18 @@ instance Type RealSpace where
               then ["\t\tint _z = i % int(Nz);",
                     "\t\tconst int _n = (i-_z)/int(Nz);",
                     "\t\tint _y = _n % int(Ny);",
-                    "\t\tint _x = (_n-_y)/int(Ny);",
+                    "\t\tint _x = (_n-_y)/int(Ny) + int(slab_x_start(Nx,Ny,Nz));",
                     "\t\tif (_x > int(Nx)/2) _x -= int(Nx);",
                     "\t\tif (_y > int(Ny)/2) _y -= int(Ny);",
                     "\t\tif (_z > int(Nz)/2) _z -= int(Nz);",
-                    "\t\tconst Vector r_i = Vector(_x*a1/Nx, _y*a2/Ny, _z*a3/Nz);"]
+                    "\t\tconst double r_i[3] = { _x*a1/Nx, _y*a2/Ny, _z*a3/Nz };"]
               else ["\t\t// No vec r dependence!"]
   initialize (Var IsTemp _ x _ Nothing) = "VectorXd " ++ x ++ "(gd.NxNyNz);"
   initialize _ = error "VectorXd output(gd.NxNyNz);"
   free (Var IsTemp _ x _ Nothing) = x ++ ".resize(0); // Realspace"
   free e = error $ trace "free error" ("free error " ++ show e)
   newdeclare _ = "Vector"
-  newinitialize (Var _ _ x _ Nothing) = "Vector " ++ x ++ "(Nx*Ny*Nz); // RS"
+  newinitialize (Var _ _ x _ Nothing) = "Vector " ++ x ++ "(slab_size(Nx,Ny,Nz)); // RS"
   newinitialize x = error ("oops newinitializeE: " ++ show x)
   newfree (Var IsTemp _ x _ Nothing) = x ++ ".free(); // Realspace"
   newfree e = error $ trace "free error" ("free error " ++ show e)
@@ -409,17 +417,18 @@ instance Type KSpace where
     error "It is a bug to generate newcode for a non-var input to fft"
   newcodeStatementHelper a op (Var _ _ _ _ (Just e)) = newcodeStatementHelper a op e
   newcodeStatementHelper (Var _ _ a _ _) op e =
-    unlines [setzero++
-             "\tfor (int i=1; i<Nx*Ny*(int(Nz)/2+1); i++) {",
+    unlines ["\tif (slab_x_start(Nx,Ny,Nz) == 0) " ++ setzero,
+             "\t" ++ parallelFor "slab_ksize(Nx,Ny,Nz)",
+             "\tfor (int i=(slab_x_start(Nx,Ny,Nz) == 0); i<int(slab_ksize(Nx,Ny,Nz)); i++) {",
              "\t\tconst int _z = i % (int(Nz)/2+1);",
              "\t\tconst int _n = (i-_z)/(int(Nz)/2+1);",
              "\t\tint _y = _n % int(Ny);",
-             "\t\tint _x = (_n-_y)/int(Ny);",
+             "\t\tint _x = (_n-_y)/int(Ny) + int(slab_x_start(Nx,Ny,Nz));",
              "\t\tif (_x > int(Nx)/2) _x -= int(Nx);",
              "\t\tif (_y > int(Ny)/2) _y -= int(Ny);",
-             "\t\tconst Vector k_i = Vector(" ++ code (xhat `dot` k_i) ++ ", " ++
-                                                 code (yhat `dot` k_i) ++ ", " ++
-                                                 code (zhat `dot` k_i) ++ ");",
+             "\t\tconst double k_i[3] = { " ++ code (xhat `dot` k_i) ++ ", " ++
+                                              code (yhat `dot` k_i) ++ ", " ++
+                                              code (zhat `dot` k_i) ++ " };",
              newcodes (1 :: Int) e,
              "\t}"]
       where k_i = cleanvec $ s_var "_x" .* rlat1 + s_var "_y" .* rlat2 + s_var "_z" .* rlat3
@@ -457,7 +466,7 @@ instance Type KSpace where
   free (Var IsTemp _ x _ Nothing) = x ++ ".resize(0); // KSpace"
   free _ = error "free error"
   newdeclare _ = "Vector"
-  newinitialize (Var _ _ x _ Nothing) = "ComplexVector " ++ x ++ "(Nx*Ny*(int(Nz)/2+1)); // KS"
+  newinitialize (Var _ _ x _ Nothing) = "ComplexVector " ++ x ++ "(slab_ksize(Nx,Ny,Nz)); // KS"
   newinitialize _ = error "oops newinitialize"
   newfree (Var IsTemp _ x _ Nothing) = x ++ ".free(); // KSpace"
   newfree _ = error "free error"
@@ -760,21 +769,25 @@ instance Type Scalar where
   codeStatementHelper a op e = code a ++ op ++ code e ++ ";"
 
   newcodeStatementHelper a " = " (Var _ _ _ _ (Just e)) = newcodeStatementHelper a " = " e
+  -- sum_of (see FieldThreads.h) adds up blocks of the grid in
+  -- parallel, and then adds the blocks in order, so the sum doesn't
+  -- depend on the number of threads.  On a grid split among ranks, we
+  -- then add up the sums of all the slabs (see Distributed.h).
   newcodeStatementHelper a " = " (Expression (Summate e)) =
-    newcode a ++ " = 0;\n\tfor (int i=0; i<Nx*Ny*Nz; i++) {\n" ++
+    newcode a ++ " = sum_over_ranks(sum_of(slab_size(Nx,Ny,Nz), [&](long i) {\n" ++
     unlines initialize_position ++
-    "\t\t"++ newcode a ++ " += " ++ newcode e ++
-    ";\n\t}\n"
+    "\t\treturn " ++ newcode e ++ ";\n" ++
+    "\t}));\n"
     where initialize_position =
               if hasexpression (Expression Rx) e || hasexpression (Expression Ry) e || hasexpression (Expression Rz) e
               then ["\t\tint _z = i % int(Nz);",
                     "\t\tconst int _n = (i-_z)/int(Nz);",
                     "\t\tint _y = _n % int(Ny);",
-                    "\t\tint _x = (_n-_y)/int(Ny);",
+                    "\t\tint _x = (_n-_y)/int(Ny) + int(slab_x_start(Nx,Ny,Nz));",
                     "\t\tif (_x > int(Nx)/2) _x -= int(Nx);",
                     "\t\tif (_y > int(Ny)/2) _y -= int(Ny);",
                     "\t\tif (_z > int(Nz)/2) _z -= int(Nz);",
-                    "\t\tconst Vector r_i = Vector(_x*a1/Nx, _y*a2/Ny, _z*a3/Nz);"]
+                    "\t\tconst double r_i[3] = { _x*a1/Nx, _y*a2/Ny, _z*a3/Nz };"]
               else []
 
   newcodeStatementHelper _ op (Expression (Summate _)) = error ("Haven't implemented "++op++" for integrate...")
@@ -2,7 +2,7 @@
 
 module NewCode (module Statement,
                 module Expression,
-                createHeaderAndCppFiles,
+                createHeaderAndCppFiles, createPlanarHeaderAndCppFiles,
                 defineFunctional, createCppFile, createHeader )
     where
 
@@ -22,6 +22,32 @@ createHeaderAndCppFiles functional inputs cname =
      writeFile ("src/"++fn++".h") $ createHeader functional cname
      writeFile ("src/"++fn++".cpp") $ createCppFile functional inputs cname (fn++".h")
 
+-- A Geometry determines how many grid points we use in each
+-- direction.  A Planar functional is for systems that vary only in z
+-- (e.g. a fluid next to a flat wall), so it has a single grid point in
+-- x and y, and the x and y dimensions only set the area of the cell.
+data Geometry = Bulk | Planar
+              deriving ( Eq )
+
+-- createPlanarHeaderAndCppFiles creates a Planar version of a
+-- functional.  Since nothing varies in x or y, only kx = ky = 0 appear
+-- in reciprocal space, so the weight functions reduce to their
+-- transverse integrals.  We set kx and ky to zero before optimizing,
+-- which lets the x and y components of vector (and tensor) weights
+-- vanish, so we skip the ffts that would compute them.  The smearing
+-- width dr is the cube root of dV, which on a planar grid would
+-- depend on the area of the cell, so we use the spacing in z instead,
+-- which is what dr is on the cubic grid of a Bulk functional.
+createPlanarHeaderAndCppFiles :: Expression Scalar -> [(Exprn, Exprn)] -> String -> IO ()
+createPlanarHeaderAndCppFiles functional inputs cname =
+  do let fn = "new/" ++ cname ++ "Fast"
+         bulk_dr, planar_dr :: Expression Scalar
+         bulk_dr = var "dr" "\\Delta r" (dVscalar ** (1.0/3))
+         planar_dr = var "dr" "\\Delta r" (s_var "a3" / s_var "Nz")
+         planar = setZero (EK ky) $ setZero (EK kx) $ substitute bulk_dr planar_dr functional
+     writeFile ("src/"++fn++".h") $ createHeader planar cname
+     writeFile ("src/"++fn++".cpp") $ createGeometryCppFile Planar planar inputs cname (fn++".h")
+
 createHeader :: Expression Scalar -> String -> String
 createHeader e = if any is_nonscalar (findOrderedInputs e)
                  then create3dHeader e
@@ -41,7 +67,7 @@ create3dHeader e0 n =
    "",
    "#pragma GCC diagnostic ignored \"-Wunused-variable\"",
    "class " ++ n ++ " : public NewFunctional {",
-   "public:"] ++ map (declare . strip_type) (create3dMethods e0 [] n) ++
+   "public:"] ++ map (declare . strip_type) (create3dMethods Bulk e0 [] n) ++
   map (newcode . setarg) (inputs e0) ++
  ["private:",
   ""++ codeMutableData (Set.toList $ findNamedScalars e)  ++"}; // End of " ++ n ++ " class"] ++
@@ -67,11 +93,11 @@ create3dHeader e0 n =
                 | nameE xx `elem` ["Nx","Ny","Nz"] =
                   ("const double "++nameE xx++" = data[sofar++];") : initme rr
               initme (xx@(ES _):rr) = ("sofar += 1; // " ++ nameE xx) : initme rr
-              initme (xx@(ER _):rr) = ("sofar += Nx*Ny*Nz; // " ++ nameE xx) : initme rr
+              initme (xx@(ER _):rr) = ("sofar += slab_size(Nx,Ny,Nz); // " ++ nameE xx) : initme rr
               initme _ = error "bug inin setarg initme"
       sizeE (ES _) = "1"
-      sizeE (ER _) = "Nx*Ny*Nz"
-      sizeE (EK _) = "Nx*Ny*(long(Nz)/2+1)"
+      sizeE (ER _) = "slab_size(Nx,Ny,Nz)"
+      sizeE (EK _) = "slab_ksize(Nx,Ny,Nz)"
       inputs :: Expression Scalar -> [Exprn]
       inputs x = findOrderedInputs x -- Set.toList $ findInputs x -- 
       codeMutableData a = unlines $ map (\x -> "\tmutable double " ++ x ++ ";") a
@@ -120,7 +146,10 @@ create0dHeader e0 n =
 
 
 createCppFile :: Expression Scalar -> [(Exprn, Exprn)] -> String -> String -> String
-createCppFile e variables n headername = unlines $ ["// -*- mode: C++; -*-",
+createCppFile = createGeometryCppFile Bulk
+
+createGeometryCppFile :: Geometry -> Expression Scalar -> [(Exprn, Exprn)] -> String -> String -> String
+createGeometryCppFile geometry e variables n headername = unlines $ ["// -*- mode: C++; -*-",
                                                     "",
                                                     "#include \"" ++ headername ++ "\"",
                                                     "",
@@ -128,7 +157,7 @@ createCppFile e variables n headername = unlines $ ["// -*- mode: C++; -*-",
   where is_nonscalar (ES _) = False
         is_nonscalar _ = True
         methods = if any is_nonscalar (findOrderedInputs e)
-                  then create3dMethods e variables n
+                  then create3dMethods geometry e variables n
                   else create0dMethods e variables n
 
 create0dMethods :: Expression Scalar -> [(Exprn, Exprn)] -> String -> [CFunction]
@@ -143,11 +172,11 @@ create0dMethods e variables n =
   createAnydMethods e variables n
     where
       actualsize (ES _) = 1 :: Expression Scalar
-      actualsize (ER _) = s_var "myNx" * s_var "myNy" * s_var "myNz"
+      actualsize (ER _) = s_var "slab_size(myNx,myNy,myNz)"
       actualsize (EK _) = error "need to compute size of EK in actualsize of NewCode"
 
-create3dMethods :: Expression Scalar -> [(Exprn, Exprn)] -> String -> [CFunction]
-create3dMethods e variables n =
+create3dMethods :: Geometry -> Expression Scalar -> [(Exprn, Exprn)] -> String -> [CFunction]
+create3dMethods geometry e variables n =
   [CFunction {
      name = n++"::"++n,
      returnType = None,
@@ -163,8 +192,8 @@ create3dMethods e variables n =
      returnType = None,
      constness = "",
      args = [(Double, "ax"), (Double, "ay"), (Double, "az"), (Double, "dx")],
-     contents =["long myNx = long(ceil(ax/dx/2))*2;",
-                "long myNy = long(ceil(ay/dx/2))*2;",
+     contents =[npoints "myNx" "ax",
+                npoints "myNy" "ay",
                 "long myNz = long(ceil(az/dx/2))*2;",
                 "data = Vector(long(" ++ code (sum $ map actualsize $ findOrderedInputs e) ++ "));",
                 "Nx() = myNx;",
@@ -178,8 +207,10 @@ create3dMethods e variables n =
                                 ("kx", EK kx), ("ky", EK ky), ("kz", EK kz), ("k", EK k)]
     where
       actualsize (ES _) = 1 :: Expression Scalar
-      actualsize (ER _) = s_var "myNx" * s_var "myNy" * s_var "myNz"
+      actualsize (ER _) = s_var "slab_size(myNx,myNy,myNz)"
       actualsize (EK _) = error "need to compute size of EK in actualsize of NewCode"
+      npoints nn a | geometry == Planar = "long " ++ nn ++ " = 1;"
+                   | otherwise = "long " ++ nn ++ " = long(ceil(" ++ a ++ "/dx/2))*2;"
       getIntermediate :: (String, Exprn) -> CFunction
       getIntermediate ("", _) = error "empty string in getIntermediate"
       getIntermediate (rsname, a) = CFunction {
@@ -194,7 +225,7 @@ create3dMethods e variables n =
 
 createInput :: Exprn -> String
 createInput ee@(ES _) = "double " ++ nameE ee ++ " = data[sofar]; sofar += 1;"
-createInput ee@(ER _) = "Vector " ++ nameE ee ++ " = data.slice(sofar,Nx*Ny*Nz); sofar += Nx*Ny*Nz;"
+createInput ee@(ER _) = "Vector " ++ nameE ee ++ " = data.slice(sofar,slab_size(Nx,Ny,Nz)); sofar += slab_size(Nx,Ny,Nz);"
 createInput ee = error ("unhandled type in NewCode scalarClass: " ++ show ee)
 
 createAnydMethods :: Expression Scalar -> [(Exprn, Exprn)] -> String -> [CFunction]
@@ -226,6 +257,20 @@ createAnydMethods e variables n =
      args = [],
      contents = ["return true;"]
      },
+   -- Every rank holds the scalars (see Distributed.h), so only rank
+   -- zero counts them in a dot product.
+   CFunction {
+     name = n++"::dot",
+     returnType = Double,
+     constness = "const",
+     args = [(ConstReference Vector, "a"), (ConstReference Vector, "b")],
+     contents = ["double out = a.dot(b);",
+                 "if (my_rank() != 0) {",
+                 "\tlong sofar = 0;"] ++
+                map ("\t"++) (concatMap uncountScalar (findOrderedInputs e)) ++
+                ["}",
+                 "return sum_over_ranks(out);"]
+     },
    CFunction {
      name = n++"::energy_grad_and_precond",
      returnType = EnergyGradAndPrecond,
@@ -287,11 +332,17 @@ createAnydMethods e variables n =
                      [newcodeStatements (eval_scalar_derivative $ derive v 1 e)]
       }]
       getScalarDerivative _ = [] -- not a scalar
+      uncountScalar ee@(ES _)
+        | nameE ee `elem` ["Nx","Ny","Nz"] = ["const double " ++ nameE ee ++ " = data[sofar];",
+                                              "out -= a[sofar]*b[sofar]; sofar += 1;"]
+        | otherwise = ["out -= a[sofar]*b[sofar]; sofar += 1; // " ++ nameE ee]
+      uncountScalar ee@(ER _) = ["sofar += slab_size(Nx,Ny,Nz); // " ++ nameE ee]
+      uncountScalar ee = error ("unhandled type in NewCode dot: " ++ show ee)
       createInputAndGrad ee@(ES _) = ["double " ++ nameE ee ++ " = data[sofar];",
                                       "double *grad_" ++ nameE ee ++ " = &output[sofar++];"]
-      createInputAndGrad ee@(ER _) = ["Vector " ++ nameE ee ++ " = data.slice(sofar,Nx*Ny*Nz);",
-                                      "Vector grad_" ++ nameE ee ++ " = output.slice(sofar,Nx*Ny*Nz);",
-                                      "sofar += Nx*Ny*Nz;"]
+      createInputAndGrad ee@(ER _) = ["Vector " ++ nameE ee ++ " = data.slice(sofar,slab_size(Nx,Ny,Nz));",
+                                      "Vector grad_" ++ nameE ee ++ " = output.slice(sofar,slab_size(Nx,Ny,Nz));",
+                                      "sofar += slab_size(Nx,Ny,Nz);"]
       createInputAndGrad ee = error ("unhandled type in NewCode scalarClass: " ++ show ee)
       the_gradients = map (mapExprn (\x -> ("grad_"++nameE (mkExprn x), mkExprn $ derive x 1 e))) (map fst variables)
       grade :: [Statement]
@@ -12,7 +12,7 @@ module Statement ( Statement(..),
     where
 
 import Expression
-import Data.List ( nubBy, partition, (\\) )
+import Data.List ( nubBy, partition, intercalate, tails, (\\) )
 
 data Statement = Assign Exprn Exprn
                | Initialize Exprn
@@ -56,9 +56,24 @@ codeStatements (s:ss) = code s ++ "\n" ++ codeStatements ss
 codeStatements [] = ""
 
 newcodeStatements :: [Statement] -> String
-newcodeStatements sts = newcodeStatementsHelper 2 2 sts -- 2 for n and Vext
+newcodeStatements sts = newcodeStatementsHelper 2 2 (gatherIFFTs sts) -- 2 for n and Vext
 
 newcodeStatementsHelper :: Int -> Int -> [Statement] -> String
+newcodeStatementsHelper peak mem ss
+  | (iffts@(_:_:_), rest) <- spanIFFTs ss =
+    newcodeIFFTs (mem + length iffts) iffts
+    ++ newcodeStatementsHelper (max peak (mem + length iffts)) (mem + length iffts) rest
+newcodeStatementsHelper peak mem ss
+  | Just (EK (Var _ _ k _ _), ER (Var _ _ r _ _)) <- fftInPlace ss =
+    "\tComplexVector " ++ k ++ " = fft_in_place(Nx,Ny,Nz,dV," ++ r ++ "); // KS mem used = " ++ show mem ++ "\n"
+    ++ newcodeStatementsHelper peak mem (drop 3 ss)
+  | Just (ER (Var _ _ r _ _), EK (Var _ _ k _ _)) <- ifftInPlace ss =
+    "\tVector " ++ r ++ " = ifft_in_place(Nx,Ny,Nz,dV," ++ k ++ "); // RS mem used = " ++ show mem ++ "\n"
+    ++ newcodeStatementsHelper peak mem (drop 3 ss)
+newcodeStatementsHelper peak mem (Initialize (ER v@(Var _ _ r _ Nothing)) : ss)
+  | any ((== Just (ER v)) . fmap snd . fftInPlace) (tails ss) =
+    "\tVector " ++ r ++ " = Vector::padded(Nx,Ny,Nz); // RS mem used = " ++ show (mem+1) ++ "\n"
+    ++ newcodeStatementsHelper (max peak (mem+1)) (mem+1) ss
 newcodeStatementsHelper peak mem (Initialize v : Assign v' (ES e) : ss)
   | v == v' = "\tdouble " ++ newcode (Assign v (ES e)) ++ "\n"
     ++ newcodeStatementsHelper peak mem ss
@@ -74,6 +89,75 @@ newcodeStatementsHelper peak mem (s:ss) = newcode s ++ "\n"
   ++ newcodeStatementsHelper peak mem ss
 newcodeStatementsHelper peak _ [] = "\t// peak mem = " ++ show peak
 
+-- fftInPlace recognizes a k-space variable being created by the fft
+-- of a real-space temporary that is freed right afterwards, which we
+-- can transform in place to save memory.  It returns the k-space
+-- variable and the real-space one.  When we create such a real-space
+-- variable, we give it the padding needed to transform in place.
+fftInPlace :: [Statement] -> Maybe (Exprn, Exprn)
+fftInPlace (Initialize (EK k) : Assign (EK k') (EK (Expression (FFT r@(Var _ _ _ _ Nothing)))) : Free (ER r') : _)
+  | k == k', r == r', Var _ _ _ _ Nothing <- k = Just (EK k, ER r)
+fftInPlace _ = Nothing
+
+-- ifftInPlace is just like fftInPlace, but for an inverse fft.
+ifftInPlace :: [Statement] -> Maybe (Exprn, Exprn)
+ifftInPlace (Initialize (ER r) : Assign (ER r') (ER (Expression (IFFT k@(Var _ _ _ _ Nothing)))) : Free (EK k') : _)
+  | r == r', k == k', Var _ _ _ _ Nothing <- r = Just (ER r, EK k)
+ifftInPlace _ = Nothing
+
+-- ifftPair recognizes a real-space variable being created by the
+-- inverse FFT of a k-space variable, and returns both variables.
+ifftPair :: [Statement] -> Maybe (Exprn, Exprn)
+ifftPair (Initialize (ER v) : Assign (ER v') (ER (Expression (IFFT k@(Var _ _ _ _ Nothing)))) : _)
+  | v == v', Var _ _ _ _ Nothing <- v = Just (ER v, EK k)
+ifftPair _ = Nothing
+
+-- spanIFFTs finds a run of ifftPairs, returning the names of their
+-- outputs and inputs, which can be done as a single batched
+-- transform.
+spanIFFTs :: [Statement] -> ([(String, String)], [Statement])
+spanIFFTs ss@(_ : _ : rest)
+  | Just (ER (Var _ _ out _ _), EK (Var _ _ inp _ _)) <- ifftPair ss =
+    case spanIFFTs rest of (iffts, rest') -> ((out, inp) : iffts, rest')
+spanIFFTs ss = ([], ss)
+
+newcodeIFFTs :: Int -> [(String, String)] -> String
+newcodeIFFTs mem iffts =
+  "\tVector " ++ intercalate ", " (map fst iffts) ++ "; // RS mem used = " ++ show mem ++ "\n" ++
+  "\t{\n" ++
+  "\t\tconst ComplexVector *_ins[] = { " ++ intercalate ", " (map (('&':) . snd) iffts) ++ " };\n" ++
+  "\t\tVector *_outs[] = { " ++ intercalate ", " (map (('&':) . fst) iffts) ++ " };\n" ++
+  "\t\tifft_many(Nx,Ny,Nz,dV," ++ show (length iffts) ++ ",_ins,_outs);\n" ++
+  "\t}\n"
+
+-- gatherIFFTs moves inverse FFTs up next to an earlier inverse FFT
+-- whenever they are independent, so that they can be performed
+-- together by ifft_many.  We only move an ifftPair up past assignments
+-- that neither use its output nor change its input, so we never
+-- change the result.  Moving it up makes its output live longer, so
+-- we only move it past assignments that perform no fft (and so
+-- allocate nothing), and past at most maxIFFTHoist of them, which
+-- keeps the peak memory use as it was, and the outputs short-lived.
+gatherIFFTs :: [Statement] -> [Statement]
+gatherIFFTs ss@(i : a : rest)
+  | Just _ <- ifftPair ss = case pullIFFTs [] rest of
+    (pulled, rest') -> i : a : pulled ++ gatherIFFTs rest'
+gatherIFFTs (s:ss) = s : gatherIFFTs ss
+gatherIFFTs [] = []
+
+maxIFFTHoist :: Int
+maxIFFTHoist = 4
+
+pullIFFTs :: [Statement] -> [Statement] -> ([Statement], [Statement])
+pullIFFTs passed ss@(i : a : rest)
+  | Just (out, inp) <- ifftPair ss, not (any (touches out inp) passed) =
+    case pullIFFTs passed rest of (pulled, rest') -> (i : a : pulled, rest')
+  where touches o k s@(Assign x _) = x == o || x == k || hasE o [s]
+        touches _ _ _ = True
+pullIFFTs passed (s@(Assign _ e) : rest)
+  | length passed < maxIFFTHoist, not (mapExprn hasActualFFT e) = pullIFFTs (passed ++ [s]) rest
+pullIFFTs passed rest = ([], passed ++ rest)
+
 substituteS :: Type a => Expression a -> Expression a -> Statement -> Statement
 substituteS x y (Assign s e) = Assign s (substituteE x y e)
 substituteS x y (Initialize e) = Initialize (substituteE x y e)
@@ -42,3 +42,21 @@ main :: IO ()
 main = createHeaderAndCppFiles %s %s "%s"
 """ % (module, hsfunctional, hsfunctional, inputs, name))
     f.close()
+
+# The following are for systems that only vary in z, such as a fluid
+# next to a flat wall.
+for name, module, hsfunctional, inputs in [
+    ("WhiteBearFluidVeffPlanar", "WhiteBear", "whitebear_fluid_Veff",
+           '[(ER $ r_var "Veff", ER (exp(-r_var "Veff"/s_var "kT")))]'),
+    ("SFMTFluidVeffPlanar", "SFMT", "sfmt_fluid_Veff",
+           '[(ER $ r_var "Veff", ER (exp(-r_var "Veff"/s_var "kT")))]'),
+    ("SW_liquidVeffPlanar", "SW_liquid", "sw_liquid_Veff",
+           '[(ER $ r_var "Veff", ER (exp(-r_var "Veff"/s_var "kT")))]')]:
+    f = open('generate_%s.hs' % name, "w")
+    f.write("""import NewCode
+import %s ( %s )
+
+main :: IO ()
+main = createPlanarHeaderAndCppFiles %s %s "%s"
+""" % (module, hsfunctional, hsfunctional, inputs, name))
+    f.close()
@@ -0,0 +1,91 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <math.h>
+#include <complex>
+
+// The functions here interpolate and resample periodic fields stored
+// on a grid, with z varying fastest.  They are shared by Grid and by
+// the Vector fields of the new code, which use the same layouts in
+// both real and reciprocal space.
+
+// wrap_index maps i onto 0..N-1, for any i.
+inline long wrap_index(long i, long N) {
+  i %= N;
+  return (i < 0) ? i + N : i;
+}
+
+// trilinear interpolates the Nx*Ny*Nz field f at the relative
+// coordinates (rx, ry, rz), in which the cell is a unit cube.
+inline double trilinear(const double *f, long Nx, long Ny, long Nz,
+                        double rx, double ry, double rz) {
+  rx *= Nx;
+  ry *= Ny;
+  rz *= Nz;
+  const double fx = floor(rx), fy = floor(ry), fz = floor(rz);
+  const double wx = rx - fx, wy = ry - fy, wz = rz - fz;
+  const long ix = wrap_index(long(fx), Nx), iy = wrap_index(long(fy), Ny), iz = wrap_index(long(fz), Nz);
+  const long ixp1 = (ix+1 == Nx) ? 0 : ix+1;
+  const long iyp1 = (iy+1 == Ny) ? 0 : iy+1;
+  const long izp1 = (iz+1 == Nz) ? 0 : iz+1;
+  const double *p0 = f + ix*Ny*Nz, *p1 = f + ixp1*Ny*Nz;
+  const long y0 = iy*Nz, y1 = iyp1*Nz;
+  return (1-wx)*((1-wy)*((1-wz)*p0[y0 + iz] + wz*p0[y0 + izp1])
+                 + wy*((1-wz)*p0[y1 + iz] + wz*p0[y1 + izp1]))
+    + wx*((1-wy)*((1-wz)*p1[y0 + iz] + wz*p1[y0 + izp1])
+          + wy*((1-wz)*p1[y1 + iz] + wz*p1[y1 + izp1]));
+}
+
+// resample_mode finds the mode of a dimension of size Ns that feeds
+// mode t of the same dimension of size Nt, returning its index and
+// setting *weight to its weight, which is zero if there is no such
+// mode.  half is true for the last dimension of an r2c transform, which
+// holds only the non-negative frequencies.  Frequencies below the
+// Nyquist frequency of both sizes are copied.  When we refine, the
+// Nyquist mode of the coarse grid is split evenly between the +N/2
+// and -N/2 modes of the fine grid (in the half dimension, the -N/2 mode
+// is implicit), and when we coarsen, the new Nyquist modes are zero.
+inline long resample_mode(long t, long Nt, long Ns, bool half, double *weight) {
+  if (Nt == Ns) {
+    *weight = 1;
+    return t;
+  }
+  const long f = (half || 2*t <= Nt) ? t : t - Nt;
+  const long s = (f < 0) ? f + Ns : f;
+  if (2*labs(f) < Ns && 2*labs(f) < Nt) {
+    *weight = 1;
+  } else if (2*labs(f) == Ns && Nt > Ns) {
+    *weight = 0.5;
+  } else {
+    *weight = 0;
+  }
+  return s;
+}
+
+// spectral_resample sets out, the r2c transform of an Mx*My*Mz field,
+// to the transform in of an Nx*Ny*Nz field over the same cell, with
+// modes added or dropped as by resample_mode.  With the transforms
+// normalized by the cell volume, as both Grid and the new code do,
+// the inverse transform of out is the band-limited interpolation of
+// the original field onto the new grid.
+inline void spectral_resample(long Nx, long Ny, long Nz, const std::complex<double> *in,
+                              long Mx, long My, long Mz, std::complex<double> *out) {
+  const long NzOver2 = Nz/2 + 1, MzOver2 = Mz/2 + 1;
+  for (long x=0; x<Mx; x++) {
+    double wx;
+    const long sx = resample_mode(x, Mx, Nx, false, &wx);
+    for (long y=0; y<My; y++) {
+      double wy;
+      const long sy = resample_mode(y, My, Ny, false, &wy);
+      std::complex<double> *o = out + (x*My + y)*MzOver2;
+      const std::complex<double> *i = in + (sx*Ny + sy)*NzOver2;
+      for (long z=0; z<MzOver2; z++) {
+        double wz;
+        const long sz = resample_mode(z, Mz, Nz, true, &wz);
+        const double w = wx*wy*wz;
+        o[z] = (w != 0) ? w*i[sz] : 0;
+      }
+    }
+  }
+}
@@ -0,0 +1,141 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <map>
+#include <mutex>
+#include <vector>
+#include <fftw3.h>
+#include "utilities.h"
+
+// All the memory for Vector and ComplexVector comes from here.  Big
+// arrays are allocated with fftw_malloc, so they are aligned the way
+// fftw likes for SIMD, and are counted in peak_memory().  Small ones
+// (like the 3-vectors created for every k point in generated code) use
+// plain malloc, which is faster.  Since a Vector and a ComplexVector
+// get their memory the same way, an array can be handed from one to
+// the other, which is how fft_in_place and ifft_in_place avoid
+// allocating.  The number of bytes must be given when freeing, and
+// must match what was allocated.
+//
+// Generated code creates and destroys many temporary fields of the
+// same few sizes in every energy() call, so rather than handing big
+// arrays back to the system (which would then page fault afresh when
+// touching a new one), we keep them in a pool, with a bucket for each
+// size, and reuse them for the next array of that size.  A pooled array
+// isn't in use, so it isn't counted by current_memory() or
+// peak_memory(), which continue to measure the memory that the code
+// actually needs.  The pool holds at most a limited number of bytes,
+// beyond which freed arrays really are freed.
+
+struct VectorPoolStats {
+  long hits;              // number of arrays taken from the pool
+  long misses;            // number of arrays we had to fftw_malloc
+  long pooled_bytes;      // memory currently held in the pool
+  long peak_pooled_bytes; // most memory ever held in the pool
+};
+
+class VectorPool {
+public:
+  VectorPool() : limit(256*1024*1024), pooled(0), peak_pooled(0), hits(0), misses(0) {}
+
+  void *allocate(long bytes) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::map<long, std::vector<void *> >::iterator b = buckets.find(bytes);
+      if (b != buckets.end() && b->second.size()) {
+        void *p = b->second.back();
+        b->second.pop_back();
+        pooled -= bytes;
+        hits++;
+        return p;
+      }
+      misses++;
+    }
+    return fftw_malloc(bytes);
+  }
+  void free(void *p, long bytes) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (pooled + bytes <= limit) {
+        buckets[bytes].push_back(p);
+        pooled += bytes;
+        if (pooled > peak_pooled) peak_pooled = pooled;
+        return;
+      }
+    }
+    fftw_free(p);
+  }
+
+  // set_limit sets the most memory (in bytes) that the pool may hold,
+  // freeing pooled arrays if we are already over the limit.  A limit
+  // of zero disables the pool.  The default is 256 MB.
+  void set_limit(long bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    limit = bytes;
+    for (std::map<long, std::vector<void *> >::iterator b = buckets.begin();
+         b != buckets.end() && pooled > limit; ++b) {
+      while (b->second.size() && pooled > limit) {
+        fftw_free(b->second.back());
+        b->second.pop_back();
+        pooled -= b->first;
+      }
+    }
+  }
+  // empty frees every pooled array, and resets the counters.
+  void empty() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (std::map<long, std::vector<void *> >::iterator b = buckets.begin();
+         b != buckets.end(); ++b) {
+      for (unsigned i=0; i<b->second.size(); i++) fftw_free(b->second[i]);
+    }
+    buckets.clear();
+    pooled = peak_pooled = hits = misses = 0;
+  }
+  VectorPoolStats stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    VectorPoolStats s;
+    s.hits = hits;
+    s.misses = misses;
+    s.pooled_bytes = pooled;
+    s.peak_pooled_bytes = peak_pooled;
+    return s;
+  }
+private:
+  std::mutex mutex;
+  std::map<long, std::vector<void *> > buckets; // free arrays, by size in bytes
+  long limit, pooled, peak_pooled, hits, misses;
+};
+
+// As with the caches of plans and kernels, we never free the pool, so
+// that Vectors destroyed by static destructors still have somewhere to
+// go.
+inline VectorPool &vector_pool() {
+  static VectorPool *pool = new VectorPool;
+  return *pool;
+}
+
+inline void print_vector_pool_stats(const char *prefix = "") {
+  const VectorPoolStats s = vector_pool().stats();
+  const long requests = s.hits + s.misses;
+  printf("%svector pool: %ld hits, %ld misses (%g%% hit rate), %g M pooled, peak %g M\n",
+         prefix, s.hits, s.misses, requests ? 100.0*s.hits/requests : 0.0,
+         s.pooled_bytes/1024.0/1024, s.peak_pooled_bytes/1024.0/1024);
+}
+
+inline void *vector_allocate(long bytes) {
+  if (bytes <= 100) return malloc(bytes);
+  if (memory_tracker()) memory_tracker()(bytes);
+  return vector_pool().allocate(bytes);
+}
+
+inline void vector_free(void *p, long bytes) {
+  if (bytes <= 100) {
+    free(p);
+  } else {
+    if (memory_tracker()) memory_tracker()(-bytes);
+    vector_pool().free(p, bytes);
+  }
+}
@@ -6,7 +6,9 @@
 #include <cassert>
 #include <string.h>
 #include <math.h>
-
+#include "Allocator.h"
+#include "Expression.h"
+#include "FieldThreads.h"
 
 // A ComplexVector is a reference-counted array of std::complex<double>s.
 // You need to be careful, because a copy of a ComplexVector (or the
@@ -26,33 +28,43 @@
 
 // Most arithmetic operators are defined on ComplexVectors.  If you come
 // across one that isn't defined, we could probably add its
-// definition.
+// definition.  As for Vector, they are lazy (see Expression.h).
 
 class Vector;
 
 class ComplexVector {
 public:
-  ComplexVector() : size(0), offset(0), data(0), references_count(0) {}
-  explicit ComplexVector(long sz) : size(sz), offset(0), data(new std::complex<double>[size]),
-                                   references_count(new int) {
+  typedef std::complex<double> value_type;
+  ComplexVector() : size(0), offset(0), capacity(0), data(0), references_count(0) {}
+  explicit ComplexVector(long sz)
+    : size(sz), offset(0), capacity(sz),
+      data((std::complex<double> *)vector_allocate(sz*sizeof(std::complex<double>))),
+      references_count(new int) {
     *references_count = 1;
+    memset((void *)data, 0, size*sizeof(std::complex<double>));
   }
-  ComplexVector(const ComplexVector &a) : size(a.size), offset(a.offset),
+  ComplexVector(const ComplexVector &a) : size(a.size), offset(a.offset), capacity(a.capacity),
                             data(a.data), references_count(a.references_count) {
-    *references_count += 1;
+    if (references_count) *references_count += 1;
+  }
+  template<typename E>
+  ComplexVector(const Expression<E, std::complex<double> > &e)
+    : size(0), offset(0), capacity(0), data(0), references_count(0) {
+    *this = e;
   }
   ~ComplexVector() { free(); }
   void free() {
     if (references_count && *references_count) {
       *references_count -= 1;
       if (*references_count == 0) {
-        delete[] data;
+        vector_free(data, capacity*sizeof(std::complex<double>));
         delete references_count;
       }
       references_count = 0;
       data = 0;
       size = 0;
       offset = 0;
+      capacity = 0;
     }
   }
   void operator=(const ComplexVector &a) {
@@ -61,14 +73,35 @@ public:
     if (!references_count) {
       size = a.size;
       offset = a.offset;
+      capacity = a.capacity;
       data = a.data;
       references_count = a.references_count;
       *references_count += 1;
     } else {
-      assert(size = a.size);
+      assert(size == a.size);
       memcpy(data+offset, a.data+a.offset, size*sizeof(std::complex<double>)); // faster than manual loop?
     }
   }
+  template<typename E>
+  void operator=(const Expression<E, std::complex<double> > &x) {
+    const E &e = x.derived();
+    if (!references_count && e.get_size()) {
+      ComplexVector out(e.get_size());
+      evaluate(out.data, e);
+      *this = out;
+    } else if (!references_count) {
+      size = 0;
+    } else {
+      assert(size == e.get_size());
+      if (e.overlaps(data + offset, data + offset + size)) {
+        ComplexVector out(size);
+        evaluate(out.data, e);
+        *this = out;
+      } else {
+        evaluate(data + offset, e);
+      }
+    }
+  }
   void operator=(std::complex<double> x) {
     for (long i=0; i<size; i++) {
       data[i] = x;
@@ -90,6 +123,7 @@ public:
     assert(start + num <= size);
     ComplexVector out;
     out.size = num;
+    out.capacity = capacity;
     out.data = data;
     out.offset = start;
     out.references_count = references_count;
@@ -97,53 +131,13 @@ public:
     return out;
   }
 
-  // Below are the arithmetic operators.  These should be made fast.
-  ComplexVector operator+(const ComplexVector &a) const {
-    // operator+ treats an empty vector as a zero vector;
-    if (a.size == 0) return *this;
-    if (size == 0) return a;
-    assert(size == a.size);
-    ComplexVector out(size);
-    const std::complex<double> *p1 = data + offset, *p2 = a.data + a.offset;
-    for (long i=0; i<size; i++) {
-      out.data[i] = p1[i] + p2[i];
-    }
-    return out;
-  }
-  ComplexVector operator-(const ComplexVector &a) const {
-    // operator- treats an empty vector as a zero vector;
-    if (a.size == 0) return *this;
-    if (size == 0) return -a;
-    assert(size == a.size);
-    ComplexVector out(size);
-    const std::complex<double> *p1 = data + offset, *p2 = a.data + a.offset;
-    for (long i=0; i<size; i++) {
-      out.data[i] = p1[i] - p2[i];
-    }
-    return out;
-  }
-  ComplexVector operator-() const {
-    ComplexVector out(size);
-    const std::complex<double> *p1 = data + offset;
-    for (long i=0; i<size; i++) {
-      out.data[i] = -p1[i];
-    }
-    return out;
-  }
-  ComplexVector operator*(std::complex<double> a) const {
-    ComplexVector out(size);
-    const std::complex<double> *p2 = data + offset;
-    for (long i=0; i<size; i++) {
-      out.data[i] = a*p2[i];
-    }
-    return out;
-  }
-  friend ComplexVector operator*(std::complex<double> a, const ComplexVector &b);
-
+  // Below are the arithmetic operators that modify a ComplexVector.
+  // The others are in Expression.h.
   void operator+=(const ComplexVector &a) {
     assert(size == a.size);
     std::complex<double> *p1 = data + offset;
     const std::complex<double> *p2 = a.data + a.offset;
+    DEFT_PRAGMA(omp parallel for simd num_threads(field_threads()) if(parallel_threads(size) > 1))
     for (long i=0; i<size; i++) {
       p1[i] += p2[i];
     }
@@ -152,40 +146,47 @@ public:
     assert(size == a.size);
     std::complex<double> *p1 = data + offset;
     const std::complex<double> *p2 = a.data + a.offset;
+    DEFT_PRAGMA(omp parallel for simd num_threads(field_threads()) if(parallel_threads(size) > 1))
     for (long i=0; i<size; i++) {
       p1[i] -= p2[i];
     }
   }
+  template<typename E>
+  void operator+=(const Expression<E, std::complex<double> > &e) {
+    assert(size == e.derived().get_size());
+    *this = *this + e.derived();
+  }
+  template<typename E>
+  void operator-=(const Expression<E, std::complex<double> > &e) {
+    assert(size == e.derived().get_size());
+    *this = *this - e.derived();
+  }
   void operator*=(std::complex<double> a) {
     std::complex<double> *p1 = data + offset;
+    DEFT_PRAGMA(omp parallel for simd num_threads(field_threads()) if(parallel_threads(size) > 1))
     for (long i=0; i<size; i++) {
       p1[i] *= a;
     }
   }
+  // The reductions are deterministic (see FieldThreads.h).
   std::complex<double> sum() const {
-    const std::complex<double> *p1 = data + offset;
-    std::complex<double> out = 0;
-    for (long i=0; i<size; i++) {
-      out += p1[i];
-    }
-    return out;
+    return deterministic_sum<std::complex<double> >(size, data + offset);
   }
   std::complex<double> dot(const ComplexVector &a) const {
     assert(a.size == size);
-    std::complex<double> out = 0;
-    const std::complex<double> *p1 = data + offset, *p2 = a.data + a.offset;
-    for (long i=0; i<size; i++) {
-      out += p1[i]*p2[i];
-    }
-    return out;
+    typedef const std::complex<double> *ptr;
+    ptr p1 = data + offset, p2 = a.data + a.offset;
+    const Products<ptr, ptr, std::complex<double> > products(p1, p2);
+    return deterministic_sum<std::complex<double> >(size, products);
+  }
+  template<typename E>
+  std::complex<double> dot(const Expression<E, std::complex<double> > &e) const {
+    return e.derived().dot(*this);
   }
   std::complex<double> norm() const {
-    std::complex<double> out = 0;
-    const std::complex<double> *p1 = data + offset;
-    for (long i=0; i<size; i++) {
-      out += p1[i]*p1[i];
-    }
-    return sqrt(out);
+    typedef const std::complex<double> *ptr;
+    const Squares<ptr, std::complex<double> > squares(data + offset);
+    return sqrt(deterministic_sum<std::complex<double> >(size, squares));
   }
   long get_size() const {
     return size;
@@ -239,18 +240,15 @@ public:
 
 private:
   long size, offset;
+  long capacity; // the number of complex numbers allocated
   std::complex<double> *data;
   int *references_count; // counts how many objects refer to the data.
+  friend class Leaf<ComplexVector>;
   friend Vector ifft(long Nx, long Ny, long Nz, double dV, ComplexVector f);
   friend ComplexVector fft(long Nx, long Ny, long Nz, double dV, Vector f);
+  friend ComplexVector fft_in_place(long Nx, long Ny, long Nz, double dV, Vector &f);
+  friend Vector ifft_in_place(long Nx, long Ny, long Nz, double dV, ComplexVector &f);
+  friend void ifft_many(long Nx, long Ny, long Nz, double dV, int K,
+                        const ComplexVector *const in[], Vector *const out[]);
+  friend Vector resample(long Nx, long Ny, long Nz, const Vector &f, long Mx, long My, long Mz);
 };
-
-inline ComplexVector operator*(std::complex<double> a, const ComplexVector &b) {
-  const long sz = b.size;
-  ComplexVector out(sz);
-  const std::complex<double> *p2 = b.data + b.offset;
-  for (long i=0; i<sz; i++) {
-    out.data[i] = a*p2[i];
-  }
-  return out;
-}
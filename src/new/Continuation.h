@@ -0,0 +1,119 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <vector>
+#include "new/Minimize.h"
+
+// A Continuation minimizes a functional on a sequence of ever finer
+// grids over the same cell.  Starting from a bulk or analytic guess,
+// most iterations go into removing long-wavelength error, which a
+// coarse grid removes at a fraction of the cost.  So we minimize on
+// the coarsest grid first, resample the fields being minimized onto the
+// next finer grid (see resample in Vector.h), and minimize again,
+// which from that start needs only a few iterations to remove the
+// short-wavelength error.  Each level has its own precision, since
+// there is no point in converging a coarse level more tightly than
+// its own discretization error.
+//
+// A generated functional has its grid size fixed when it is created,
+// so the Continuation needs a function that creates the functional on
+// a given grid.  That function sets up the parameters and any fixed
+// fields (such as an external potential), and sets the fields being
+// minimized to an initial guess, which is only used on the coarsest
+// level.  The Continuation also needs the accessor of each field being
+// minimized (e.g. &SFMTFluidVeff::Veff), with which it copies the
+// solution from one level to the next.
+
+template<typename Functional>
+class Continuation {
+public:
+  typedef Functional *(*Creator)(long Nx, long Ny, long Nz);
+  typedef Vector (Functional::*Field)() const;
+
+  Continuation(Creator c) : create(c), use_preconditioning(false),
+                            use_conjugate_gradient(false) {}
+
+  void add_field(Field f) {
+    fields.push_back(f);
+  }
+  // add_level adds a grid, which should be finer than those added
+  // before it, along with the precision to which we minimize on it.
+  void add_level(long Nx, long Ny, long Nz, double precision, int maxiter = 10000000) {
+    Level l;
+    l.Nx = Nx;
+    l.Ny = Ny;
+    l.Nz = Nz;
+    l.precision = precision;
+    l.maxiter = maxiter;
+    l.energy_calcs = l.grad_calcs = l.iterations = 0;
+    levels.push_back(l);
+  }
+  void precondition(bool u) {
+    use_preconditioning = u;
+  }
+  void conjugate_gradient(bool u) {
+    use_conjugate_gradient = u;
+  }
+
+  // minimize works through the levels from coarse to fine, returning
+  // the functional on the finest level, which the caller owns.
+  Functional *minimize(Verbosity v = quiet) {
+    assert(levels.size() > 0);
+    Functional *f = 0;
+    double stepsize = 0;
+    for (unsigned l=0; l<levels.size(); l++) {
+      Level &level = levels[l];
+      Functional *next = create(level.Nx, level.Ny, level.Nz);
+      if (f) {
+        const Level &prev = levels[l-1];
+        for (unsigned i=0; i<fields.size(); i++) {
+          (next->*fields[i])() = resample(prev.Nx, prev.Ny, prev.Nz, (f->*fields[i])(),
+                                          level.Nx, level.Ny, level.Nz);
+        }
+        delete f;
+      }
+      f = next;
+
+      Minimize min(f);
+      min.set_relative_precision(0);
+      min.set_precision(level.precision);
+      min.set_maxiter(level.maxiter);
+      min.precondition(use_preconditioning);
+      min.conjugate_gradient(use_conjugate_gradient);
+      if (stepsize) {
+        // The gradient of an integral over the cell is proportional to
+        // dV, so the step that suited the previous level must be scaled
+        // up by the ratio of the numbers of grid points.
+        const Level &prev = levels[l-1];
+        min.set_stepsize(stepsize*(level.Nx*level.Ny*level.Nz)/double(prev.Nx*prev.Ny*prev.Nz));
+      }
+      if (v >= verbose) {
+        printf("==== Minimizing on a %ld x %ld x %ld grid ====\n", level.Nx, level.Ny, level.Nz);
+      }
+      while (min.improve_energy(v)) {}
+      level.energy_calcs = min.get_energy_calc_count();
+      level.grad_calcs = min.get_grad_calc_count();
+      level.iterations = min.get_iteration_count();
+      stepsize = min.recent_stepsize();
+      if (v >= verbose) min.print_info();
+    }
+    return f;
+  }
+
+  // After minimize, these report the work done on each level.
+  int get_energy_calc_count(int level) const { return levels[level].energy_calcs; }
+  int get_grad_calc_count(int level) const { return levels[level].grad_calcs; }
+  int get_iteration_count(int level) const { return levels[level].iterations; }
+private:
+  struct Level {
+    long Nx, Ny, Nz;
+    double precision;
+    int maxiter;
+    int energy_calcs, grad_calcs, iterations;
+  };
+  Creator create;
+  std::vector<Field> fields;
+  std::vector<Level> levels;
+  bool use_preconditioning, use_conjugate_gradient;
+};
@@ -0,0 +1,133 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <assert.h>
+#include <vector>
+#include "Vector.h"
+
+// A CubicSymmetry describes how the 48 operations of the cubic point
+// group (the signed permutations of x, y and z) act on an N*N*N grid
+// over one periodic cell of a crystal with a lattice site at the
+// origin, such as a simple cubic, fcc or bcc crystal.  Each grid point
+// is mapped to one of the others, so the grid splits into orbits, and
+// a field with the symmetry of the crystal is determined by its value
+// on one representative of each orbit: the irreducible wedge, which is
+// up to 48 times smaller than the grid.
+//
+// The grid may either cover the conventional cubic cell, with point
+// (i,j,k) at (i,j,k)*a/N, or the fcc primitive cell, with point (i,j,k)
+// at (i*a1 + j*a2 + k*a3)/N for the primitive lattice vectors a1 =
+// (0,1,1)a/2, a2 = (1,0,1)a/2 and a3 = (1,1,0)a/2.  Either way point
+// (i,j,k) has index (i*N + j)*N + k, as on a Vector grid.
+//
+// reduce and expand convert a field between the full grid and the
+// irreducible wedge, so a loop over the cell that computes something
+// symmetric can visit each irreducible point once, weighted by its
+// multiplicity.  If what is computed at each point has a random error
+// (as Monte-Carlo weighted densities do), weighting it by multiplicity
+// makes that error add up multiplicity times rather than its square
+// root times, so the point needs multiplicity times as many samples to
+// be as accurate as the full grid.  symmetrize averages a field over
+// the group, which is how Minimize keeps a minimization within the
+// symmetric fields.
+//
+// This saves time, not memory: the generated functionals still store
+// and FFT their fields on the full grid.
+
+class CubicSymmetry {
+public:
+  enum Cell { cubic_cell, fcc_primitive_cell };
+
+  CubicSymmetry(long n, Cell c) : N(n), cell(c), orbit_of(n*n*n, -1) {
+    for (long i=0; i<N*N*N; i++) {
+      if (orbit_of[i] >= 0) continue;
+      const long orbit = representatives.size();
+      representatives.push_back(i);
+      multiplicities.push_back(0);
+      for (int op=0; op<48; op++) {
+        const long j = apply(op, i);
+        if (orbit_of[j] < 0) {
+          orbit_of[j] = orbit;
+          multiplicities[orbit]++;
+        }
+      }
+    }
+  }
+
+  long grid_size() const { return N*N*N; }
+  long irreducible_size() const { return representatives.size(); }
+  // irreducible returns the grid index of irreducible point w, which
+  // stands for multiplicity(w) points of the grid.
+  long irreducible(long w) const { return representatives[w]; }
+  int multiplicity(long w) const { return multiplicities[w]; }
+  // orbit returns the irreducible point that grid point i maps to.
+  long orbit(long i) const { return orbit_of[i]; }
+
+  Vector reduce(const Vector &full) const {
+    assert(full.get_size() == grid_size());
+    Vector wedge(irreducible_size());
+    for (long w=0; w<irreducible_size(); w++) wedge[w] = full[representatives[w]];
+    return wedge;
+  }
+  Vector expand(const Vector &wedge) const {
+    assert(wedge.get_size() == irreducible_size());
+    Vector full(grid_size());
+    for (long i=0; i<grid_size(); i++) full[i] = wedge[orbit_of[i]];
+    return full;
+  }
+  // symmetrize averages each field in v over the group.  v may hold
+  // several fields on our grid one after another, as the data of a
+  // NewFunctional does, followed by any number of scalars, which are
+  // left as they are.
+  Vector symmetrize(const Vector &v) const {
+    const long NNN = grid_size();
+    Vector out(v.get_size());
+    out = v;
+    std::vector<double> sums(irreducible_size());
+    for (long start=0; start + NNN <= v.get_size(); start += NNN) {
+      for (long w=0; w<irreducible_size(); w++) sums[w] = 0;
+      for (long i=0; i<NNN; i++) sums[orbit_of[i]] += v[start + i];
+      for (long i=0; i<NNN; i++) {
+        out[start + i] = sums[orbit_of[i]]/multiplicities[orbit_of[i]];
+      }
+    }
+    return out;
+  }
+
+private:
+  // apply returns the grid index of operation op applied to point i.
+  // We work in integer Cartesian coordinates, in which the operations
+  // are signed permutations.
+  long apply(int op, long i) const {
+    const long a = i/(N*N), b = (i/N) % N, c = i % N;
+    long r[3];
+    if (cell == cubic_cell) {
+      r[0] = a; r[1] = b; r[2] = c;
+    } else {
+      r[0] = b + c; r[1] = a + c; r[2] = a + b;
+    }
+    static const int perms[6][3] = { {0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0} };
+    long s[3];
+    for (int d=0; d<3; d++) {
+      s[d] = r[perms[op % 6][d]];
+      if ((op/6) & (1 << d)) s[d] = -s[d];
+    }
+    long t[3];
+    if (cell == cubic_cell) {
+      t[0] = s[0]; t[1] = s[1]; t[2] = s[2];
+    } else {
+      t[0] = (-s[0] + s[1] + s[2])/2;
+      t[1] = (s[0] - s[1] + s[2])/2;
+      t[2] = (s[0] + s[1] - s[2])/2;
+    }
+    for (int d=0; d<3; d++) t[d] = ((t[d] % N) + N) % N;
+    return (t[0]*N + t[1])*N + t[2];
+  }
+
+  long N;
+  Cell cell;
+  std::vector<long> orbit_of;
+  std::vector<long> representatives;
+  std::vector<int> multiplicities;
+};
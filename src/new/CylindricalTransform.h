@@ -0,0 +1,236 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <math.h>
+#include <cassert>
+#include <fftw3.h>
+#include <vector>
+#include "Vector.h"
+#include "FFTThreads.h"
+#include "FFTWisdom.h"
+
+// The functions here transform cylindrically symmetric fields, which
+// vary only in r and z, and which we store on a 2D grid rather than a
+// full 3D grid.  We use an fft in z and a Hankel transform in r.
+//
+// The Hankel transform is the discrete one of Guizar-Sicairos and
+// Gutierrez-Vega (JOSA A 21, 53, 2004), whose grid is based on the
+// zeros j_n of J0, and which is very nearly its own inverse.  So the r
+// grid is not uniform: within a cylinder of radius R we have r_n =
+// j_n R/j_{Nr+1} and k_n = j_n/R, for n = 1..Nr, and fields are taken
+// to vanish at r = R.  cylindrical_r and cylindrical_kr return these
+// points.  The Hankel transform is a matrix multiply, costing
+// O(Nr^2 Nz), so this pays off for modest Nr, where it replaces an
+// O(N^3 log N) 3D transform.
+//
+// Concretely, each transform costs about 4 Nr^2 (Nz/2+1) flops, and
+// the J0 and J1 matrices take 16 Nr^2 bytes for each (Nr, Nz, R) we
+// use.  At Nr = Nz = 200 that is 640 kB and 16 Mflops per transform,
+// which is cheap, but both grow as Nr^2, so we refuse Nr >
+// max_cylindrical_Nr, whose matrices would take 64 MB and whose
+// transforms would cost 2 Gflops at Nz = 200.  Beyond that a fast
+// Hankel transform would be needed.  The transforms are used by
+// CylindricalWhiteBearFluid.h.
+//
+// A field holds f(r_n, z) with z varying fastest, at z = 0, dz, ...
+// with periodic boundary conditions, just like a row of a 3D grid.
+// Its transform holds F(k_n, kz) for kz = 0 .. pi/dz, in the layout
+// used by fft() on a Vector, so it has size Nr*(Nz/2+1).
+//
+// cylindrical_fft and cylindrical_ifft transform scalar fields.
+// cylindrical_vector_fft and cylindrical_vector_ifft transform the
+// radial component v_r of a vector field, whose transform is i khat_r
+// V, so that the gradient of a scalar field f has V = kr F.  (The z
+// component of a vector field is a scalar as far as r is concerned,
+// and is handled by the scalar transforms.)  The vector transforms are
+// accurate to the quadrature, but are not exact inverses.
+
+// j0_zeros returns the first n zeros of J0, found by Newton's method
+// starting from McMahon's asymptotic estimate.
+inline std::vector<double> j0_zeros(long n) {
+  std::vector<double> zeros(n);
+  for (long i=0; i<n; i++) {
+    double x = (i + 0.75)*M_PI;
+    x += 1/(8*x);
+    for (int iter=0; iter<20; iter++) {
+      const double dx = j0(x)/j1(x);
+      x += dx;
+      if (fabs(dx) < 1e-15*x) break;
+    }
+    zeros[i] = x;
+  }
+  return zeros;
+}
+
+const long max_cylindrical_Nr = 2048;
+
+class CylindricalWorkspace {
+public:
+  CylindricalWorkspace(long nr, long nz, double r)
+    : Nr(nr), Nz(nz), NzOver2(nz/2+1), R(r),
+      real_scratch(fftw_alloc_real(nr*nz)), scratch(fftw_alloc_complex(nr*(nz/2+1))),
+      r2c_plan(0), c2r_plan(0), planned_threads(0) {
+    assert(Nr <= max_cylindrical_Nr); // see the size limit above
+    const std::vector<double> zeros = j0_zeros(Nr+1);
+    const double S = zeros[Nr];
+    forward_weight.resize(Nr);
+    inverse_weight.resize(Nr);
+    for (long n=0; n<Nr; n++) {
+      const double J1sqr = j1(zeros[n])*j1(zeros[n]);
+      forward_weight[n] = 4*M_PI*R*R/(S*S*J1sqr);
+      inverse_weight[n] = 1/(M_PI*R*R*J1sqr);
+    }
+    J0_matrix.resize(Nr*Nr);
+    J1_matrix.resize(Nr*Nr);
+    for (long m=0; m<Nr; m++) {
+      for (long n=0; n<Nr; n++) {
+        const double x = zeros[m]*zeros[n]/S; // k_m r_n
+        J0_matrix[m*Nr + n] = j0(x);
+        J1_matrix[m*Nr + n] = j1(x);
+      }
+    }
+  }
+  ~CylindricalWorkspace() {
+    forget_plans();
+    fftw_free(real_scratch);
+    fftw_free(scratch);
+  }
+
+  // hankel applies the Hankel transform of order 0 or 1 to each kz
+  // column of in, which is in our k-space layout.  Since J(k_m r_n) is
+  // symmetric in m and n, the same matrix serves in either direction,
+  // with weight[n] being the forward or inverse quadrature weight.
+  ComplexVector hankel(int order, const ComplexVector &in,
+                       const std::vector<double> &weight, double scale) const {
+    const std::vector<double> &J = order ? J1_matrix : J0_matrix;
+    ComplexVector out(Nr*NzOver2);
+    std::vector<std::complex<double> > row(NzOver2);
+    for (long m=0; m<Nr; m++) {
+      for (long q=0; q<NzOver2; q++) row[q] = 0;
+      for (long n=0; n<Nr; n++) {
+        const double Jw = J[m*Nr + n]*weight[n];
+        for (long q=0; q<NzOver2; q++) row[q] += Jw*in[n*NzOver2 + q];
+      }
+      for (long q=0; q<NzOver2; q++) out[m*NzOver2 + q] = scale*row[q];
+    }
+    return out;
+  }
+  // zfft and izfft do the unnormalized fft in z of each r row.
+  ComplexVector zfft(const Vector &f) {
+    make_plans();
+    for (long i=0; i<Nr*Nz; i++) real_scratch[i] = f[i];
+    fftw_execute(r2c_plan);
+    ComplexVector out(Nr*NzOver2);
+    for (long i=0; i<Nr*NzOver2; i++) {
+      out[i] = std::complex<double>(scratch[i][0], scratch[i][1]);
+    }
+    return out;
+  }
+  Vector izfft(const ComplexVector &fk) {
+    make_plans();
+    for (long i=0; i<Nr*NzOver2; i++) {
+      scratch[i][0] = fk[i].real();
+      scratch[i][1] = fk[i].imag();
+    }
+    fftw_execute(c2r_plan);
+    Vector out(Nr*Nz);
+    for (long i=0; i<Nr*Nz; i++) out[i] = real_scratch[i];
+    return out;
+  }
+
+  // The quadrature weights for the forward and inverse Hankel
+  // transforms, at each r_n or k_n.
+  std::vector<double> forward_weight, inverse_weight;
+
+  static CylindricalWorkspace &get(long Nr, long Nz, double R) {
+    std::vector<CylindricalWorkspace *> &all = workspaces();
+    for (unsigned i=0; i<all.size(); i++) {
+      if (all[i]->Nr == Nr && all[i]->Nz == Nz && all[i]->R == R) return *all[i];
+    }
+    all.push_back(new CylindricalWorkspace(Nr, Nz, R));
+    return *all.back();
+  }
+  static void release_all() {
+    std::vector<CylindricalWorkspace *> &all = workspaces();
+    for (unsigned i=0; i<all.size(); i++) delete all[i];
+    all.clear();
+  }
+private:
+  CylindricalWorkspace(const CylindricalWorkspace &); // not copyable, since we own our plans
+  void operator=(const CylindricalWorkspace &);
+
+  // We plan (with FFTW_MEASURE, which clobbers the arrays) on our own
+  // scratch arrays, which are the only ones we ever transform.
+  void make_plans() {
+    if (planned_threads != fft_threads()) {
+      forget_plans();
+      planned_threads = fft_threads();
+    }
+    if (r2c_plan) return;
+    use_fft_wisdom();
+    plan_with_fft_threads(planned_threads);
+    const int n[1] = { int(Nz) };
+    r2c_plan = fftw_plan_many_dft_r2c(1, n, Nr, real_scratch, 0, 1, Nz,
+                                      scratch, 0, 1, NzOver2, FFTW_MEASURE);
+    c2r_plan = fftw_plan_many_dft_c2r(1, n, Nr, scratch, 0, 1, NzOver2,
+                                      real_scratch, 0, 1, Nz, FFTW_MEASURE);
+  }
+  void forget_plans() {
+    if (r2c_plan) fftw_destroy_plan(r2c_plan);
+    if (c2r_plan) fftw_destroy_plan(c2r_plan);
+    r2c_plan = 0;
+    c2r_plan = 0;
+  }
+  static std::vector<CylindricalWorkspace *> &workspaces() {
+    static std::vector<CylindricalWorkspace *> all;
+    return all;
+  }
+
+  long Nr, Nz, NzOver2;
+  double R;
+  std::vector<double> J0_matrix, J1_matrix; // J(k_m r_n), indexed by m*Nr + n
+  double *real_scratch;
+  fftw_complex *scratch;
+  fftw_plan r2c_plan, c2r_plan;
+  int planned_threads;
+};
+
+inline Vector cylindrical_r(long Nr, double R) {
+  const std::vector<double> zeros = j0_zeros(Nr+1);
+  Vector r(Nr);
+  for (long n=0; n<Nr; n++) r[n] = zeros[n]*R/zeros[Nr];
+  return r;
+}
+
+inline Vector cylindrical_kr(long Nr, double R) {
+  const std::vector<double> zeros = j0_zeros(Nr);
+  Vector k(Nr);
+  for (long n=0; n<Nr; n++) k[n] = zeros[n]/R;
+  return k;
+}
+
+// In each of the following, Lz is the length of the cell in z, so dz
+// is Lz/Nz.
+
+inline ComplexVector cylindrical_fft(long Nr, long Nz, double R, double Lz, const Vector &f) {
+  CylindricalWorkspace &w = CylindricalWorkspace::get(Nr, Nz, R);
+  return w.hankel(0, w.zfft(f), w.forward_weight, Lz/Nz);
+}
+
+inline Vector cylindrical_ifft(long Nr, long Nz, double R, double Lz, const ComplexVector &fk) {
+  CylindricalWorkspace &w = CylindricalWorkspace::get(Nr, Nz, R);
+  return w.izfft(w.hankel(0, fk, w.inverse_weight, 1/Lz));
+}
+
+inline ComplexVector cylindrical_vector_fft(long Nr, long Nz, double R, double Lz,
+                                            const Vector &v) {
+  CylindricalWorkspace &w = CylindricalWorkspace::get(Nr, Nz, R);
+  return w.hankel(1, w.zfft(v), w.forward_weight, -Lz/Nz);
+}
+
+inline Vector cylindrical_vector_ifft(long Nr, long Nz, double R, double Lz,
+                                      const ComplexVector &vk) {
+  CylindricalWorkspace &w = CylindricalWorkspace::get(Nr, Nz, R);
+  return w.izfft(w.hankel(1, vk, w.inverse_weight, -1/Lz));
+}
@@ -0,0 +1,212 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <stdio.h>
+#include "NewFunctional.h"
+#include "CylindricalTransform.h"
+#include "WhiteBearPhi.h"
+
+// A CylindricalWhiteBearFluid is the White Bear hard-sphere fluid of
+// RadialWhiteBearFluid, for systems that are symmetric about the z
+// axis, such as the fluid around a rod or in a cylindrical pore, or
+// around a spherical solute on the axis.  It uses the (r, z) grid of
+// CylindricalTransform.h, within a cylinder of radius Rcyl that is
+// periodic in z with length Lz, so it needs Nr*Nz points rather than
+// the N^2*Nz of a 3D grid.  As with RadialWhiteBearFluid, the weighted
+// densities are computed from n - n_b, where n_b is the density at the
+// wall of the cylinder, and Veff is held fixed in a shell next to the
+// wall, where the fluid should either be bulk-like or absent.  Grid
+// point (r_n, z) holds a volume A_n dz, where A_n is the area weight of
+// the Hankel transform.
+//
+// The weight functions are smeared as in the generated code, with dz
+// in place of dr, which spreads them by a Gaussian of width sqrt(12)
+// dz.  Since dz is usually much coarser than the dr of a radial grid,
+// the shell is 2R plus six of these widths thick (rather than just 2R),
+// so that no point outside it feels the wall.  See
+// CylindricalTransform.h for the cost (and size limit) of the Hankel
+// transforms.
+
+class CylindricalWhiteBearFluid : public NewFunctional {
+public:
+  CylindricalWhiteBearFluid(long Nr, long Nz, double Rcyl, double Lz)
+    : myNr(Nr), myNz(Nz), myRcyl(Rcyl), myLz(Lz), myR(0.5), mykT(1), mymu(0),
+      myVext(Nr*Nz) {
+    data = Vector(Nr*Nz);
+    data = 0.0;
+    myVext = 0.0;
+  }
+
+  long Nr() const { return myNr; }
+  long Nz() const { return myNz; }
+  // r_fixed is the inner radius of the shell in which Veff is fixed.
+  double r_fixed() const { return myRcyl - 2*myR - 6*sqrt(12.0)*myLz/myNz; }
+  double &R() { return myR; }
+  double R() const { return myR; }
+  double &kT() { return mykT; }
+  double kT() const { return mykT; }
+  double &mu() { return mymu; }
+  double mu() const { return mymu; }
+  Vector &Vext() { return myVext; }
+  const Vector &Vext() const { return myVext; }
+  Vector Veff() const { return data; }
+
+  // get_r and get_z return the position of each grid point, with z
+  // varying fastest.
+  Vector get_r() const {
+    const Vector r = cylindrical_r(myNr, myRcyl);
+    Vector out(myNr*myNz);
+    for (long n=0; n<myNr; n++) {
+      for (long q=0; q<myNz; q++) out[n*myNz + q] = r[n];
+    }
+    return out;
+  }
+  Vector get_z() const {
+    Vector out(myNr*myNz);
+    for (long n=0; n<myNr; n++) {
+      for (long q=0; q<myNz; q++) out[n*myNz + q] = q*myLz/myNz;
+    }
+    return out;
+  }
+  Vector get_n() const {
+    Vector n(myNr*myNz);
+    for (long i=0; i<myNr*myNz; i++) n[i] = exp(-data[i]/mykT);
+    return n;
+  }
+  // get_volume returns the volume held by each grid point.
+  Vector get_volume() const {
+    const std::vector<double> &area =
+      CylindricalWorkspace::get(myNr, myNz, myRcyl).forward_weight;
+    Vector vol(myNr*myNz);
+    for (long n=0; n<myNr; n++) {
+      for (long q=0; q<myNz; q++) vol[n*myNz + q] = area[n]*myLz/myNz;
+    }
+    return vol;
+  }
+  Vector get_n3() const {
+    Vector n3, n2, n2vr, n2vz;
+    weighted_densities(get_n(), &n3, &n2, &n2vr, &n2vz);
+    return n3;
+  }
+
+  double energy() const {
+    return energy_and_grad(0);
+  }
+  Vector grad() const {
+    Vector g(myNr*myNz);
+    energy_and_grad(&g);
+    return g;
+  }
+  bool have_preconditioner() const { return true; }
+  EnergyGradAndPrecond energy_grad_and_precond() const {
+    EnergyGradAndPrecond egp;
+    egp.grad = Vector(myNr*myNz);
+    egp.energy = energy_and_grad(&egp.grad);
+    const Vector n = get_n();
+    egp.precond = Vector(myNr*myNz);
+    for (long i=0; i<myNr*myNz; i++) egp.precond[i] = egp.grad[i]/n[i];
+    return egp;
+  }
+  void printme(const char *prefix) const {
+    printf("%sCylindricalWhiteBearFluid with %ld x %ld points\n", prefix, myNr, myNz);
+    printf("%s    total energy = %.15g\n", prefix, energy());
+  }
+
+private:
+  // kz returns the wave vector in z of column q of a transform.  We
+  // leave out the Nyquist column when taking a derivative, since its
+  // imaginary part is lost in the inverse transform.
+  double kz(long q) const { return 2*M_PI*q/myLz; }
+  double dkz(long q) const { return 2*q == myNz ? 0 : kz(q); }
+  // weighted_densities computes n3, n2 and the r and z components of
+  // n2v from the density n.
+  void weighted_densities(const Vector &n, Vector *n3, Vector *n2,
+                          Vector *n2vr, Vector *n2vz) const {
+    const long NzOver2 = myNz/2 + 1;
+    const double nb = n[(myNr-1)*myNz];
+    Vector dn(myNr*myNz);
+    for (long i=0; i<myNr*myNz; i++) dn[i] = n[i] - nb;
+    const ComplexVector nk = cylindrical_fft(myNr, myNz, myRcyl, myLz, dn);
+    const Vector kr = cylindrical_kr(myNr, myRcyl);
+    ComplexVector n3k(myNr*NzOver2), n2k(myNr*NzOver2), n2vrk(myNr*NzOver2), n2vzk(myNr*NzOver2);
+    for (long m=0; m<myNr; m++) {
+      for (long q=0; q<NzOver2; q++) {
+        const long i = m*NzOver2 + q;
+        const double k = sqrt(kr[m]*kr[m] + kz(q)*kz(q)), dz = myLz/myNz;
+        const double w3 = white_bear_w3(myR, dz, k);
+        n3k[i] = w3*nk[i];
+        n2k[i] = white_bear_w2(myR, dz, k)*nk[i];
+        // n2v = -grad n3
+        n2vrk[i] = -kr[m]*w3*nk[i];
+        n2vzk[i] = std::complex<double>(0, -dkz(q)*w3)*nk[i];
+      }
+    }
+    *n3 = cylindrical_ifft(myNr, myNz, myRcyl, myLz, n3k);
+    *n2 = cylindrical_ifft(myNr, myNz, myRcyl, myLz, n2k);
+    *n2vr = cylindrical_vector_ifft(myNr, myNz, myRcyl, myLz, n2vrk);
+    *n2vz = cylindrical_ifft(myNr, myNz, myRcyl, myLz, n2vzk);
+    for (long i=0; i<myNr*myNz; i++) {
+      (*n3)[i] += nb*(4*M_PI/3)*myR*myR*myR;
+      (*n2)[i] += nb*4*M_PI*myR*myR;
+    }
+  }
+  // energy_and_grad returns the energy, and also computes its gradient
+  // with respect to Veff if grad is nonzero.  As in
+  // RadialWhiteBearFluid, the gradient is the exact derivative of the
+  // energy on our grid: the Hankel matrices are symmetric, so the
+  // transpose of each transform (weighted by the volumes of the grid
+  // points) is the matching inverse transform, even though the two are
+  // not quite inverses of one another.
+  double energy_and_grad(Vector *grad) const {
+    const long N = myNr*myNz, NzOver2 = myNz/2 + 1;
+    const Vector n = get_n(), vol = get_volume();
+    Vector n3, n2, n2vr, n2vz;
+    weighted_densities(n, &n3, &n2, &n2vr, &n2vz);
+    const double lognQ = 1.5*log(18.01528*1822.8885*mykT/(2*M_PI)); // as in IdealGas.hs
+    double e = 0;
+    Vector d_n3(N), d_n2(N), d_n2vr(N), d_n2vz(N);
+    for (long i=0; i<N; i++) {
+      const WhiteBearPhi p = white_bear_phi(myR, n2[i], n3[i], n2vr[i]*n2vr[i] + n2vz[i]*n2vz[i]);
+      e += vol[i]*(mykT*p.phi - n[i]*(data[i] + mykT*(1 + lognQ)) + (myVext[i] - mymu)*n[i]);
+      d_n3[i] = mykT*p.d_n3;
+      d_n2[i] = mykT*p.d_n2;
+      d_n2vr[i] = 2*mykT*p.d_n2v_sqr*n2vr[i];
+      d_n2vz[i] = 2*mykT*p.d_n2v_sqr*n2vz[i];
+    }
+    if (!grad) return e;
+
+    const Vector kr = cylindrical_kr(myNr, myRcyl);
+    const ComplexVector d_n3k = cylindrical_fft(myNr, myNz, myRcyl, myLz, d_n3),
+      d_n2k = cylindrical_fft(myNr, myNz, myRcyl, myLz, d_n2),
+      d_n2vrk = cylindrical_vector_fft(myNr, myNz, myRcyl, myLz, d_n2vr),
+      d_n2vzk = cylindrical_fft(myNr, myNz, myRcyl, myLz, d_n2vz);
+    ComplexVector dk(myNr*NzOver2);
+    for (long m=0; m<myNr; m++) {
+      for (long q=0; q<NzOver2; q++) {
+        const long i = m*NzOver2 + q;
+        const double k = sqrt(kr[m]*kr[m] + kz(q)*kz(q)), dz = myLz/myNz;
+        const double w3 = white_bear_w3(myR, dz, k);
+        // The transpose of -i kz is +i kz, and that of the vector
+        // transform of -kr is -kr times the scalar transform.
+        dk[i] = w3*d_n3k[i] + white_bear_w2(myR, dz, k)*d_n2k[i] - kr[m]*w3*d_n2vrk[i]
+          + std::complex<double>(0, dkz(q)*w3)*d_n2vzk[i];
+      }
+    }
+    const Vector d_n = cylindrical_ifft(myNr, myNz, myRcyl, myLz, dk);
+    const Vector r = get_r();
+    for (long i=0; i<N; i++) {
+      if (r[i] > r_fixed()) {
+        (*grad)[i] = 0;
+      } else {
+        const double dE_dn = d_n[i] - data[i] - mykT*lognQ + myVext[i] - mymu;
+        (*grad)[i] = -vol[i]*n[i]/mykT*dE_dn;
+      }
+    }
+    return e;
+  }
+
+  long myNr, myNz;
+  double myRcyl, myLz, myR, mykT, mymu;
+  Vector myVext;
+};
@@ -0,0 +1,185 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+#include <fftw3.h>
+#ifdef DEFT_MPI
+#include <mpi.h>
+#include <fftw3-mpi.h>
+#endif
+
+// When deft is built with DEFT_MPI (see fac/configure.py) and run
+// under mpirun, a grid can be split among the processes ("ranks"), so
+// that it needs no more memory on any one machine than its share.  We
+// split it into slabs of whole x planes, the same decomposition that
+// fftw's MPI interface uses, so each rank holds planes x_start to
+// x_start + local_nx - 1 of every field, both in real space and in
+// reciprocal space.
+//
+// A Vector on a slab-decomposed grid simply holds this rank's slab, so
+// elementwise arithmetic needs no communication at all.  The fft and
+// ifft in Vector.h transform the slabs together, and the integrals in
+// generated code and the dot products in Minimize add up their parts
+// with sum_over_ranks.  Scalars stored alongside the fields (such as
+// the lattice constants or the temperature) are held by every rank, so
+// a functional's dot (see NewFunctional.h), which Minimize uses, must
+// count them only once, which the generated functionals do by leaving
+// them out on every rank but rank zero.
+//
+// distributed_init must be called at the start of main, and
+// distributed_finalize at its end.  Without them, or without DEFT_MPI,
+// there is a single rank holding the whole grid, and all of the below
+// reduces to what we would have done anyway.
+
+struct DistributedState {
+  int rank, ranks;
+};
+
+inline DistributedState &distributed_state() {
+  static DistributedState s = { 0, 1 };
+  return s;
+}
+
+inline void distributed_init(int *argc, char ***argv) {
+#ifdef DEFT_MPI
+  int already;
+  MPI_Initialized(&already);
+  if (!already) MPI_Init(argc, argv);
+  fftw_mpi_init();
+  MPI_Comm_rank(MPI_COMM_WORLD, &distributed_state().rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &distributed_state().ranks);
+#else
+  (void)argc;
+  (void)argv;
+#endif
+}
+
+inline void distributed_finalize() {
+#ifdef DEFT_MPI
+  fftw_mpi_cleanup();
+  MPI_Finalize();
+  distributed_state().rank = 0;
+  distributed_state().ranks = 1;
+#endif
+}
+
+// my_rank is a number from zero to rank_count() - 1.  Rank zero is the
+// one that should do any printing or writing of files.
+inline int my_rank() { return distributed_state().rank; }
+inline int rank_count() { return distributed_state().ranks; }
+
+// sum_over_ranks adds up x over all ranks.  Every rank adds the same
+// numbers in the same order, so they all get the same answer, and a
+// given number of ranks always gives the same answer.
+inline double sum_over_ranks(double x) {
+#ifdef DEFT_MPI
+  if (rank_count() > 1) {
+    std::vector<double> all(rank_count());
+    MPI_Allgather(&x, 1, MPI_DOUBLE, &all[0], 1, MPI_DOUBLE, MPI_COMM_WORLD);
+    x = 0;
+    for (int r=0; r<rank_count(); r++) x += all[r];
+  }
+#endif
+  return x;
+}
+
+// A Slab describes this rank's share of an Nx*Ny*Nz grid.
+struct Slab {
+  long Nx, Ny, Nz;
+  long local_nx, x_start;
+  long alloc_complex; // the complex numbers fftw needs for our part of a transform
+
+  long real_size() const { return local_nx*Ny*Nz; }
+  long complex_size() const { return local_nx*Ny*(Nz/2 + 1); }
+};
+
+// slab returns our share of the grid, which is worked out (by fftw, so
+// that our transforms agree with it) the first time that grid is seen.
+inline const Slab &slab(long Nx, long Ny, long Nz) {
+  static std::vector<Slab *> *all = new std::vector<Slab *>;
+  for (unsigned i=0; i<all->size(); i++) {
+    const Slab &s = *(*all)[i];
+    if (s.Nx == Nx && s.Ny == Ny && s.Nz == Nz) return s;
+  }
+  Slab &s = *new Slab;
+  s.Nx = Nx;
+  s.Ny = Ny;
+  s.Nz = Nz;
+  s.local_nx = Nx;
+  s.x_start = 0;
+  s.alloc_complex = Nx*Ny*(Nz/2 + 1);
+#ifdef DEFT_MPI
+  if (rank_count() > 1) {
+    ptrdiff_t local_n0, local_0_start;
+    s.alloc_complex = fftw_mpi_local_size_3d(Nx, Ny, Nz/2 + 1, MPI_COMM_WORLD,
+                                             &local_n0, &local_0_start);
+    s.local_nx = local_n0;
+    s.x_start = local_0_start;
+    if (s.local_nx == 0) {
+      // An empty Vector means one that hasn't been set, so every rank
+      // needs at least one plane.  fftw gives all but the last rank the
+      // same number, so e.g. 12 planes can't be split among 5 ranks.
+      fprintf(stderr, "Rank %d has no x planes of the %ldx%ldx%ld grid: use fewer ranks.\n",
+              my_rank(), Nx, Ny, Nz);
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+  }
+#endif
+  all->push_back(&s);
+  return s;
+}
+
+// slab_size, slab_ksize and slab_x_start are what generated code uses
+// in place of Nx*Ny*Nz, Nx*Ny*(Nz/2+1) and zero.
+inline long slab_size(long Nx, long Ny, long Nz) {
+  return rank_count() > 1 ? slab(Nx, Ny, Nz).real_size() : Nx*Ny*Nz;
+}
+inline long slab_ksize(long Nx, long Ny, long Nz) {
+  return rank_count() > 1 ? slab(Nx, Ny, Nz).complex_size() : Nx*Ny*(Nz/2 + 1);
+}
+inline long slab_x_start(long Nx, long Ny, long Nz) {
+  return rank_count() > 1 ? slab(Nx, Ny, Nz).x_start : 0;
+}
+
+// gather_slabs puts together every rank's slab of a real-space field,
+// giving every rank the entire field.  This is for output, and for
+// testing: the point of slabs is to never need the entire field.
+inline void gather_slabs(const Slab &s, const double *local, double *full) {
+#ifdef DEFT_MPI
+  if (rank_count() > 1) {
+    std::vector<int> counts(rank_count()), starts(rank_count());
+    int mine = s.real_size();
+    MPI_Allgather(&mine, 1, MPI_INT, &counts[0], 1, MPI_INT, MPI_COMM_WORLD);
+    for (int r=1; r<rank_count(); r++) starts[r] = starts[r-1] + counts[r-1];
+    MPI_Allgatherv(const_cast<double *>(local), mine, MPI_DOUBLE,
+                   full, &counts[0], &starts[0], MPI_DOUBLE, MPI_COMM_WORLD);
+    return;
+  }
+#endif
+  for (long i=0; i<s.real_size(); i++) full[i] = local[i];
+}
+
+// plan_slab_r2c and plan_slab_c2r plan a transform of our slab, in
+// place in an array of s.alloc_complex complex numbers, in which the
+// real data is in fftw's padded layout.  Like every planning under
+// MPI, they must be called by all ranks at once.
+inline fftw_plan plan_slab_r2c(const Slab &s, fftw_complex *inout, unsigned flags) {
+#ifdef DEFT_MPI
+  fftw_mpi_broadcast_wisdom(MPI_COMM_WORLD); // all ranks must make the same plan
+  return fftw_mpi_plan_dft_r2c_3d(s.Nx, s.Ny, s.Nz, (double *)inout, inout,
+                                  MPI_COMM_WORLD, flags);
+#else
+  return fftw_plan_dft_r2c_3d(s.Nx, s.Ny, s.Nz, (double *)inout, inout, flags);
+#endif
+}
+inline fftw_plan plan_slab_c2r(const Slab &s, fftw_complex *inout, unsigned flags) {
+#ifdef DEFT_MPI
+  fftw_mpi_broadcast_wisdom(MPI_COMM_WORLD);
+  return fftw_mpi_plan_dft_c2r_3d(s.Nx, s.Ny, s.Nz, inout, (double *)inout,
+                                  MPI_COMM_WORLD, flags);
+#else
+  return fftw_plan_dft_c2r_3d(s.Nx, s.Ny, s.Nz, inout, (double *)inout, flags);
+#endif
+}
@@ -0,0 +1,315 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <cassert>
+#include <complex>
+#include <functional>
+#include <math.h>
+#include <type_traits>
+#include "FieldThreads.h"
+
+// This file makes the arithmetic operators on Vector and ComplexVector
+// lazy.  Writing a + 2*b - c doesn't compute anything: it builds a
+// small object (an expression template) that refers to a, b and c, and
+// knows how to compute any one element of the result.  The work is
+// done when the expression is assigned to a Vector (or used to
+// construct one), added to one with += or -=, or reduced with sum, dot
+// or norm, and it is done in a single loop with no temporary arrays.
+// Done eagerly, a + 2*b - c would allocate three full arrays and make
+// three passes over each of them.  The loops are split across threads
+// and vectorized as described in FieldThreads.h.
+//
+// An expression holds reference-counted copies of the Vectors it uses,
+// so it is safe to keep one around, but it is computed afresh each
+// time it is used.  As before, + and - treat an empty Vector as zero.
+//
+// Assigning an expression to a Vector that overlaps one of its
+// operands at a different offset (e.g. v.slice(0,n) = v.slice(1,n) +
+// w) goes through a temporary, so the result is the same as it would
+// be if the expression were computed first.  An operand at the same
+// offset, as in d = -g + beta*d, is safe, since each element is read
+// before it is written.
+
+class Vector;
+class ComplexVector;
+
+// ExpressionBase marks expressions, so that the operators below apply
+// only to Vectors, ComplexVectors and expressions made from them.
+struct ExpressionBase {};
+
+// Each expression E provides get_size(), operator[], has_empty(),
+// value_or_zero() (which is like operator[], but treats any empty
+// Vector within the expression as zero), and overlaps(begin, end),
+// which says whether any of its Vectors overlaps memory between begin
+// and end, other than by starting at begin.
+template<typename E, typename T>
+class Expression : public ExpressionBase {
+public:
+  typedef T value_type;
+  const E &derived() const { return static_cast<const E &>(*this); }
+  T sum() const;
+  T norm() const;
+  template<typename X> T dot(const X &x) const;
+};
+
+// ZeroingExpression is the slow path for expressions with an empty
+// Vector in them.
+template<typename E>
+class ZeroingExpression {
+public:
+  explicit ZeroingExpression(const E &x) : e(x) {}
+  typename E::value_type operator[](long i) const { return e.value_or_zero(i); }
+private:
+  const E &e;
+};
+
+template<typename T, typename E>
+inline void evaluate_loop(T *out, long n, const E &e) {
+  DEFT_PRAGMA(omp parallel for simd num_threads(field_threads()) if(parallel_threads(n) > 1))
+  for (long i=0; i<n; i++) out[i] = e[i];
+}
+
+// evaluate stores the value of the expression e in out, which must
+// have room for e.get_size() values.
+template<typename E, typename T>
+inline void evaluate(T *out, const Expression<E,T> &x) {
+  const E &e = x.derived();
+  if (e.has_empty()) evaluate_loop(out, e.get_size(), ZeroingExpression<E>(e));
+  else evaluate_loop(out, e.get_size(), e);
+}
+
+template<typename E, typename T>
+T Expression<E,T>::sum() const {
+  const E &e = derived();
+  if (e.has_empty()) return deterministic_sum<T>(e.get_size(), ZeroingExpression<E>(e));
+  return deterministic_sum<T>(e.get_size(), e);
+}
+
+template<typename E, typename T>
+T Expression<E,T>::norm() const {
+  const E &e = derived();
+  if (e.has_empty()) {
+    const ZeroingExpression<E> z(e);
+    return sqrt(deterministic_sum<T>(e.get_size(), Squares<ZeroingExpression<E>, T>(z)));
+  }
+  return sqrt(deterministic_sum<T>(e.get_size(), Squares<E, T>(e)));
+}
+
+// A Leaf is a Vector (or ComplexVector) within an expression.
+template<typename V>
+class Leaf : public Expression<Leaf<V>, typename V::value_type> {
+public:
+  typedef typename V::value_type value_type;
+  explicit Leaf(const V &x) : v(x), p(x.data + x.offset), n(x.size) {}
+  long get_size() const { return n; }
+  value_type operator[](long i) const { return p[i]; }
+  bool has_empty() const { return n == 0; }
+  value_type value_or_zero(long i) const { return n ? p[i] : value_type(0); }
+  bool overlaps(const void *begin, const void *end) const {
+    const std::less<const void *> before;
+    return n && (const void *)p != begin && before(p, end) && before(begin, p + n);
+  }
+private:
+  V v; // holds a reference to the data, so it outlives the expression
+  const value_type *p;
+  long n;
+};
+
+// Operand<X>::wrap turns a Vector or ComplexVector into a Leaf, and
+// leaves an expression as it is.
+template<typename X, bool is_vector = std::is_same<X, Vector>::value ||
+                                      std::is_same<X, ComplexVector>::value>
+struct Operand {
+  typedef X type;
+  static const X &wrap(const X &x) { return x; }
+};
+template<typename X> struct Operand<X, true> {
+  typedef Leaf<X> type;
+  static type wrap(const X &x) { return type(x); }
+};
+
+template<typename X> struct is_operand {
+  static const bool value = std::is_base_of<ExpressionBase, X>::value ||
+    std::is_same<X, Vector>::value || std::is_same<X, ComplexVector>::value;
+};
+
+struct AddOp {
+  template<typename T> static T apply(T a, T b) { return a + b; }
+};
+struct SubtractOp {
+  template<typename T> static T apply(T a, T b) { return a - b; }
+};
+struct MultiplyOp {
+  template<typename T> static T apply(T a, T b) { return a*b; }
+};
+struct ScaleOp {
+  template<typename T> static T apply(T a, T s) { return s*a; }
+};
+struct DivideOp {
+  template<typename T> static T apply(T a, T s) { return a/s; }
+};
+struct ShiftOp {
+  template<typename T> static T apply(T a, T s) { return a + s; }
+};
+struct PowOp {
+  template<typename T> static T apply(T a, T s) { using std::pow; return pow(a, s); }
+};
+struct NegateOp {
+  template<typename T> static T apply(T a) { return -a; }
+};
+struct ExpOp {
+  template<typename T> static T apply(T a) { using std::exp; return exp(a); }
+};
+struct LogOp {
+  template<typename T> static T apply(T a) { using std::log; return log(a); }
+};
+
+// A BinaryExpression combines two expressions element by element.
+template<typename A, typename B, typename Op>
+class BinaryExpression : public Expression<BinaryExpression<A,B,Op>, typename A::value_type> {
+  static_assert(std::is_same<typename A::value_type, typename B::value_type>::value,
+                "Vectors and ComplexVectors can't be mixed");
+public:
+  typedef typename A::value_type value_type;
+  BinaryExpression(const A &x, const B &y) : a(x), b(y) {
+    assert(!a.get_size() || !b.get_size() || a.get_size() == b.get_size());
+  }
+  long get_size() const { return a.get_size() ? a.get_size() : b.get_size(); }
+  value_type operator[](long i) const { return Op::apply(a[i], b[i]); }
+  bool has_empty() const { return a.has_empty() || b.has_empty(); }
+  value_type value_or_zero(long i) const {
+    return Op::apply(a.value_or_zero(i), b.value_or_zero(i));
+  }
+  bool overlaps(const void *begin, const void *end) const {
+    return a.overlaps(begin, end) || b.overlaps(begin, end);
+  }
+private:
+  A a;
+  B b;
+};
+
+// A ScalarExpression combines each element of an expression with a
+// scalar.  Since an empty Vector times a scalar is empty (and thus
+// zero), rather than being the scalar, it checks the size in the slow
+// path.
+template<typename A, typename Op>
+class ScalarExpression : public Expression<ScalarExpression<A,Op>, typename A::value_type> {
+public:
+  typedef typename A::value_type value_type;
+  ScalarExpression(const A &x, value_type scalar) : a(x), s(scalar) {}
+  long get_size() const { return a.get_size(); }
+  value_type operator[](long i) const { return Op::apply(a[i], s); }
+  bool has_empty() const { return a.has_empty(); }
+  value_type value_or_zero(long i) const {
+    return a.get_size() ? Op::apply(a.value_or_zero(i), s) : value_type(0);
+  }
+  bool overlaps(const void *begin, const void *end) const { return a.overlaps(begin, end); }
+private:
+  A a;
+  value_type s;
+};
+
+// A UnaryExpression applies a function (such as exp) to each element
+// of an expression.  Like a ScalarExpression, it checks the size in
+// the slow path, since exp of an empty Vector is empty.
+template<typename A, typename Op>
+class UnaryExpression : public Expression<UnaryExpression<A,Op>, typename A::value_type> {
+public:
+  typedef typename A::value_type value_type;
+  explicit UnaryExpression(const A &x) : a(x) {}
+  long get_size() const { return a.get_size(); }
+  value_type operator[](long i) const { return Op::apply(a[i]); }
+  bool has_empty() const { return a.has_empty(); }
+  value_type value_or_zero(long i) const {
+    return a.get_size() ? Op::apply(a.value_or_zero(i)) : value_type(0);
+  }
+  bool overlaps(const void *begin, const void *end) const { return a.overlaps(begin, end); }
+private:
+  A a;
+};
+
+template<typename E, typename T> template<typename X>
+T Expression<E,T>::dot(const X &x) const {
+  const E &e = derived();
+  assert(e.get_size() == Operand<X>::wrap(x).get_size());
+  return BinaryExpression<E, typename Operand<X>::type, MultiplyOp>(e, Operand<X>::wrap(x)).sum();
+}
+
+// Below are the operators themselves.
+
+template<typename X, typename Y>
+inline typename std::enable_if<is_operand<X>::value && is_operand<Y>::value,
+                               BinaryExpression<typename Operand<X>::type,
+                                                typename Operand<Y>::type, AddOp> >::type
+operator+(const X &x, const Y &y) {
+  return BinaryExpression<typename Operand<X>::type, typename Operand<Y>::type, AddOp>
+    (Operand<X>::wrap(x), Operand<Y>::wrap(y));
+}
+
+template<typename X, typename Y>
+inline typename std::enable_if<is_operand<X>::value && is_operand<Y>::value,
+                               BinaryExpression<typename Operand<X>::type,
+                                                typename Operand<Y>::type, SubtractOp> >::type
+operator-(const X &x, const Y &y) {
+  return BinaryExpression<typename Operand<X>::type, typename Operand<Y>::type, SubtractOp>
+    (Operand<X>::wrap(x), Operand<Y>::wrap(y));
+}
+
+template<typename X>
+inline typename std::enable_if<is_operand<X>::value,
+                               UnaryExpression<typename Operand<X>::type, NegateOp> >::type
+operator-(const X &x) {
+  return UnaryExpression<typename Operand<X>::type, NegateOp>(Operand<X>::wrap(x));
+}
+
+template<typename X>
+inline typename std::enable_if<is_operand<X>::value,
+                               ScalarExpression<typename Operand<X>::type, ScaleOp> >::type
+operator*(typename Operand<X>::type::value_type s, const X &x) {
+  return ScalarExpression<typename Operand<X>::type, ScaleOp>(Operand<X>::wrap(x), s);
+}
+
+template<typename X>
+inline typename std::enable_if<is_operand<X>::value,
+                               ScalarExpression<typename Operand<X>::type, ScaleOp> >::type
+operator*(const X &x, typename Operand<X>::type::value_type s) {
+  return ScalarExpression<typename Operand<X>::type, ScaleOp>(Operand<X>::wrap(x), s);
+}
+
+template<typename X>
+inline typename std::enable_if<is_operand<X>::value,
+                               ScalarExpression<typename Operand<X>::type, DivideOp> >::type
+operator/(const X &x, typename Operand<X>::type::value_type s) {
+  return ScalarExpression<typename Operand<X>::type, DivideOp>(Operand<X>::wrap(x), s);
+}
+
+template<typename X>
+inline typename std::enable_if<is_operand<X>::value,
+                               ScalarExpression<typename Operand<X>::type, ShiftOp> >::type
+operator+(const X &x, typename Operand<X>::type::value_type s) {
+  return ScalarExpression<typename Operand<X>::type, ShiftOp>(Operand<X>::wrap(x), s);
+}
+
+// exp, log and pow apply elementwise, e.g. Vector n = exp(-V/kT).
+
+template<typename X>
+inline typename std::enable_if<is_operand<X>::value,
+                               UnaryExpression<typename Operand<X>::type, ExpOp> >::type
+exp(const X &x) {
+  return UnaryExpression<typename Operand<X>::type, ExpOp>(Operand<X>::wrap(x));
+}
+
+template<typename X>
+inline typename std::enable_if<is_operand<X>::value,
+                               UnaryExpression<typename Operand<X>::type, LogOp> >::type
+log(const X &x) {
+  return UnaryExpression<typename Operand<X>::type, LogOp>(Operand<X>::wrap(x));
+}
+
+template<typename X>
+inline typename std::enable_if<is_operand<X>::value,
+                               ScalarExpression<typename Operand<X>::type, PowOp> >::type
+pow(const X &x, typename Operand<X>::type::value_type power) {
+  return ScalarExpression<typename Operand<X>::type, PowOp>(Operand<X>::wrap(x), power);
+}
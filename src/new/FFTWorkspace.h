@@ -0,0 +1,425 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <string.h>
+#include <fftw3.h>
+#include <vector>
+#include "FFTThreads.h"
+#include "FFTPrecision.h"
+#include "FFTWisdom.h"
+#include "Distributed.h"
+
+// An FFTWorkspace holds everything needed to repeatedly transform
+// fields of one particular size: the fftw plans, which are made once
+// with FFTW_MEASURE and then executed over and over on whatever arrays
+// we are handed, and an aligned scratch array for the c2r transform,
+// which fftw always overwrites.  Since a minimization transforms
+// fields of the same size many times per energy evaluation, this
+// saves us from planning, allocating and freeing on every transform.
+
+// You don't normally create an FFTWorkspace yourself: fft and ifft in
+// Vector.h use FFTWorkspace::get to find the workspace for their grid,
+// which is created the first time that grid size is seen and lives
+// until release_all is called.  A workspace is not thread-safe, since
+// its scratch array is shared between calls, but the transforms
+// themselves may be multithreaded (see FFTThreads.h), and may be done
+// in single precision (see FFTPrecision.h).
+//
+// On a grid that is split among MPI ranks (see Distributed.h), the
+// arrays we are handed hold just our slab, and each transform is done
+// together with the other ranks, so every rank must transform the
+// same fields in the same order.  These transforms are always in
+// double precision.
+
+class FFTWorkspace {
+public:
+  FFTWorkspace(long nx, long ny, long nz)
+    : Nx(nx), Ny(ny), Nz(nz), NxNyNz(nx*ny*nz), NxNyNzOver2(nx*ny*(nz/2+1)),
+      by_slabs(rank_count() > 1), local_nx(slab(nx, ny, nz).local_nx),
+      scratch(by_slabs ? 0 : (fftw_complex *)fftw_malloc(NxNyNzOver2*sizeof(fftw_complex))),
+      many_scratch(0), many_scratch_fields(0), many_out(0), many_out_fields(0),
+      planned_threads(0),
+      slab_buffer(0), slab_r2c_plan(0), slab_c2r_plan(0) {
+    for (int aligned=0; aligned<2; aligned++) {
+      r2c_plans[aligned] = 0;
+      c2r_plans[aligned] = 0;
+      r2c_in_place_plans[aligned] = 0;
+      c2r_in_place_plans[aligned] = 0;
+#ifdef DEFT_FFT_SINGLE
+      single_r2c_plans[aligned] = 0;
+      single_c2r_plans[aligned] = 0;
+#endif
+    }
+  }
+  ~FFTWorkspace() {
+    forget_plans();
+    fftw_free(scratch);
+    fftw_free(many_scratch);
+    fftw_free(many_out);
+    fftw_free(slab_buffer);
+  }
+
+  // r2c performs an unnormalized forward transform, leaving its input
+  // untouched.
+  void r2c(const double *in, fftw_complex *out) {
+    const bool aligned = is_aligned(in) && is_aligned(out);
+    check_threads();
+    if (by_slabs) {
+      slab_r2c(in, Nz, out);
+      return;
+    }
+#ifdef DEFT_FFT_SINGLE
+    if (use_single()) {
+      r2c_single(in, Nz, out);
+      return;
+    }
+#endif
+    if (!r2c_plans[aligned]) make_plans(aligned);
+    fftw_execute_dft_r2c(r2c_plans[aligned], (double *)in, out);
+  }
+  // c2r performs an unnormalized backward transform.  Unlike fftw, it
+  // leaves its input untouched, since it transforms a copy held in the
+  // scratch array.
+  void c2r(const fftw_complex *in, double *out) {
+    const bool aligned = is_aligned(out);
+    check_threads();
+    if (by_slabs) {
+      slab_c2r(in, out, Nz);
+      return;
+    }
+#ifdef DEFT_FFT_SINGLE
+    if (use_single()) {
+      c2r_single(in, out, Nz);
+      return;
+    }
+#endif
+    if (!c2r_plans[aligned]) make_plans(aligned);
+    memcpy(scratch, in, NxNyNzOver2*sizeof(fftw_complex));
+    fftw_execute_dft_c2r(c2r_plans[aligned], scratch, out);
+  }
+  // r2c_in_place and c2r_in_place transform an array of
+  // Nx*Ny*(Nz/2+1) complex numbers in place, with the real data in
+  // fftw's padded layout, in which each row of Nz doubles is followed
+  // by two doubles of padding.
+  void r2c_in_place(double *inout) {
+    const bool aligned = is_aligned(inout);
+    check_threads();
+    if (by_slabs) {
+      slab_r2c(inout, 2*(Nz/2+1), (fftw_complex *)inout);
+      return;
+    }
+#ifdef DEFT_FFT_SINGLE
+    if (use_single()) {
+      r2c_single(inout, 2*(Nz/2+1), (fftw_complex *)inout);
+      return;
+    }
+#endif
+    if (!r2c_in_place_plans[aligned]) make_in_place_plans(aligned);
+    fftw_execute_dft_r2c(r2c_in_place_plans[aligned], inout, (fftw_complex *)inout);
+  }
+  void c2r_in_place(fftw_complex *inout) {
+    const bool aligned = is_aligned(inout);
+    check_threads();
+    if (by_slabs) {
+      slab_c2r(inout, (double *)inout, 2*(Nz/2+1));
+      return;
+    }
+#ifdef DEFT_FFT_SINGLE
+    if (use_single()) {
+      c2r_single(inout, (double *)inout, 2*(Nz/2+1));
+      return;
+    }
+#endif
+    if (!c2r_in_place_plans[aligned]) make_in_place_plans(aligned);
+    fftw_execute_dft_c2r(c2r_in_place_plans[aligned], inout, (double *)inout);
+  }
+  // c2r_many performs K unnormalized backward transforms with a single
+  // fftw plan, which makes better use of the cache and of threads than
+  // K separate transforms.  The K outputs are stored one after another
+  // in out, which must have room for K*Nx*Ny*Nz doubles (or K slabs).  Like c2r, it
+  // leaves its inputs untouched, at the cost of a scratch array big
+  // enough to hold K inputs, which we keep for next time.
+  void c2r_many(int K, const fftw_complex *const in[], double *out) {
+    const bool aligned = is_aligned(out);
+    check_threads();
+    if (by_slabs) {
+      for (int j=0; j<K; j++) slab_c2r(in[j], out + j*local_nx*Ny*Nz, Nz);
+      return;
+    }
+#ifdef DEFT_FFT_SINGLE
+    if (use_single()) {
+      for (int j=0; j<K; j++) c2r_single(in[j], out + j*NxNyNz, Nz);
+      return;
+    }
+#endif
+    fftw_plan p = many_plan(K, aligned);
+    for (int j=0; j<K; j++) {
+      memcpy(many_scratch + j*NxNyNzOver2, in[j], NxNyNzOver2*sizeof(fftw_complex));
+    }
+    fftw_execute_dft_c2r(p, many_scratch, out);
+  }
+
+  // many_output returns an array with room for the results of K
+  // transforms by c2r_many, which we keep for next time, so a caller
+  // can copy each result into an array of its own without allocating
+  // a new array for the whole batch each time.
+  double *many_output(int K) {
+    if (K > many_out_fields) {
+      fftw_free(many_out);
+      many_out = (double *)fftw_malloc(K*local_nx*Ny*Nz*sizeof(double));
+      many_out_fields = K;
+    }
+    return many_out;
+  }
+
+  long get_Nx() const { return Nx; }
+  long get_Ny() const { return Ny; }
+  long get_Nz() const { return Nz; }
+
+  static FFTWorkspace &get(long Nx, long Ny, long Nz) {
+    FFTWorkspace *&last = most_recent();
+    if (last && last->Nx == Nx && last->Ny == Ny && last->Nz == Nz) return *last;
+    std::vector<FFTWorkspace *> &all = workspaces();
+    for (unsigned i=0; i<all.size(); i++) {
+      if (all[i]->Nx == Nx && all[i]->Ny == Ny && all[i]->Nz == Nz) {
+        last = all[i];
+        return *last;
+      }
+    }
+    last = new FFTWorkspace(Nx, Ny, Nz);
+    all.push_back(last);
+    return *last;
+  }
+  // release_all frees every workspace, e.g. once we are done with a
+  // grid size and want the memory back.
+  static void release_all() {
+    std::vector<FFTWorkspace *> &all = workspaces();
+    for (unsigned i=0; i<all.size(); i++) delete all[i];
+    all.clear();
+    most_recent() = 0;
+  }
+private:
+  FFTWorkspace(const FFTWorkspace &); // not copyable, since we own our plans
+  void operator=(const FFTWorkspace &);
+
+  // If the number of threads has changed since we planned, our plans
+  // are no longer what was asked for.
+  void check_threads() {
+    if (planned_threads != fft_threads()) {
+      forget_plans();
+      planned_threads = fft_threads();
+    }
+  }
+  void forget_plans() {
+    for (int aligned=0; aligned<2; aligned++) {
+      if (r2c_plans[aligned]) fftw_destroy_plan(r2c_plans[aligned]);
+      if (c2r_plans[aligned]) fftw_destroy_plan(c2r_plans[aligned]);
+      r2c_plans[aligned] = 0;
+      c2r_plans[aligned] = 0;
+      if (r2c_in_place_plans[aligned]) fftw_destroy_plan(r2c_in_place_plans[aligned]);
+      if (c2r_in_place_plans[aligned]) fftw_destroy_plan(c2r_in_place_plans[aligned]);
+      r2c_in_place_plans[aligned] = 0;
+      c2r_in_place_plans[aligned] = 0;
+      for (unsigned K=0; K<c2r_many_plans[aligned].size(); K++) {
+        if (c2r_many_plans[aligned][K]) fftw_destroy_plan(c2r_many_plans[aligned][K]);
+      }
+      c2r_many_plans[aligned].clear();
+    }
+#ifdef DEFT_FFT_SINGLE
+    for (int aligned=0; aligned<2; aligned++) {
+      if (single_r2c_plans[aligned]) fftwf_destroy_plan(single_r2c_plans[aligned]);
+      if (single_c2r_plans[aligned]) fftwf_destroy_plan(single_c2r_plans[aligned]);
+      single_r2c_plans[aligned] = 0;
+      single_c2r_plans[aligned] = 0;
+    }
+#endif
+    if (slab_r2c_plan) fftw_destroy_plan(slab_r2c_plan);
+    if (slab_c2r_plan) fftw_destroy_plan(slab_c2r_plan);
+    slab_r2c_plan = 0;
+    slab_c2r_plan = 0;
+  }
+  static bool is_aligned(const void *p) {
+    return fftw_alignment_of((double *)p) == 0;
+  }
+  // We plan on our own scratch arrays, since FFTW_MEASURE overwrites
+  // the arrays it is given.  Plans for unaligned arrays are also made
+  // on aligned scratch, with the FFTW_UNALIGNED flag.
+  void make_plans(bool aligned) {
+    const unsigned flags = aligned ? FFTW_MEASURE : FFTW_MEASURE | FFTW_UNALIGNED;
+    use_fft_wisdom();
+    plan_with_fft_threads(planned_threads);
+    double *r = (double *)fftw_malloc(NxNyNz*sizeof(double));
+    if (!r2c_plans[aligned])
+      r2c_plans[aligned] = fftw_plan_dft_r2c_3d(Nx, Ny, Nz, r, scratch, flags);
+    if (!c2r_plans[aligned])
+      c2r_plans[aligned] = fftw_plan_dft_c2r_3d(Nx, Ny, Nz, scratch, r, flags);
+    fftw_free(r);
+  }
+  // The in-place plans are made on our scratch array, which is just
+  // the right size.
+  void make_in_place_plans(bool aligned) {
+    const unsigned flags = aligned ? FFTW_MEASURE : FFTW_MEASURE | FFTW_UNALIGNED;
+    use_fft_wisdom();
+    plan_with_fft_threads(planned_threads);
+    if (!r2c_in_place_plans[aligned])
+      r2c_in_place_plans[aligned] = fftw_plan_dft_r2c_3d(Nx, Ny, Nz, (double *)scratch, scratch, flags);
+    if (!c2r_in_place_plans[aligned])
+      c2r_in_place_plans[aligned] = fftw_plan_dft_c2r_3d(Nx, Ny, Nz, scratch, (double *)scratch, flags);
+  }
+  // many_plan returns the plan for K transforms at once, making it
+  // (and a big enough scratch array) if need be.
+  fftw_plan many_plan(int K, bool aligned) {
+    if (K > many_scratch_fields) {
+      // Our old plans were made for the old scratch array, which is
+      // fine, since the new-array execute functions don't care.
+      fftw_free(many_scratch);
+      many_scratch = (fftw_complex *)fftw_malloc(K*NxNyNzOver2*sizeof(fftw_complex));
+      many_scratch_fields = K;
+    }
+    std::vector<fftw_plan> &plans = c2r_many_plans[aligned];
+    if (int(plans.size()) <= K) plans.resize(K+1, 0);
+    if (!plans[K]) {
+      const unsigned flags = aligned ? FFTW_MEASURE : FFTW_MEASURE | FFTW_UNALIGNED;
+      const int n[3] = { int(Nx), int(Ny), int(Nz) };
+      use_fft_wisdom();
+      plan_with_fft_threads(planned_threads);
+      double *r = (double *)fftw_malloc(K*NxNyNz*sizeof(double));
+      plans[K] = fftw_plan_many_dft_c2r(3, n, K, many_scratch, 0, 1, NxNyNzOver2,
+                                        r, 0, 1, NxNyNz, flags);
+      fftw_free(r);
+    }
+    return plans[K];
+  }
+#ifdef DEFT_FFT_SINGLE
+  // We don't do single-precision transforms when Nz is 1, since then
+  // the float data for c2r wouldn't fit in its output (see below).
+  bool use_single() const {
+    return fft_single_precision() && Nz > 1;
+  }
+  // r2c_single and c2r_single do a transform in single precision.
+  // Rather than keep float arrays of our own, we transform in place
+  // within the output array, since a field takes half as much room in
+  // single precision: the float data fits in the first half of the
+  // complex output of r2c, and in the real output of c2r.  We narrow
+  // to float working forward through the array, and widen back to
+  // double working backward, so nothing is overwritten before it has
+  // been read, which means in and out may also be the same array.  The
+  // real data consists of Nx*Ny rows of Nz doubles, each starting
+  // rowlen doubles after the last, as in r2c_in_place.
+  void r2c_single(const double *in, long rowlen, fftw_complex *out) {
+    float *f = (float *)out;
+    const long padded = 2*(Nz/2+1);
+    for (long row=0; row<Nx*Ny; row++) {
+      for (long z=0; z<Nz; z++) narrow(in + row*rowlen + z, f + row*padded + z);
+    }
+    fftwf_complex *fk = (fftwf_complex *)out;
+    fftwf_execute_dft_r2c(single_plan(true, is_aligned_single(f)), f, fk);
+    for (long i=NxNyNzOver2-1; i>=0; i--) {
+      widen(&fk[i][1], &out[i][1]);
+      widen(&fk[i][0], &out[i][0]);
+    }
+  }
+  void c2r_single(const fftw_complex *in, double *out, long rowlen) {
+    fftwf_complex *fk = (fftwf_complex *)out;
+    for (long i=0; i<NxNyNzOver2; i++) {
+      narrow(&in[i][0], &fk[i][0]);
+      narrow(&in[i][1], &fk[i][1]);
+    }
+    float *f = (float *)out;
+    fftwf_execute_dft_c2r(single_plan(false, is_aligned_single(f)), fk, f);
+    const long padded = 2*(Nz/2+1);
+    for (long row=Nx*Ny-1; row>=0; row--) {
+      for (long z=Nz-1; z>=0; z--) widen(f + row*padded + z, out + row*rowlen + z);
+    }
+  }
+  // narrow and widen copy one number, by way of memcpy, since the
+  // float and double arrays overlap, and the compiler would otherwise
+  // assume they don't, and be free to reorder our reads and writes.
+  static void narrow(const double *from, float *to) {
+    double d;
+    memcpy(&d, from, sizeof(double));
+    const float x = float(d);
+    memcpy(to, &x, sizeof(float));
+  }
+  static void widen(const float *from, double *to) {
+    float x;
+    memcpy(&x, from, sizeof(float));
+    const double d = x;
+    memcpy(to, &d, sizeof(double));
+  }
+  static bool is_aligned_single(float *p) {
+    return fftwf_alignment_of(p) == 0;
+  }
+  // single_plan returns the in-place plan for one direction, making it
+  // on an array of our own, which we free again right away.
+  fftwf_plan single_plan(bool forward, bool aligned) {
+    fftwf_plan &p = forward ? single_r2c_plans[aligned] : single_c2r_plans[aligned];
+    if (!p) {
+      const unsigned flags = aligned ? FFTW_MEASURE : FFTW_MEASURE | FFTW_UNALIGNED;
+      use_fft_wisdom();
+      plan_with_fftf_threads(planned_threads);
+      fftwf_complex *k = (fftwf_complex *)fftwf_malloc(NxNyNzOver2*sizeof(fftwf_complex));
+      if (forward) p = fftwf_plan_dft_r2c_3d(Nx, Ny, Nz, (float *)k, k, flags);
+      else p = fftwf_plan_dft_c2r_3d(Nx, Ny, Nz, k, (float *)k, flags);
+      fftwf_free(k);
+    }
+    return p;
+  }
+#endif
+  // slab_r2c and slab_c2r transform our slab of a grid that is split
+  // among ranks, by way of an array of our own that is padded the way
+  // fftw's MPI transforms need, with rows of the real data rowlen
+  // doubles apart, as in r2c_in_place.
+  void slab_r2c(const double *in, long rowlen, fftw_complex *out) {
+    make_slab_plans();
+    const long rows = local_nx*Ny, padded = 2*(Nz/2+1);
+    double *b = (double *)slab_buffer;
+    for (long row=0; row<rows; row++) memcpy(b + row*padded, in + row*rowlen, Nz*sizeof(double));
+    fftw_execute(slab_r2c_plan);
+    memcpy(out, slab_buffer, rows*(Nz/2+1)*sizeof(fftw_complex));
+  }
+  void slab_c2r(const fftw_complex *in, double *out, long rowlen) {
+    make_slab_plans();
+    const long rows = local_nx*Ny, padded = 2*(Nz/2+1);
+    memcpy(slab_buffer, in, rows*(Nz/2+1)*sizeof(fftw_complex));
+    fftw_execute(slab_c2r_plan);
+    const double *b = (const double *)slab_buffer;
+    for (long row=0; row<rows; row++) memcpy(out + row*rowlen, b + row*padded, Nz*sizeof(double));
+  }
+  void make_slab_plans() {
+    if (slab_r2c_plan) return;
+    const Slab &s = slab(Nx, Ny, Nz);
+    if (!slab_buffer) slab_buffer = fftw_alloc_complex(s.alloc_complex > 0 ? s.alloc_complex : 1);
+    use_fft_wisdom();
+    plan_with_fft_threads(planned_threads);
+    slab_r2c_plan = plan_slab_r2c(s, slab_buffer, FFTW_MEASURE);
+    slab_c2r_plan = plan_slab_c2r(s, slab_buffer, FFTW_MEASURE);
+  }
+  static std::vector<FFTWorkspace *> &workspaces() {
+    static std::vector<FFTWorkspace *> all;
+    return all;
+  }
+  static FFTWorkspace *&most_recent() {
+    static FFTWorkspace *last = 0;
+    return last;
+  }
+
+  long Nx, Ny, Nz, NxNyNz, NxNyNzOver2;
+  bool by_slabs; // true if the grid is split among ranks
+  long local_nx; // the number of x planes in our slab
+  fftw_complex *scratch;
+  fftw_complex *many_scratch; // holds the inputs for c2r_many
+  int many_scratch_fields;
+  double *many_out; // holds the outputs of c2r_many, for many_output
+  int many_out_fields;
+  int planned_threads;
+  fftw_plan r2c_plans[2], c2r_plans[2]; // indexed by alignment
+  fftw_plan r2c_in_place_plans[2], c2r_in_place_plans[2];
+  std::vector<fftw_plan> c2r_many_plans[2]; // indexed by alignment, then K
+#ifdef DEFT_FFT_SINGLE
+  fftwf_plan single_r2c_plans[2], single_c2r_plans[2]; // indexed by alignment
+#endif
+  fftw_complex *slab_buffer; // for transforms of a slab
+  fftw_plan slab_r2c_plan, slab_c2r_plan;
+};
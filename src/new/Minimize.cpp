@@ -7,6 +7,38 @@ inline bool better(double a, double b) {
 }
 
 bool Minimize::improve_energy(Verbosity v) {
+  if (!in_single_precision) return take_step(v);
+  const bool keep_going = take_step(v);
+  if (!keep_going || last_gradnorm < single_precision_gradnorm) {
+    // Either we've converged as well as single precision allows, or
+    // we're close enough that we want the accuracy.  Either way, we
+    // aren't done yet.
+    switch_to_double_precision(v);
+    return iter < maxiter;
+  }
+  return true;
+}
+
+void Minimize::switch_to_double_precision(Verbosity v) {
+  if (v >= verbose) {
+    printf("Switching to double-precision FFTs with gradient norm %g\n", last_gradnorm);
+  }
+  in_single_precision = false;
+  // The cached energy and gradient aren't accurate enough to compare
+  // with what we'll compute from here on, so we start again with
+  // steepest descent, and forget how quickly we seemed to be
+  // converging, since that was limited by single precision.
+  invalidate_cache();
+  oldgrad.free();
+  direction.free();
+  oldgradsqr = 0;
+  deltaE = 0;
+  dEdn = 0;
+  log_dEdn_ratio_average = 0;
+  error_estimate = 0;
+}
+
+bool Minimize::take_step(Verbosity v) {
   iter++;
   if (iter >= maxiter) {
     if (v >= verbose) {
@@ -42,21 +74,27 @@ bool Minimize::improve_energy(Verbosity v) {
     // Note that we could save some memory by using Fletcher-Reeves, and
     // it seems worth implementing that as an option for
     // memory-constrained problems (then we wouldn't need to store oldgrad).
+    // On a grid split among ranks (see Distributed.h), f->dot adds up
+    // the contributions of all the slabs.
+    last_gradnorm = f->norm(g);
     if (v >= min_details) {
-      printf("\t\tnorm of gradient is %g\n", g.norm());
+      printf("\t\tnorm of gradient is %g\n", last_gradnorm);
       //printf("\t\toldgrad size is %d\n", oldgrad.get_size());
       //printf("\t\tnorm(g - oldgrad) is %g\n", (g-oldgrad).norm());
     }
-    double beta = pg.dot(g - oldgrad)/oldgradsqr;
+    // We take pg*(g - oldgrad) as two dot products, since f->dot needs
+    // Vectors, and g - oldgrad would be one more field.
+    const double pgg = f->dot(pg, g);
+    double beta = oldgrad.get_size() ? (pgg - f->dot(pg, oldgrad))/oldgradsqr : 0;
     oldgrad = g;
     if (beta < 0 || beta != beta || oldgradsqr == 0) beta = 0;
-    oldgradsqr = pg.dot(g);
+    oldgradsqr = pgg;
     direction = -pg + beta*direction;
-    gdotd = g.dot(direction);
+    gdotd = f->dot(g, direction);
     if (gdotd > 0) {
       direction = -g; // If our direction is uphill, reset to gradient.
       if (v >= verbose) printf("\t\treset to gradient, since g*d = %g < 0\n", gdotd);
-      gdotd = g.dot(direction);
+      gdotd = f->dot(g, direction);
     }
     // g and pg will be destructed here.
   }
@@ -193,7 +231,7 @@ bool Minimize::improve_energy(Verbosity v) {
     } else if (E1 == E0) {
       if (v >= verbose) {
         printf("\t\tNo change in energy... step1 is %g, direction has mag %g\n",
-               step1, direction.norm());
+               step1, f->norm(direction));
         fflush(stdout);
       }
       do {
@@ -253,9 +291,9 @@ bool Minimize::improve_energy(Verbosity v) {
              // compute everything at once, rather than first
              // computing just the grad...
     printf("\t\tfinal stepsize: = %g\n", step);
-    if (v >= min_details) printf("\t\tgrad*direction = %g\n", grad().dot(direction)/gdotd);
+    if (v >= min_details) printf("\t\tgrad*direction = %g\n", f->dot(grad(), direction)/gdotd);
     if (v >= min_details && use_preconditioning)
-      printf("\t\tpgrad*direction = %g\n", pgrad().dot(direction)/gdotd);
+      printf("\t\tpgrad*direction = %g\n", f->dot(pgrad(), direction)/gdotd);
     print_info("");
   }
 
@@ -3,6 +3,8 @@
 #pragma once
 
 #include "new/NewFunctional.h"
+#include "new/CubicSymmetry.h"
+#include "FFTPrecision.h"
 #include "handymath.h"
 #include <stdio.h>
 #include <math.h>
@@ -38,6 +40,12 @@ public:
     dEdn = 0;
     log_dEdn_ratio_average = 0;
     error_estimate = 0;
+
+    single_precision_gradnorm = 0;
+    in_single_precision = false;
+    last_gradnorm = 0;
+
+    symmetry = 0;
   }
   ~Minimize() {
     invalidate_cache();
@@ -47,6 +55,7 @@ public:
     iter = 0;
     num_energy_calcs = 0;
     num_grad_calcs = 0;
+    in_single_precision = single_precision_gradnorm > 0;
     invalidate_cache();
   }
 
@@ -67,6 +76,18 @@ public:
   int get_iteration_count() const {
     return iter;
   }
+  int get_energy_calc_count() const {
+    return num_energy_calcs;
+  }
+  int get_grad_calc_count() const {
+    return num_grad_calcs;
+  }
+  // set_stepsize sets the size of the first step, which is otherwise
+  // guessed from the energy and its slope.  That guess is poor when we
+  // start close to the minimum, as when continuing from a coarser grid.
+  void set_stepsize(double s) {
+    step = s;
+  }
   void set_known_true_energy(double e) {
     known_true_energy = e;
   }
@@ -79,6 +100,26 @@ public:
   void check_conjugacy(bool u) {
     do_check_conjugacy = u;
   }
+  // set_single_precision_until asks that the FFTs in our energy and
+  // gradient evaluations be done in single precision (see
+  // FFTPrecision.h), which is faster, until the norm of the gradient
+  // falls below gradnorm, or until we would otherwise have stopped.
+  // After that we switch to double precision for the rest of the
+  // minimization.
+  void set_single_precision_until(double gradnorm) {
+    single_precision_gradnorm = gradnorm;
+    in_single_precision = gradnorm > 0;
+    invalidate_cache(); // we may have an energy cached in the other precision
+  }
+  // set_symmetry asks that we symmetrize each gradient over the cubic
+  // point group, so that a minimization starting from a field with the
+  // symmetry of a crystal keeps that symmetry exactly, rather than
+  // accumulating roundoff that breaks it.  The symmetry is not copied,
+  // so it must outlive the minimization, and passing 0 turns this off.
+  void set_symmetry(const CubicSymmetry *s) {
+    symmetry = s;
+    invalidate_cache();
+  }
 
   // improve_energy returns false if the energy is fully converged
   // (i.e. it didn't improve), and there is no reason to call this
@@ -96,6 +137,7 @@ public:
     if (last_energy == 0) {
       const clock_t start = clock();
 
+      const FFTPrecisionScope fft_precision(in_single_precision);
       last_energy = new double(f->energy());
       if (v >= louder(min_details)) { // we need to get really paranoid before we print each energy...
         const clock_t end = clock();
@@ -117,7 +159,9 @@ public:
     if (!last_grad.get_size()) {
       /* We need to compute the gradient because we don't already have its value cached. */
       const clock_t start = clock();
+      const FFTPrecisionScope fft_precision(in_single_precision);
       last_grad = f->grad();
+      if (symmetry) last_grad = symmetry->symmetrize(last_grad);
       if (v >= louder(min_details)) { // we need to get really paranoid before we print each grad...
         const clock_t end = clock();
         if (end > start + 10) {
@@ -138,6 +182,7 @@ public:
       if (use_preconditioning && f->have_preconditioner()) {
         invalidate_cache();
         const clock_t start = clock();
+        const FFTPrecisionScope fft_precision(in_single_precision);
         EnergyGradAndPrecond foo = f->energy_grad_and_precond();
         if (v >= louder(min_details)) { // we need to get really paranoid before we print each energy...
           const clock_t end = clock();
@@ -156,6 +201,10 @@ public:
         last_energy = new double(foo.energy);
         last_grad = foo.grad;
         last_pgrad = foo.precond;
+        if (symmetry) {
+          last_grad = symmetry->symmetrize(last_grad);
+          last_pgrad = symmetry->symmetrize(last_pgrad);
+        }
       } else {
         grad(v);
         last_pgrad = last_grad;
@@ -177,6 +226,13 @@ public:
     return step;
   }
 private:
+  // take_step does the work of improve_energy, at our current FFT
+  // precision.
+  bool take_step(Verbosity v);
+  // switch_to_double_precision ends the single-precision part of the
+  // minimization.
+  void switch_to_double_precision(Verbosity v);
+
   NewFunctional *f;
   int iter, maxiter, miniter;
 
@@ -195,5 +251,8 @@ private:
 
   double precision, relative_precision, deltaE, dEdn, log_dEdn_ratio_average;
   double error_estimate;
+  double single_precision_gradnorm, last_gradnorm;
+  bool in_single_precision; // true if our evaluations use single-precision FFTs
   double known_true_energy; // used for checking how well the minimization is working
+  const CubicSymmetry *symmetry;
 };
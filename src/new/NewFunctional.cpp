@@ -14,9 +14,9 @@ int NewFunctional::run_finite_difference_test(const char *testname, const Vector
   Vector my_direction(my_grad.get_size());
   if (direction) my_direction = *direction;
   else my_direction = my_grad;
-  my_direction /= my_direction.norm();
+  my_direction /= norm(my_direction);
 
-  const double lderiv = my_direction.dot(my_grad);
+  const double lderiv = dot(my_direction, my_grad);
   if (lderiv == 0.0) {
     printf("FAIL: Gradient is zero...\n");
     retval++;
@@ -29,7 +29,7 @@ int NewFunctional::run_finite_difference_test(const char *testname, const Vector
   int min_p = (int) -floor(log10(epsilon_max) + 0.5);
   if (stepsize) {
     const int old_min_p = min_p;
-    min_p = -floor(log10(stepsize*my_grad.norm()) + 0.5);
+    min_p = -floor(log10(stepsize*norm(my_grad)) + 0.5);
     printf("user-specified delta of 1e%d instead of 1e%d from directional grad %g and energy %g\n",
            -min_p, -old_min_p, lderiv, Eold);
   } else {
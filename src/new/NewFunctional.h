@@ -30,6 +30,7 @@ public:
     data = Vector();
   }
   NewFunctional(const NewFunctional &o) : data(o.data) {}
+  virtual ~NewFunctional() {}
   void operator=(const NewFunctional &o) {
     data = o.data;
   }
@@ -39,6 +40,14 @@ public:
   void operator-=(const Vector &o) {
     data -= o;
   }
+  template<typename E>
+  void operator+=(const Expression<E, double> &o) {
+    data += o;
+  }
+  template<typename E>
+  void operator-=(const Expression<E, double> &o) {
+    data -= o;
+  }
   double operator*(const Vector &o) {
     return data.dot(o);
   }
@@ -68,6 +77,20 @@ public:
   virtual void printme(const char *) const = 0;
   virtual bool have_preconditioner() const { return false; }
 
+  // dot returns the dot product of two Vectors laid out like our data,
+  // such as a gradient and a search direction, which is what Minimize
+  // uses.  On a grid split among ranks (see Distributed.h) it adds up
+  // every rank's part, but must count the scalars that every rank holds
+  // only once, so a functional with scalars in its data (as the
+  // generated ones may have) overrides it.
+  virtual double dot(const Vector &a, const Vector &b) const {
+    return dot_over_ranks(a, b);
+  }
+  double norm(const Vector &a) const {
+    if (rank_count() == 1) return a.norm();
+    return sqrt(dot(a, a));
+  }
+
   // The following is a utility method to ensure two different
   // functionals have the same input.  Of course, it won't work if
   // they don't expect the same sort of input, so it's mostly only
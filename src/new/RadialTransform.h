@@ -0,0 +1,191 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <math.h>
+#include <fftw3.h>
+#include <vector>
+#include "Vector.h"
+#include "FFTThreads.h"
+#include "FFTWisdom.h"
+
+// The functions here transform spherically symmetric fields, which we
+// store on a one-dimensional radial grid, rather than on a full 3D
+// grid.  The 3D Fourier transform of a spherically symmetric function
+// is itself spherically symmetric, and is given by a spherical Bessel
+// transform, which we compute with fftw's fast sine and cosine
+// transforms.  So a radial transform costs O(Nr log Nr) rather than
+// O(N^3 log N), and we can afford a far finer dr.
+//
+// A radial field f holds f(r) at r_i = (i+1)*dr, for i = 0..Nr-1, and
+// is taken to vanish at R = (Nr+1)*dr, so a field that doesn't decay
+// (such as the density of a fluid surrounding a solute) should have
+// its bulk value subtracted before transforming.  Its transform holds
+// F(k) at k_j = (j+1)*pi/R, so it has the same size.  radial_r and
+// radial_k return these grid points.
+//
+// radial_fft and radial_ifft transform scalar fields, using
+//
+//    F(k) = 4 pi/k \int r f(r) sin(kr) dr
+//    f(r) = 1/(2 pi^2 r) \int k F(k) sin(kr) dk
+//
+// which are exact inverses of one another on our grids.
+// radial_vector_fft and radial_vector_ifft transform the radial
+// component of a vector field v(r) = v_r(r) rhat, whose 3D Fourier
+// transform is i khat V(k), using the first spherical Bessel function:
+//
+//    V(k) = -4 pi \int r^2 v_r(r) j1(kr) dr
+//    v_r(r) = -1/(2 pi^2) \int k^2 V(k) j1(kr) dk
+//
+// With this convention the gradient of a scalar field f has V(k) =
+// k F(k).  Unlike the scalar transforms, these are only inverses of
+// one another to the accuracy of the quadrature.
+//
+// RadialWhiteBearFluid.h uses these transforms to minimize the White
+// Bear hard-sphere fluid on a radial grid.
+
+class RadialWorkspace {
+public:
+  RadialWorkspace(long nr)
+    : Nr(nr), sine_in(fftw_alloc_real(nr)), sine_out(fftw_alloc_real(nr)),
+      cosine_in(fftw_alloc_real(nr+2)), cosine_out(fftw_alloc_real(nr+2)),
+      sine_plan(0), cosine_plan(0), planned_threads(0) {}
+  ~RadialWorkspace() {
+    forget_plans();
+    fftw_free(sine_in);
+    fftw_free(sine_out);
+    fftw_free(cosine_in);
+    fftw_free(cosine_out);
+  }
+
+  // sine returns out_j = sum_i in_i sin(k_j r_i), for our r and k
+  // grids, scaling each input by in_scale[i] and each output by
+  // out_scale[j].
+  Vector sine(const Vector &in, const Vector &in_scale, const Vector &out_scale) {
+    make_plans();
+    for (long i=0; i<Nr; i++) sine_in[i] = in[i]*in_scale[i];
+    fftw_execute(sine_plan);
+    Vector out(Nr);
+    // fftw's RODFT00 has an extra factor of two.
+    for (long j=0; j<Nr; j++) out[j] = 0.5*sine_out[j]*out_scale[j];
+    return out;
+  }
+  // cosine is like sine, but computes sum_i in_i cos(k_j r_i).  It
+  // uses a DCT-I of size Nr+2, which includes r = 0 and r = R, where
+  // the input is zero.
+  Vector cosine(const Vector &in, const Vector &in_scale, const Vector &out_scale) {
+    make_plans();
+    cosine_in[0] = 0;
+    for (long i=0; i<Nr; i++) cosine_in[i+1] = in[i]*in_scale[i];
+    cosine_in[Nr+1] = 0;
+    fftw_execute(cosine_plan);
+    Vector out(Nr);
+    for (long j=0; j<Nr; j++) out[j] = 0.5*cosine_out[j+1]*out_scale[j];
+    return out;
+  }
+
+  static RadialWorkspace &get(long Nr) {
+    std::vector<RadialWorkspace *> &all = workspaces();
+    for (unsigned i=0; i<all.size(); i++) {
+      if (all[i]->Nr == Nr) return *all[i];
+    }
+    all.push_back(new RadialWorkspace(Nr));
+    return *all.back();
+  }
+  static void release_all() {
+    std::vector<RadialWorkspace *> &all = workspaces();
+    for (unsigned i=0; i<all.size(); i++) delete all[i];
+    all.clear();
+  }
+private:
+  RadialWorkspace(const RadialWorkspace &); // not copyable, since we own our plans
+  void operator=(const RadialWorkspace &);
+
+  // We plan (with FFTW_MEASURE, which clobbers the arrays) on our own
+  // arrays, which are the only ones we ever transform.
+  void make_plans() {
+    if (planned_threads != fft_threads()) {
+      forget_plans();
+      planned_threads = fft_threads();
+    }
+    if (sine_plan) return;
+    use_fft_wisdom();
+    plan_with_fft_threads(planned_threads);
+    sine_plan = fftw_plan_r2r_1d(Nr, sine_in, sine_out, FFTW_RODFT00, FFTW_MEASURE);
+    cosine_plan = fftw_plan_r2r_1d(Nr+2, cosine_in, cosine_out, FFTW_REDFT00, FFTW_MEASURE);
+  }
+  void forget_plans() {
+    if (sine_plan) fftw_destroy_plan(sine_plan);
+    if (cosine_plan) fftw_destroy_plan(cosine_plan);
+    sine_plan = 0;
+    cosine_plan = 0;
+  }
+  static std::vector<RadialWorkspace *> &workspaces() {
+    static std::vector<RadialWorkspace *> all;
+    return all;
+  }
+
+  long Nr;
+  double *sine_in, *sine_out, *cosine_in, *cosine_out;
+  fftw_plan sine_plan, cosine_plan;
+  int planned_threads;
+};
+
+inline Vector radial_r(long Nr, double dr) {
+  Vector r(Nr);
+  for (long i=0; i<Nr; i++) r[i] = (i+1)*dr;
+  return r;
+}
+
+inline Vector radial_k(long Nr, double dr) {
+  const double dk = M_PI/((Nr+1)*dr);
+  Vector k(Nr);
+  for (long j=0; j<Nr; j++) k[j] = (j+1)*dk;
+  return k;
+}
+
+inline Vector radial_fft(double dr, const Vector &f) {
+  const long Nr = f.get_size();
+  const Vector r = radial_r(Nr, dr), k = radial_k(Nr, dr);
+  Vector scale(Nr);
+  for (long j=0; j<Nr; j++) scale[j] = 4*M_PI*dr/k[j];
+  return RadialWorkspace::get(Nr).sine(f, r, scale);
+}
+
+inline Vector radial_ifft(double dr, const Vector &fk) {
+  const long Nr = fk.get_size();
+  const double dk = M_PI/((Nr+1)*dr);
+  const Vector r = radial_r(Nr, dr), k = radial_k(Nr, dr);
+  Vector scale(Nr);
+  for (long i=0; i<Nr; i++) scale[i] = dk/(2*M_PI*M_PI*r[i]);
+  return RadialWorkspace::get(Nr).sine(fk, k, scale);
+}
+
+// The vector transforms use j1(x) = sin(x)/x^2 - cos(x)/x.
+
+inline Vector radial_vector_fft(double dr, const Vector &v) {
+  const long Nr = v.get_size();
+  const Vector r = radial_r(Nr, dr), k = radial_k(Nr, dr);
+  Vector ones(Nr), sine_scale(Nr), cosine_scale(Nr);
+  ones = 1;
+  for (long j=0; j<Nr; j++) {
+    sine_scale[j] = -4*M_PI*dr/(k[j]*k[j]);
+    cosine_scale[j] = 4*M_PI*dr/k[j];
+  }
+  RadialWorkspace &w = RadialWorkspace::get(Nr);
+  return w.sine(v, ones, sine_scale) + w.cosine(v, r, cosine_scale);
+}
+
+inline Vector radial_vector_ifft(double dr, const Vector &vk) {
+  const long Nr = vk.get_size();
+  const double dk = M_PI/((Nr+1)*dr);
+  const Vector r = radial_r(Nr, dr), k = radial_k(Nr, dr);
+  Vector ones(Nr), sine_scale(Nr), cosine_scale(Nr);
+  ones = 1;
+  for (long i=0; i<Nr; i++) {
+    sine_scale[i] = -dk/(2*M_PI*M_PI*r[i]*r[i]);
+    cosine_scale[i] = dk/(2*M_PI*M_PI*r[i]);
+  }
+  RadialWorkspace &w = RadialWorkspace::get(Nr);
+  return w.sine(vk, ones, sine_scale) + w.cosine(vk, k, cosine_scale);
+}
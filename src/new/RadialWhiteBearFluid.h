@@ -0,0 +1,168 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <stdio.h>
+#include "NewFunctional.h"
+#include "RadialTransform.h"
+#include "WhiteBearPhi.h"
+
+// A RadialWhiteBearFluid is the White Bear hard-sphere fluid of
+// WhiteBearFluidVeff (an ideal gas plus the White Bear excess free
+// energy, in an external potential Vext and at chemical potential mu),
+// for systems that are spherically symmetric about the origin, such as
+// the fluid around a spherical solute.  It uses the radial grid of
+// RadialTransform.h, with Nr points at r_i = (i+1)*dr, so each energy
+// costs O(Nr log Nr) rather than the O(N^3 log N) of a 3D grid, and Nr
+// can be as large as we like.  Like WhiteBearFluidVeff, its variable is
+// the effective potential Veff, with n = exp(-Veff/kT), and Minimize
+// works on it unchanged.
+//
+// The weighted densities are computed from n - n_b, where n_b is the
+// density at the edge of the cell, since the radial transforms need
+// fields that vanish at r = (Nr+1)*dr.  So that this holds, Veff is
+// held fixed within 2R (the hard-sphere diameter) of the edge of the
+// cell, where the fluid should either be bulk-like or (if Vext is
+// large there) absent.  The energy is that of the fluid within the
+// cell, with grid point i holding a volume 4 pi r_i^2 dr.
+//
+// This is written by hand rather than generated, since the generated
+// code assumes every grid point holds the same volume dV, and that
+// the grid is periodic.
+
+class RadialWhiteBearFluid : public NewFunctional {
+public:
+  RadialWhiteBearFluid(long Nr, double dr)
+    : myNr(Nr), mydr(dr), myR(0.5), mykT(1), mymu(0), myVext(Nr) {
+    data = Vector(Nr);
+    data = 0.0;
+    myVext = 0.0;
+  }
+
+  long Nr() const { return myNr; }
+  double dr() const { return mydr; }
+  double &R() { return myR; }
+  double R() const { return myR; }
+  double &kT() { return mykT; }
+  double kT() const { return mykT; }
+  double &mu() { return mymu; }
+  double mu() const { return mymu; }
+  Vector &Vext() { return myVext; }
+  const Vector &Vext() const { return myVext; }
+  Vector Veff() const { return data; }
+
+  Vector get_r() const { return radial_r(myNr, mydr); }
+  Vector get_n() const {
+    Vector n(myNr);
+    for (long i=0; i<myNr; i++) n[i] = exp(-data[i]/mykT);
+    return n;
+  }
+  // get_volume returns the volume held by each grid point.
+  Vector get_volume() const {
+    const Vector r = get_r();
+    Vector vol(myNr);
+    for (long i=0; i<myNr; i++) vol[i] = 4*M_PI*r[i]*r[i]*mydr;
+    return vol;
+  }
+  Vector get_n3() const {
+    Vector n3, n2, n2v;
+    weighted_densities(get_n(), &n3, &n2, &n2v);
+    return n3;
+  }
+
+  double energy() const {
+    return energy_and_grad(0);
+  }
+  Vector grad() const {
+    Vector g(myNr);
+    energy_and_grad(&g);
+    return g;
+  }
+  bool have_preconditioner() const { return true; }
+  // We precondition as the generated code does, by dividing the
+  // gradient by n, which is the derivative of n with respect to Veff
+  // (up to a factor of -kT).
+  EnergyGradAndPrecond energy_grad_and_precond() const {
+    EnergyGradAndPrecond egp;
+    egp.grad = Vector(myNr);
+    egp.energy = energy_and_grad(&egp.grad);
+    const Vector n = get_n();
+    egp.precond = Vector(myNr);
+    for (long i=0; i<myNr; i++) egp.precond[i] = egp.grad[i]/n[i];
+    return egp;
+  }
+  void printme(const char *prefix) const {
+    printf("%sRadialWhiteBearFluid with %ld points and dr = %g\n", prefix, myNr, mydr);
+    printf("%s    total energy = %.15g\n", prefix, energy());
+  }
+
+private:
+  // weighted_densities computes n3, n2 and the radial component of n2v
+  // from the density n.
+  void weighted_densities(const Vector &n, Vector *n3, Vector *n2, Vector *n2v) const {
+    const double nb = n[myNr-1];
+    Vector dn(myNr);
+    for (long i=0; i<myNr; i++) dn[i] = n[i] - nb;
+    const Vector nk = radial_fft(mydr, dn), k = radial_k(myNr, mydr);
+    Vector n3k(myNr), n2k(myNr), n2vk(myNr);
+    for (long j=0; j<myNr; j++) {
+      const double w3 = white_bear_w3(myR, mydr, k[j]);
+      n3k[j] = w3*nk[j];
+      n2k[j] = white_bear_w2(myR, mydr, k[j])*nk[j];
+      n2vk[j] = -k[j]*w3*nk[j]; // n2v = -grad n3
+    }
+    *n3 = radial_ifft(mydr, n3k);
+    *n2 = radial_ifft(mydr, n2k);
+    *n2v = radial_vector_ifft(mydr, n2vk);
+    for (long i=0; i<myNr; i++) {
+      (*n3)[i] += nb*(4*M_PI/3)*myR*myR*myR;
+      (*n2)[i] += nb*4*M_PI*myR*myR;
+    }
+  }
+  // energy_and_grad returns the energy, and also computes its gradient
+  // with respect to Veff if grad is nonzero.  The gradient is the exact
+  // derivative of the energy on our grid, since the transpose of each
+  // radial transform (weighted by the volumes of the grid points) is
+  // the matching inverse transform.
+  double energy_and_grad(Vector *grad) const {
+    const Vector n = get_n(), vol = get_volume();
+    Vector n3, n2, n2v;
+    weighted_densities(n, &n3, &n2, &n2v);
+    const double lognQ = 1.5*log(18.01528*1822.8885*mykT/(2*M_PI)); // as in IdealGas.hs
+    double e = 0;
+    Vector d_n3(myNr), d_n2(myNr), d_n2v(myNr);
+    for (long i=0; i<myNr; i++) {
+      const WhiteBearPhi p = white_bear_phi(myR, n2[i], n3[i], n2v[i]*n2v[i]);
+      e += vol[i]*(mykT*p.phi - n[i]*(data[i] + mykT*(1 + lognQ)) + (myVext[i] - mymu)*n[i]);
+      d_n3[i] = mykT*p.d_n3;
+      d_n2[i] = mykT*p.d_n2;
+      d_n2v[i] = 2*mykT*p.d_n2v_sqr*n2v[i];
+    }
+    if (!grad) return e;
+
+    const Vector k = radial_k(myNr, mydr);
+    const Vector d_n3k = radial_fft(mydr, d_n3), d_n2k = radial_fft(mydr, d_n2);
+    const Vector d_n2vk = radial_vector_fft(mydr, d_n2v);
+    Vector dk(myNr);
+    for (long j=0; j<myNr; j++) {
+      const double w3 = white_bear_w3(myR, mydr, k[j]);
+      dk[j] = w3*d_n3k[j] + white_bear_w2(myR, mydr, k[j])*d_n2k[j] - k[j]*w3*d_n2vk[j];
+    }
+    const Vector d_n = radial_ifft(mydr, dk);
+    const double r_fixed = (myNr + 1)*mydr - 2*myR;
+    const Vector r = get_r();
+    for (long i=0; i<myNr; i++) {
+      if (r[i] > r_fixed) {
+        (*grad)[i] = 0;
+      } else {
+        const double dE_dn = d_n[i] - data[i] - mykT*lognQ + myVext[i] - mymu;
+        (*grad)[i] = -vol[i]*n[i]/mykT*dE_dn;
+      }
+    }
+    return e;
+  }
+
+  long myNr;
+  double mydr, myR, mykT, mymu;
+  Vector myVext;
+};
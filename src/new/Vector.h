@@ -7,8 +7,16 @@
 #include <math.h>
 #include <fftw3.h>
 #include <stdio.h>
+#include <vector>
+#include <algorithm>
 
 #include "ComplexVector.h"
+#include "Expression.h"
+#include "FieldThreads.h"
+#include "FFTWorkspace.h"
+#include "Distributed.h"
+#include "interpolation.h"
+#include "FieldFile.h"
 
 // A Vector is a reference-counted array of doubles.  You need to be
 // careful, because a copy of a Vector (or the use of assignment,
@@ -27,36 +35,61 @@
 
 // Most arithmetic operators are defined on Vectors.  If you come
 // across one that isn't defined, we could probably add its
-// definition.
+// definition.  The operators are lazy (see Expression.h), so a chain
+// such as a + 2*b - c is computed in a single loop when it is
+// assigned, with no temporary Vectors.
 
 class Vector {
 public:
-  Vector() : size(0), offset(0), data(0), references_count(0) {}
-  explicit Vector(long sz) : size(sz), offset(0), data(new double[size]), references_count(new int) {
+  typedef double value_type;
+  Vector() : size(0), offset(0), capacity(0), data(0), references_count(0) {}
+  explicit Vector(long sz) : size(sz), offset(0), capacity(sz + (sz&1)),
+                             data((double *)vector_allocate(capacity*sizeof(double))),
+                             references_count(new int) {
     *references_count = 1;
   }
-  Vector(const Vector &a) : size(a.size), offset(a.offset),
+  Vector(const Vector &a) : size(a.size), offset(a.offset), capacity(a.capacity),
                             data(a.data), references_count(a.references_count) {
-    *references_count += 1;
+    if (references_count) *references_count += 1;
   }
-  Vector(double x, double y, double z) : size(3), offset(0), data(new double[3]), references_count(new int) {
+  Vector(double x, double y, double z) : size(3), offset(0), capacity(4),
+                                         data((double *)vector_allocate(4*sizeof(double))),
+                                         references_count(new int) {
     *references_count = 1;
     data[0] = x;
     data[1] = y;
     data[2] = z;
   }
+  // A Vector may be constructed from an expression such as a + 2*b,
+  // which is then computed into new memory.
+  template<typename E>
+  Vector(const Expression<E, double> &e)
+    : size(0), offset(0), capacity(0), data(0), references_count(0) {
+    *this = e;
+  }
+  // padded creates a Vector of Nx*Ny*Nz doubles, with enough extra
+  // room allocated that fft_in_place can transform it in place.  On a
+  // grid split among ranks, it is just our slab, since slabs are never
+  // transformed in place.
+  static Vector padded(long Nx, long Ny, long Nz) {
+    if (rank_count() > 1) return Vector(slab_size(Nx, Ny, Nz));
+    Vector out(2*Nx*Ny*(Nz/2+1));
+    out.size = Nx*Ny*Nz;
+    return out;
+  }
   ~Vector() { free(); }
   void free() {
     if (references_count && *references_count) {
       *references_count -= 1;
       if (*references_count == 0) {
-        delete[] data;
+        vector_free(data, capacity*sizeof(double));
         delete references_count;
       }
       references_count = 0;
       data = 0;
       size = 0;
       offset = 0;
+      capacity = 0;
     }
   }
   void operator=(const Vector &a) {
@@ -65,6 +98,7 @@ public:
     if (!references_count && a.size) {
       size = a.size;
       offset = a.offset;
+      capacity = a.capacity;
       data = a.data;
       references_count = a.references_count;
       *references_count += 1;
@@ -75,9 +109,31 @@ public:
       memcpy(data+offset, a.data+a.offset, size*sizeof(double)); // faster than manual loop?
     }
   }
+  template<typename E>
+  void operator=(const Expression<E, double> &x) {
+    const E &e = x.derived();
+    if (!references_count && e.get_size()) {
+      Vector out(e.get_size());
+      evaluate(out.data, e);
+      *this = out;
+    } else if (!references_count) {
+      size = 0;
+    } else {
+      assert(size == e.get_size());
+      if (e.overlaps(data + offset, data + offset + size)) {
+        Vector out(size);
+        evaluate(out.data, e);
+        *this = out;
+      } else {
+        evaluate(data + offset, e);
+      }
+    }
+  }
   void operator=(double x) {
+    double *p1 = data + offset;
+    DEFT_PRAGMA(omp parallel for simd num_threads(field_threads()) if(parallel_threads(size) > 1))
     for (long i=0; i<size; i++) {
-      data[i + offset] = x;
+      p1[i] = x;
     }
   }
 
@@ -96,6 +152,7 @@ public:
     assert(start + num <= size);
     Vector out;
     out.size = num;
+    out.capacity = capacity;
     out.data = data;
     out.offset = start;
     out.references_count = references_count;
@@ -103,71 +160,13 @@ public:
     return out;
   }
 
-  // Below are the arithmetic operators.  These should be made fast.
-  Vector operator+(const Vector &a) const {
-    // operator+ treats an empty vector as a zero vector;
-    if (a.size == 0) return *this;
-    if (size == 0) return a;
-    assert(size == a.size);
-    Vector out(size);
-    const double *p1 = data + offset, *p2 = a.data + a.offset;
-    for (long i=0; i<size; i++) {
-      out.data[i] = p1[i] + p2[i];
-    }
-    return out;
-  }
-  Vector operator+(double a) const {
-    if (size == 0) return *this;
-    Vector out(size);
-    const double *p1 = data + offset;
-    for (long i=0; i<size; i++) {
-      out.data[i] = p1[i] + a;
-    }
-    return out;
-  }
-  Vector operator-(const Vector &a) const {
-    // operator- treats an empty vector as a zero vector;
-    if (a.size == 0) return *this;
-    if (size == 0) return -a;
-    assert(size == a.size);
-    Vector out(size);
-    const double *p1 = data + offset, *p2 = a.data + a.offset;
-    for (long i=0; i<size; i++) {
-      out.data[i] = p1[i] - p2[i];
-    }
-    return out;
-  }
-  Vector operator-() const {
-    Vector out(size);
-    const double *p1 = data + offset;
-    for (long i=0; i<size; i++) {
-      out.data[i] = -p1[i];
-    }
-    return out;
-  }
-  Vector operator*(double a) const {
-    Vector out(size);
-    const double *p2 = data + offset;
-    for (long i=0; i<size; i++) {
-      out.data[i] = a*p2[i];
-    }
-    return out;
-  }
-  friend Vector operator*(double a, const Vector &b);
-
-  Vector operator/(double a) const {
-    Vector out(size);
-    const double *p2 = data + offset;
-    for (long i=0; i<size; i++) {
-      out.data[i] = p2[i]/a;
-    }
-    return out;
-  }
-
+  // Below are the arithmetic operators that modify a Vector.  The
+  // others are in Expression.h.
   void operator+=(const Vector &a) {
     assert(size == a.size);
     double *p1 = data + offset;
     const double *p2 = a.data + a.offset;
+    DEFT_PRAGMA(omp parallel for simd num_threads(field_threads()) if(parallel_threads(size) > 1))
     for (long i=0; i<size; i++) {
       p1[i] += p2[i];
     }
@@ -176,46 +175,52 @@ public:
     assert(size == a.size);
     double *p1 = data + offset;
     const double *p2 = a.data + a.offset;
+    DEFT_PRAGMA(omp parallel for simd num_threads(field_threads()) if(parallel_threads(size) > 1))
     for (long i=0; i<size; i++) {
       p1[i] -= p2[i];
     }
   }
+  template<typename E>
+  void operator+=(const Expression<E, double> &e) {
+    assert(size == e.derived().get_size());
+    *this = *this + e.derived();
+  }
+  template<typename E>
+  void operator-=(const Expression<E, double> &e) {
+    assert(size == e.derived().get_size());
+    *this = *this - e.derived();
+  }
   void operator*=(double a) {
     double *p1 = data + offset;
+    DEFT_PRAGMA(omp parallel for simd num_threads(field_threads()) if(parallel_threads(size) > 1))
     for (long i=0; i<size; i++) {
       p1[i] *= a;
     }
   }
   void operator/=(double a) {
     double *p1 = data + offset;
+    DEFT_PRAGMA(omp parallel for simd num_threads(field_threads()) if(parallel_threads(size) > 1))
     for (long i=0; i<size; i++) {
       p1[i] /= a;
     }
   }
+  // The reductions are deterministic (see FieldThreads.h).
   double sum() const {
-    const double *p1 = data + offset;
-    double out = 0;
-    for (long i=0; i<size; i++) {
-      out += p1[i];
-    }
-    return out;
+    return deterministic_sum<double>(size, data + offset);
   }
   double dot(const Vector &a) const {
     assert(a.size == size);
-    double out = 0;
     const double *p1 = data + offset, *p2 = a.data + a.offset;
-    for (long i=0; i<size; i++) {
-      out += p1[i]*p2[i];
-    }
-    return out;
+    const Products<const double *, const double *, double> products(p1, p2);
+    return deterministic_sum<double>(size, products);
+  }
+  template<typename E>
+  double dot(const Expression<E, double> &e) const {
+    return e.derived().dot(*this);
   }
   double norm() const {
-    double out = 0;
-    const double *p1 = data + offset;
-    for (long i=0; i<size; i++) {
-      out += p1[i]*p1[i];
-    }
-    return sqrt(out);
+    const Squares<const double *, double> squares(data + offset);
+    return sqrt(deterministic_sum<double>(size, squares));
   }
   long get_size() const {
     return size;
@@ -308,66 +313,251 @@ public:
   }
 private:
   long size, offset;
+  // capacity is the number of doubles allocated, which we always make
+  // even, so our memory can be handed to a ComplexVector.
+  long capacity;
   double *data;
   int *references_count; // counts how many objects refer to the data.
+  friend class Leaf<Vector>;
   friend Vector ifft(long Nx, long Ny, long Nz, double dV, ComplexVector f);
   friend ComplexVector fft(long Nx, long Ny, long Nz, double dV, Vector f);
+  friend ComplexVector fft_in_place(long Nx, long Ny, long Nz, double dV, Vector &f);
+  friend Vector ifft_in_place(long Nx, long Ny, long Nz, double dV, ComplexVector &f);
+  friend void ifft_many(long Nx, long Ny, long Nz, double dV, int K,
+                        const ComplexVector *const in[], Vector *const out[]);
+  friend Vector interpolate(long Nx, long Ny, long Nz, const Vector &f,
+                            const Vector &x, const Vector &y, const Vector &z);
+  friend Vector resample(long Nx, long Ny, long Nz, const Vector &f, long Mx, long My, long Mz);
+  friend bool save_field(const char *fname, long Nx, long Ny, long Nz,
+                         double ax, double ay, double az, const Vector &f);
+  friend Vector load_field(const char *fname, FieldFileInfo *info);
+  friend Vector local_slab(long Nx, long Ny, long Nz, const Vector &full);
+  friend Vector gather_field(long Nx, long Ny, long Nz, const Vector &local);
 };
 
-inline Vector operator*(double a, const Vector &b) {
-  const long sz = b.size;
-  Vector out(sz);
-  const double *p2 = b.data + b.offset;
-  for (long i=0; i<sz; i++) {
-    out.data[i] = a*p2[i];
-  }
+inline ComplexVector fft(long Nx, long Ny, long Nz, double dV, Vector f) {
+  assert(!(Nx&1) || Nx == 1); // We want an even number of grid points in each direction (or one, if planar).
+  assert(!(Ny&1) || Ny == 1); // We want an even number of grid points in each direction (or one, if planar).
+  assert(!(Nz&1)); // We want an even number of grid points in each direction.
+  ComplexVector out(slab_ksize(Nx, Ny, Nz));
+  FFTWorkspace::get(Nx, Ny, Nz).r2c(f.data+f.offset, (fftw_complex *)out.data);
+  out *= dV;
   return out;
 }
 
-inline ComplexVector fft(long Nx, long Ny, long Nz, double dV, Vector f) {
-  assert(!(Nx&1)); // We want an even number of grid points in each direction.
-  assert(!(Ny&1)); // We want an even number of grid points in each direction.
+inline Vector ifft(long Nx, long Ny, long Nz, double dV, ComplexVector f) {
+  assert(!(Nx&1) || Nx == 1); // We want an even number of grid points in each direction (or one, if planar).
+  assert(!(Ny&1) || Ny == 1); // We want an even number of grid points in each direction (or one, if planar).
+  assert(!(Nz&1)); // We want an even number of grid points in each direction.
+  Vector out(slab_size(Nx, Ny, Nz)); // create output vector
+  // The workspace copies f into its own scratch array, since FFTW
+  // always overwrites its input when performing a c2r transform.
+  FFTWorkspace::get(Nx, Ny, Nz).c2r((const fftw_complex *)(f.data+f.offset), out.data);
+  out *= 1.0/(Nx*Ny*Nz*dV);
+  return out;
+}
+
+// ifft_many computes out[j] = ifft(Nx,Ny,Nz,dV,*in[j]) for K fields
+// on the same grid, using batched transforms, which are faster than K
+// separate calls to ifft.  The fields are transformed at most
+// ifft_batch at a time into an array the workspace keeps for next
+// time, and each result is then copied (and normalized) into an array
+// of its own, so the memory we use beyond the outputs themselves stays
+// bounded, and each output can be freed as soon as it is no longer
+// needed.  An output that is empty (e.g. was default-constructed) is
+// given a new array, while an output that already has data has the
+// result copied into it.  If the same input appears more than once, we
+// only transform it once.
+inline void ifft_many(long Nx, long Ny, long Nz, double dV, int K,
+                      const ComplexVector *const in[], Vector *const out[]) {
+  assert(!(Nx&1) || Nx == 1); // We want an even number of grid points in each direction (or one, if planar).
+  assert(!(Ny&1) || Ny == 1); // We want an even number of grid points in each direction (or one, if planar).
+  assert(!(Nz&1)); // We want an even number of grid points in each direction.
+  const int ifft_batch = 4;
+  const long N = slab_size(Nx, Ny, Nz);
+  const double scale = 1.0/(Nx*Ny*Nz*dV); // like ifft, the whole grid even if split
+  std::vector<const fftw_complex *> distinct;
+  std::vector<int> which(K);
+  for (int j=0; j<K; j++) {
+    const fftw_complex *p = (const fftw_complex *)(in[j]->data + in[j]->offset);
+    which[j] = distinct.size();
+    for (unsigned d=0; d<distinct.size(); d++) {
+      if (distinct[d] == p) which[j] = d;
+    }
+    if (which[j] == int(distinct.size())) distinct.push_back(p);
+  }
+  FFTWorkspace &w = FFTWorkspace::get(Nx, Ny, Nz);
+  for (int first=0; first<int(distinct.size()); first += ifft_batch) {
+    const int num = std::min(ifft_batch, int(distinct.size()) - first);
+    double *results = w.many_output(num);
+    if (num == 1) w.c2r(distinct[first], results);
+    else w.c2r_many(num, &distinct[first], results);
+    for (int j=0; j<K; j++) {
+      if (which[j] < first || which[j] >= first + num) continue;
+      if (out[j]->get_size() == 0) *out[j] = Vector(N);
+      assert(out[j]->get_size() == N);
+      const double *r = results + (which[j] - first)*N;
+      double *o = out[j]->data + out[j]->offset;
+      for (long i=0; i<N; i++) o[i] = scale*r[i];
+    }
+  }
+}
+
+// fft_in_place is like fft, except that it uses the memory of f for
+// its result, so it needs no more memory than f already has.  This
+// requires that nothing else refers to the data of f, and that f have
+// room for the complex result, which is true when f was created by
+// Vector::padded or ifft_in_place.  Otherwise, or if the grid is split
+// among ranks, we fall back on an ordinary fft.  Either way, f is left
+// empty.
+inline ComplexVector fft_in_place(long Nx, long Ny, long Nz, double dV, Vector &f) {
+  assert(!(Nx&1) || Nx == 1); // We want an even number of grid points in each direction (or one, if planar).
+  assert(!(Ny&1) || Ny == 1); // We want an even number of grid points in each direction (or one, if planar).
   assert(!(Nz&1)); // We want an even number of grid points in each direction.
-  ComplexVector out(Nx*Ny*(long(Nz)/2 + 1));
-  fftw_plan p = fftw_plan_dft_r2c_3d(Nx, Ny, Nz, (double *)f.data+f.offset, (fftw_complex *)out.data, FFTW_WISDOM_ONLY);
-  if (!p) {
-    // It seems that fftw has not yet done enough measurement to make
-    // a plan without modifying its input, so we need to take a moment
-    // to time things to ensure a fast FFT.
-    double *r = (double *)fftw_malloc((Nx*Ny*Nz+1)*sizeof(double)); // scratch space
-    // First we make and destroy a plan with optimally aligned memory access...
-    fftw_destroy_plan(fftw_plan_dft_r2c_3d(Nx, Ny, Nz, r, (fftw_complex *)out.data, FFTW_MEASURE));
-    // Then we do the same with a poorly aligned array, so we're prepared for anything!
-    fftw_destroy_plan(fftw_plan_dft_r2c_3d(Nx, Ny, Nz, r+1, (fftw_complex *)out.data, FFTW_MEASURE));
-    fftw_free(r);
-    // Now we will create the plan we actually use.
-    p = fftw_plan_dft_r2c_3d(Nx, Ny, Nz, (double *)f.data+f.offset, (fftw_complex *)out.data, FFTW_WISDOM_ONLY);
-  }
-  fftw_execute(p);
-  fftw_destroy_plan(p);
+  const long NzOver2 = Nz/2 + 1;
+  if (rank_count() > 1 || !f.references_count || *f.references_count != 1 || f.offset != 0
+      || f.capacity < 2*Nx*Ny*NzOver2) {
+    ComplexVector out = fft(Nx, Ny, Nz, dV, f);
+    f.free();
+    return out;
+  }
+  assert(f.size == Nx*Ny*Nz);
+  // Spread out the rows into fftw's padded layout, starting at the
+  // end so we never overwrite a row we haven't moved yet.
+  double *p = f.data;
+  for (long row = Nx*Ny-1; row > 0; row--) {
+    memmove(p + row*2*NzOver2, p + row*Nz, Nz*sizeof(double));
+  }
+  FFTWorkspace::get(Nx, Ny, Nz).r2c_in_place(p);
+  ComplexVector out;
+  out.size = Nx*Ny*NzOver2;
+  out.offset = 0;
+  out.capacity = f.capacity/2;
+  out.data = (std::complex<double> *)p;
+  out.references_count = f.references_count;
+  f.size = f.offset = f.capacity = 0; // out now owns the data
+  f.data = 0;
+  f.references_count = 0;
   out *= dV;
   return out;
 }
 
-inline Vector ifft(long Nx, long Ny, long Nz, double dV, ComplexVector f) {
-  assert(!(Nx&1)); // We want an even number of grid points in each direction.
-  assert(!(Ny&1)); // We want an even number of grid points in each direction.
+// ifft_in_place is like ifft, but reuses the memory of f for its
+// result when nothing else refers to it, so the result can itself be
+// transformed in place.  Either way, f is left empty.
+inline Vector ifft_in_place(long Nx, long Ny, long Nz, double dV, ComplexVector &f) {
+  assert(!(Nx&1) || Nx == 1); // We want an even number of grid points in each direction (or one, if planar).
+  assert(!(Ny&1) || Ny == 1); // We want an even number of grid points in each direction (or one, if planar).
   assert(!(Nz&1)); // We want an even number of grid points in each direction.
-  // Allocate a scratch array, since FFTW always overwrites its input
-  // when performing a c2r transform.
-  fftw_complex *c = (fftw_complex *)fftw_malloc(Nx*Ny*(long(Nz)/2+2)*sizeof(fftw_complex));
-  memcpy(c, f.data+f.offset, 2*f.size*sizeof(double)); // faster than manual loop?
-  Vector out(Nx*Ny*Nz); // create output vector
-  fftw_plan p = fftw_plan_dft_c2r_3d(Nx, Ny, Nz, c, (double *)out.data, FFTW_WISDOM_ONLY);
-  if (!p) {
-    // We need measurements!
-    p = fftw_plan_dft_c2r_3d(Nx, Ny, Nz, c, (double *)out.data, FFTW_MEASURE);
-    // Now recopy data, which was trashed above
-    memcpy(c, f.data+f.offset, 2*f.size*sizeof(double)); // faster than manual loop?
-  }
-  fftw_execute(p);
-  fftw_destroy_plan(p);
-  fftw_free(c);
+  const long NzOver2 = Nz/2 + 1;
+  if (rank_count() > 1 || !f.references_count || *f.references_count != 1 || f.offset != 0) {
+    Vector out = ifft(Nx, Ny, Nz, dV, f);
+    f.free();
+    return out;
+  }
+  assert(f.size == Nx*Ny*NzOver2);
+  double *p = (double *)f.data;
+  FFTWorkspace::get(Nx, Ny, Nz).c2r_in_place((fftw_complex *)p);
+  // Now squeeze out the padding, starting at the beginning.
+  for (long row = 1; row < Nx*Ny; row++) {
+    memmove(p + row*Nz, p + row*2*NzOver2, Nz*sizeof(double));
+  }
+  Vector out;
+  out.size = Nx*Ny*Nz;
+  out.offset = 0;
+  out.capacity = 2*f.capacity;
+  out.data = p;
+  out.references_count = f.references_count;
+  f.size = f.offset = f.capacity = 0; // out now owns the data
+  f.data = 0;
+  f.references_count = 0;
   out *= 1.0/(Nx*Ny*Nz*dV);
   return out;
 }
+
+// interpolate returns the values of the Nx*Ny*Nz field f at the points
+// with relative coordinates (x[i], y[i], z[i]), in which the cell is a
+// unit cube, by trilinear interpolation.
+inline Vector interpolate(long Nx, long Ny, long Nz, const Vector &f,
+                          const Vector &x, const Vector &y, const Vector &z) {
+  assert(f.size == Nx*Ny*Nz);
+  assert(x.size == y.size && x.size == z.size);
+  Vector out(x.size);
+  const double *p = f.data + f.offset;
+  const double *px = x.data + x.offset, *py = y.data + y.offset, *pz = z.data + z.offset;
+  for (long i=0; i<x.size; i++) out.data[i] = trilinear(p, Nx, Ny, Nz, px[i], py[i], pz[i]);
+  return out;
+}
+
+// resample returns the Nx*Ny*Nz field f on an Mx*My*Mz grid over the
+// same cell, by Fourier interpolation (see spectral_resample), e.g. to
+// continue a minimization converged on a coarse grid on a finer one.
+// It needs the entire field, so it can't be used on slabs.
+inline Vector resample(long Nx, long Ny, long Nz, const Vector &f, long Mx, long My, long Mz) {
+  assert(rank_count() == 1);
+  // With a dV of 1/(Nx*Ny*Nz), the transform holds the Fourier
+  // coefficients, which don't depend on the resolution.
+  const ComplexVector fk = fft(Nx, Ny, Nz, 1.0/(Nx*Ny*Nz), f);
+  ComplexVector out(Mx*My*(Mz/2 + 1));
+  spectral_resample(Nx, Ny, Nz, fk.data + fk.offset, Mx, My, Mz, out.data + out.offset);
+  return ifft(Mx, My, Mz, 1.0/(Mx*My*Mz), out);
+}
+
+// save_field writes f, which is on an Nx*Ny*Nz grid in an ax*ay*az
+// cell, as a field file (see FieldFile.h).  f may hold several fields,
+// or even the entire data of a NewFunctional.
+inline bool save_field(const char *fname, long Nx, long Ny, long Nz,
+                       double ax, double ay, double az, const Vector &f) {
+  FieldFileInfo info;
+  info.Nx = Nx;
+  info.Ny = Ny;
+  info.Nz = Nz;
+  info.size = f.size;
+  const double a[3] = { ax, ay, az };
+  for (int i=0; i<3; i++) {
+    for (int j=0; j<3; j++) info.lattice[i][j] = (i == j) ? a[i] : 0;
+  }
+  return write_field_file(fname, info, f.data + f.offset);
+}
+
+// load_field reads a field file straight into a new Vector, and
+// describes its grid in *info (if info is not null).  It returns an
+// empty Vector if the file can't be read.  To use a large field
+// without reading it, see MappedFieldFile.
+inline Vector load_field(const char *fname, FieldFileInfo *info = 0) {
+  FieldFileInfo myinfo;
+  if (!info) info = &myinfo;
+  if (!read_field_file_info(fname, info)) return Vector();
+  Vector out(info->size);
+  if (!read_field_file(fname, info, out.data, out.size)) return Vector();
+  return out;
+}
+
+// dot_over_ranks and norm_over_ranks are dot and norm for Vectors that
+// hold our slab of a grid split among ranks (see Distributed.h).  With
+// a single rank they are the same as dot and norm.
+inline double dot_over_ranks(const Vector &a, const Vector &b) {
+  return sum_over_ranks(a.dot(b));
+}
+inline double norm_over_ranks(const Vector &a) {
+  if (rank_count() == 1) return a.norm();
+  return sqrt(sum_over_ranks(a.dot(a)));
+}
+
+// local_slab returns our slab of the Nx*Ny*Nz field full, e.g. to set
+// up an initial density that every rank has computed in full.
+// gather_field does the opposite, putting together the slabs of all
+// ranks into the entire field, which every rank gets.
+inline Vector local_slab(long Nx, long Ny, long Nz, const Vector &full) {
+  assert(full.size == Nx*Ny*Nz);
+  const Slab &s = slab(Nx, Ny, Nz);
+  Vector out(slab_size(Nx, Ny, Nz));
+  if (out.size) memcpy(out.data, full.data + full.offset + s.x_start*Ny*Nz, out.size*sizeof(double));
+  return out;
+}
+inline Vector gather_field(long Nx, long Ny, long Nz, const Vector &local) {
+  assert(local.size == slab_size(Nx, Ny, Nz));
+  Vector out(Nx*Ny*Nz);
+  gather_slabs(slab(Nx, Ny, Nz), local.data + local.offset, out.data);
+  return out;
+}
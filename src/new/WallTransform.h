@@ -0,0 +1,216 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <math.h>
+#include <fftw3.h>
+#include <vector>
+#include "Vector.h"
+#include "FFTThreads.h"
+#include "FFTWisdom.h"
+
+// The functions here transform fields in a cell bounded by hard walls
+// at z = 0 and z = Lz, rather than one that is periodic in z.  They
+// use cosine and sine transforms in z, and ordinary periodic ffts in x
+// and y.  A cosine transform treats the field as though it were
+// mirrored at each wall, so that a convolution with an even kernel
+// (such as a weight function) sees the mirror image of the fluid
+// rather than a periodic image of the other wall.  Since the density
+// of hard spheres vanishes within R of a hard wall, the mirror image
+// is at least 2R away from the fluid, and a weight function of radius
+// R never sees it from within the cell.  So we need only the physical
+// region between the walls, with no padding to keep the periodic
+// images from interacting.
+//
+// A field holds f(x,y,z) on the usual Nx*Ny*Nz grid, except that the
+// grid points in z are at (iz+1/2)*dz, so the walls lie halfway
+// between grid points.  Its transform holds F(kx,ky,kz) for kz =
+// q*pi/Lz, with q = 0..Nz-1, and for the usual kx and ky of an r2c
+// transform in the x-y plane, with q varying fastest, so it has size
+// Nx*(Ny/2+1)*Nz.  walls_k gives the wave vector at each point.
+//
+// fft_walls and ifft_walls transform fields that are even about each
+// wall, using a cosine transform.  Their product with an even kernel
+// convolves them with mirror-image boundary conditions.
+// fft_walls_odd and ifft_walls_odd transform fields that are odd
+// about each wall (such as the z component of a vector weighted
+// density), using a sine transform, whose term q is stored at index q
+// (so q = 0 holds nothing).  With these conventions the z derivative
+// of ifft_walls(F) is ifft_walls_odd(-kz F), and its x derivative is
+// ifft_walls(i kx F).  WallsWhiteBearFluid.h uses these transforms.
+
+class WallWorkspace {
+public:
+  WallWorkspace(long nx, long ny, long nz)
+    : Nx(nx), Ny(ny), Nz(nz), NyOver2(ny/2+1),
+      real_scratch(fftw_alloc_real(nx*ny*nz)), scratch(fftw_alloc_complex(nx*(ny/2+1)*nz)),
+      planned_threads(0) {
+    for (int odd=0; odd<2; odd++) {
+      forward_z_plans[odd] = 0;
+      backward_z_plans[odd] = 0;
+    }
+    r2c_plan = 0;
+    c2r_plan = 0;
+  }
+  ~WallWorkspace() {
+    forget_plans();
+    fftw_free(real_scratch);
+    fftw_free(scratch);
+  }
+
+  // forward does the unnormalized forward transform, with a cosine (or
+  // sine, if odd) transform in z followed by an r2c transform in x and
+  // y.  fftw's REDFT10 and RODFT10 have an extra factor of two, which
+  // leaves us with the transform of the field mirrored at both walls.
+  ComplexVector forward(const Vector &f, bool odd) {
+    make_plans();
+    const long N = Nx*Ny*Nz;
+    for (long i=0; i<N; i++) real_scratch[i] = f[i];
+    fftw_execute(forward_z_plans[odd]);
+    if (odd) {
+      // RODFT10 puts the term q+1 at q, so shift it over, dropping the
+      // last (Nyquist) term, which has no cosine partner.
+      for (long row=0; row<Nx*Ny; row++) {
+        double *p = real_scratch + row*Nz;
+        for (long q=Nz-1; q>0; q--) p[q] = p[q-1];
+        p[0] = 0;
+      }
+    }
+    fftw_execute(r2c_plan);
+    ComplexVector out(Nx*NyOver2*Nz);
+    for (long i=0; i<Nx*NyOver2*Nz; i++) {
+      out[i] = std::complex<double>(scratch[i][0], scratch[i][1]);
+    }
+    return out;
+  }
+  // backward does the unnormalized inverse of forward, which is 2*Nz
+  // times Nx*Ny times the actual inverse.
+  Vector backward(const ComplexVector &fk, bool odd) {
+    make_plans();
+    for (long i=0; i<Nx*NyOver2*Nz; i++) {
+      scratch[i][0] = fk[i].real();
+      scratch[i][1] = fk[i].imag();
+    }
+    fftw_execute(c2r_plan);
+    if (odd) {
+      for (long row=0; row<Nx*Ny; row++) {
+        double *p = real_scratch + row*Nz;
+        for (long q=0; q<Nz-1; q++) p[q] = p[q+1];
+        p[Nz-1] = 0;
+      }
+    }
+    fftw_execute(backward_z_plans[odd]);
+    const long N = Nx*Ny*Nz;
+    Vector out(N);
+    for (long i=0; i<N; i++) out[i] = real_scratch[i];
+    return out;
+  }
+
+  static WallWorkspace &get(long Nx, long Ny, long Nz) {
+    std::vector<WallWorkspace *> &all = workspaces();
+    for (unsigned i=0; i<all.size(); i++) {
+      if (all[i]->Nx == Nx && all[i]->Ny == Ny && all[i]->Nz == Nz) return *all[i];
+    }
+    all.push_back(new WallWorkspace(Nx, Ny, Nz));
+    return *all.back();
+  }
+  static void release_all() {
+    std::vector<WallWorkspace *> &all = workspaces();
+    for (unsigned i=0; i<all.size(); i++) delete all[i];
+    all.clear();
+  }
+private:
+  WallWorkspace(const WallWorkspace &); // not copyable, since we own our plans
+  void operator=(const WallWorkspace &);
+
+  // We plan (with FFTW_MEASURE, which clobbers the arrays) on our own
+  // scratch arrays, which are the only ones we ever transform.  The z
+  // transforms work in place on rows of real_scratch, while the x-y
+  // transforms go between real_scratch and scratch, with a stride of
+  // Nz so that z remains the fastest-varying index.
+  void make_plans() {
+    if (planned_threads != fft_threads()) {
+      forget_plans();
+      planned_threads = fft_threads();
+    }
+    if (r2c_plan) return;
+    use_fft_wisdom();
+    plan_with_fft_threads(planned_threads);
+    const int nz[1] = { int(Nz) }, nxy[2] = { int(Nx), int(Ny) };
+    const fftw_r2r_kind forward_kinds[2] = { FFTW_REDFT10, FFTW_RODFT10 };
+    const fftw_r2r_kind backward_kinds[2] = { FFTW_REDFT01, FFTW_RODFT01 };
+    for (int odd=0; odd<2; odd++) {
+      forward_z_plans[odd] = fftw_plan_many_r2r(1, nz, Nx*Ny, real_scratch, 0, 1, Nz,
+                                                real_scratch, 0, 1, Nz,
+                                                &forward_kinds[odd], FFTW_MEASURE);
+      backward_z_plans[odd] = fftw_plan_many_r2r(1, nz, Nx*Ny, real_scratch, 0, 1, Nz,
+                                                 real_scratch, 0, 1, Nz,
+                                                 &backward_kinds[odd], FFTW_MEASURE);
+    }
+    r2c_plan = fftw_plan_many_dft_r2c(2, nxy, Nz, real_scratch, 0, Nz, 1,
+                                      scratch, 0, Nz, 1, FFTW_MEASURE);
+    c2r_plan = fftw_plan_many_dft_c2r(2, nxy, Nz, scratch, 0, Nz, 1,
+                                      real_scratch, 0, Nz, 1, FFTW_MEASURE);
+  }
+  void forget_plans() {
+    for (int odd=0; odd<2; odd++) {
+      if (forward_z_plans[odd]) fftw_destroy_plan(forward_z_plans[odd]);
+      if (backward_z_plans[odd]) fftw_destroy_plan(backward_z_plans[odd]);
+      forward_z_plans[odd] = 0;
+      backward_z_plans[odd] = 0;
+    }
+    if (r2c_plan) fftw_destroy_plan(r2c_plan);
+    if (c2r_plan) fftw_destroy_plan(c2r_plan);
+    r2c_plan = 0;
+    c2r_plan = 0;
+  }
+  static std::vector<WallWorkspace *> &workspaces() {
+    static std::vector<WallWorkspace *> all;
+    return all;
+  }
+
+  long Nx, Ny, Nz, NyOver2;
+  double *real_scratch;
+  fftw_complex *scratch;
+  fftw_plan forward_z_plans[2], backward_z_plans[2]; // indexed by oddness
+  fftw_plan r2c_plan, c2r_plan;
+  int planned_threads;
+};
+
+// walls_k sets k to the wave vector at index i of a transform from
+// fft_walls, for a cell of size Lx*Ly*Lz.
+inline void walls_k(long Nx, long Ny, long Nz, double Lx, double Ly, double Lz,
+                    long i, double k[3]) {
+  const long q = i % Nz;
+  const long n = i/Nz;
+  long y = n % (Ny/2+1);
+  long x = n/(Ny/2+1);
+  if (x > Nx/2) x -= Nx;
+  k[0] = 2*M_PI*x/Lx;
+  k[1] = 2*M_PI*y/Ly;
+  k[2] = M_PI*q/Lz;
+}
+
+inline ComplexVector fft_walls(long Nx, long Ny, long Nz, double dV, const Vector &f) {
+  ComplexVector out = WallWorkspace::get(Nx, Ny, Nz).forward(f, false);
+  out *= dV;
+  return out;
+}
+
+inline Vector ifft_walls(long Nx, long Ny, long Nz, double dV, const ComplexVector &fk) {
+  Vector out = WallWorkspace::get(Nx, Ny, Nz).backward(fk, false);
+  out *= 1.0/(2*Nx*Ny*Nz*dV);
+  return out;
+}
+
+inline ComplexVector fft_walls_odd(long Nx, long Ny, long Nz, double dV, const Vector &f) {
+  ComplexVector out = WallWorkspace::get(Nx, Ny, Nz).forward(f, true);
+  out *= dV;
+  return out;
+}
+
+inline Vector ifft_walls_odd(long Nx, long Ny, long Nz, double dV, const ComplexVector &fk) {
+  Vector out = WallWorkspace::get(Nx, Ny, Nz).backward(fk, true);
+  out *= 1.0/(2*Nx*Ny*Nz*dV);
+  return out;
+}
@@ -0,0 +1,147 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <stdio.h>
+#include "NewFunctional.h"
+#include "WallTransform.h"
+#include "WhiteBearPhi.h"
+
+// A WallsWhiteBearFluid is the White Bear hard-sphere fluid of
+// WhiteBearFluidVeffPlanar, between the walls of WallTransform.h at z =
+// 0 and z = Lz, rather than in a cell that is periodic in z.  Like the
+// planar generated functional it varies only in z (so Nx = Ny = 1),
+// and its energy is that of a cell of cross section Lx*Ly.
+//
+// The cosine transforms make each wall a mirror plane, so a hard wall
+// belongs at z = 0 (with Vext infinite for z < R, where no sphere can
+// be), and z = Lz is then the midplane of a slit of width 2*Lz.  As
+// explained in WallTransform.h, this needs none of the padding that a
+// periodic cell needs to keep a wall from seeing the fluid on its
+// other side.  n3 and n2 are even about the walls, while n2v (which
+// points along z) is odd, and uses the sine transforms.
+//
+// This is written by hand rather than generated, since the generator
+// doesn't know which of its fields are odd about the walls.
+
+class WallsWhiteBearFluid : public NewFunctional {
+public:
+  WallsWhiteBearFluid(double Lx, double Ly, double Lz, double dz)
+    : myNz(long(Lz/dz + 0.5)), myLz(Lz), mydV(Lx*Ly*Lz/myNz),
+      myR(0.5), mykT(1), mymu(0), myVext(myNz) {
+    data = Vector(myNz);
+    data = 0.0;
+    myVext = 0.0;
+  }
+
+  long Nz() const { return myNz; }
+  double dz() const { return myLz/myNz; }
+  double &R() { return myR; }
+  double R() const { return myR; }
+  double &kT() { return mykT; }
+  double kT() const { return mykT; }
+  double &mu() { return mymu; }
+  double mu() const { return mymu; }
+  Vector &Vext() { return myVext; }
+  const Vector &Vext() const { return myVext; }
+  Vector Veff() const { return data; }
+
+  // get_z returns the position of each grid point, which lie halfway
+  // between those at which the walls could be.
+  Vector get_z() const {
+    Vector z(myNz);
+    for (long i=0; i<myNz; i++) z[i] = (i + 0.5)*dz();
+    return z;
+  }
+  Vector get_n() const {
+    Vector n(myNz);
+    for (long i=0; i<myNz; i++) n[i] = exp(-data[i]/mykT);
+    return n;
+  }
+  Vector get_n3() const {
+    Vector n3, n2, n2v;
+    weighted_densities(get_n(), &n3, &n2, &n2v);
+    return n3;
+  }
+
+  double energy() const {
+    return energy_and_grad(0);
+  }
+  Vector grad() const {
+    Vector g(myNz);
+    energy_and_grad(&g);
+    return g;
+  }
+  bool have_preconditioner() const { return true; }
+  EnergyGradAndPrecond energy_grad_and_precond() const {
+    EnergyGradAndPrecond egp;
+    egp.grad = Vector(myNz);
+    egp.energy = energy_and_grad(&egp.grad);
+    const Vector n = get_n();
+    egp.precond = Vector(myNz);
+    for (long i=0; i<myNz; i++) egp.precond[i] = egp.grad[i]/n[i];
+    return egp;
+  }
+  void printme(const char *prefix) const {
+    printf("%sWallsWhiteBearFluid with %ld points and dz = %g\n", prefix, myNz, dz());
+    printf("%s    total energy = %.15g\n", prefix, energy());
+  }
+
+private:
+  double kz(long q) const { return M_PI*q/myLz; }
+  // weighted_densities computes n3, n2 and the z component of n2v from
+  // the density n.
+  void weighted_densities(const Vector &n, Vector *n3, Vector *n2, Vector *n2v) const {
+    const ComplexVector nk = fft_walls(1, 1, myNz, mydV, n);
+    ComplexVector n3k(myNz), n2k(myNz), n2vk(myNz);
+    for (long q=0; q<myNz; q++) {
+      const double w3 = white_bear_w3(myR, dz(), kz(q));
+      n3k[q] = w3*nk[q];
+      n2k[q] = white_bear_w2(myR, dz(), kz(q))*nk[q];
+      n2vk[q] = kz(q)*w3*nk[q]; // n2v = -d n3/dz
+    }
+    *n3 = ifft_walls(1, 1, myNz, mydV, n3k);
+    *n2 = ifft_walls(1, 1, myNz, mydV, n2k);
+    *n2v = ifft_walls_odd(1, 1, myNz, mydV, n2vk);
+  }
+  // energy_and_grad returns the energy, and also computes its gradient
+  // with respect to Veff if grad is nonzero.  The gradient is the exact
+  // derivative of the energy on our grid: the convolution with an even
+  // weight is symmetric, and the transpose of the odd one (from even
+  // fields to odd) is the same product in k going from odd to even.
+  double energy_and_grad(Vector *grad) const {
+    const Vector n = get_n();
+    Vector n3, n2, n2v;
+    weighted_densities(n, &n3, &n2, &n2v);
+    const double lognQ = 1.5*log(18.01528*1822.8885*mykT/(2*M_PI)); // as in IdealGas.hs
+    double e = 0;
+    Vector d_n3(myNz), d_n2(myNz), d_n2v(myNz);
+    for (long i=0; i<myNz; i++) {
+      const WhiteBearPhi p = white_bear_phi(myR, n2[i], n3[i], n2v[i]*n2v[i]);
+      e += mydV*(mykT*p.phi - n[i]*(data[i] + mykT*(1 + lognQ)) + (myVext[i] - mymu)*n[i]);
+      d_n3[i] = mykT*p.d_n3;
+      d_n2[i] = mykT*p.d_n2;
+      d_n2v[i] = 2*mykT*p.d_n2v_sqr*n2v[i];
+    }
+    if (!grad) return e;
+
+    const ComplexVector d_n3k = fft_walls(1, 1, myNz, mydV, d_n3),
+      d_n2k = fft_walls(1, 1, myNz, mydV, d_n2),
+      d_n2vk = fft_walls_odd(1, 1, myNz, mydV, d_n2v);
+    ComplexVector dk(myNz);
+    for (long q=0; q<myNz; q++) {
+      const double w3 = white_bear_w3(myR, dz(), kz(q));
+      dk[q] = w3*d_n3k[q] + white_bear_w2(myR, dz(), kz(q))*d_n2k[q] + kz(q)*w3*d_n2vk[q];
+    }
+    const Vector d_n = ifft_walls(1, 1, myNz, mydV, dk);
+    for (long i=0; i<myNz; i++) {
+      const double dE_dn = d_n[i] - data[i] - mykT*lognQ + myVext[i] - mymu;
+      (*grad)[i] = -mydV*n[i]/mykT*dE_dn;
+    }
+    return e;
+  }
+
+  long myNz;
+  double myLz, mydV, myR, mykT, mymu;
+  Vector myVext;
+};
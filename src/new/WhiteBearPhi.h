@@ -0,0 +1,84 @@
+// -*- mode: C++; -*-
+
+#pragma once
+
+#include <math.h>
+
+// The functions here evaluate the White Bear version of fundamental
+// measure theory for hard spheres of radius R, one grid point at a
+// time, for the hand-written functionals that work on grids the
+// generated code can't handle (see RadialWhiteBearFluid.h,
+// CylindricalWhiteBearFluid.h and WallsWhiteBearFluid.h).  Since n0 =
+// n2/(4 pi R^2), n1 = n2/(4 pi R) and n1v = n2v/(4 pi R), the free
+// energy density depends only on n2, n3 and the square of n2v:
+//
+//    Phi = -n0 log(1-n3) + (n1 n2 - n1v.n2v)/(1-n3)
+//          + (n3 + (1-n3)^2 log(1-n3))/(36 pi n3^2 (1-n3)^2) (n2^3 - 3 n2 n2v.n2v)
+//
+// which is the same expression as in src/haskell/WhiteBear.hs.  Phi is
+// in units of kT, and vanishes where the weighted densities do.
+
+struct WhiteBearPhi {
+  double phi; // the free energy density over kT
+  double d_n2, d_n3, d_n2v_sqr; // its derivatives
+};
+
+// white_bear_f3 computes f(n3) = (n3 + (1-n3)^2 log(1-n3))/(n3^2 (1-n3)^2)
+// and its derivative.  For small n3 both the numerator and n3^2 vanish,
+// so we use the series n3 + (1-n3)^2 log(1-n3) = 3/2 n3^2 - sum_{m>2}
+// 2 n3^m/(m (m-1) (m-2)) there.
+inline void white_bear_f3(double n3, double *f, double *df) {
+  const double one_n3 = 1 - n3;
+  double h, dh; // the numerator over n3^2, and its derivative
+  if (fabs(n3) < 0.05) {
+    h = 1.5;
+    dh = 0;
+    double n3m = 1; // n3^(m-3)
+    for (int m=3; m<20; m++) {
+      dh -= 2*n3m/(m*(m-1));
+      n3m *= n3;
+      h -= 2*n3m/(m*(m-1)*(m-2));
+    }
+  } else {
+    const double numerator = n3 + one_n3*one_n3*log(one_n3);
+    const double dnumerator = n3 - 2*one_n3*log(one_n3);
+    h = numerator/(n3*n3);
+    dh = dnumerator/(n3*n3) - 2*numerator/(n3*n3*n3);
+  }
+  *f = h/(one_n3*one_n3);
+  *df = dh/(one_n3*one_n3) + 2*h/(one_n3*one_n3*one_n3);
+}
+
+inline WhiteBearPhi white_bear_phi(double R, double n2, double n3, double n2v_sqr) {
+  const double one_n3 = 1 - n3, log_one_n3 = log(one_n3);
+  const double four_pi_R = 4*M_PI*R;
+  double f, df;
+  white_bear_f3(n3, &f, &df);
+  f /= 36*M_PI;
+  df /= 36*M_PI;
+  const double third = n2*n2*n2 - 3*n2*n2v_sqr;
+  WhiteBearPhi out;
+  out.phi = -n2*log_one_n3/(four_pi_R*R) + (n2*n2 - n2v_sqr)/(four_pi_R*one_n3) + f*third;
+  out.d_n2 = -log_one_n3/(four_pi_R*R) + 2*n2/(four_pi_R*one_n3)
+    + f*(3*n2*n2 - 3*n2v_sqr);
+  out.d_n3 = n2/(four_pi_R*R*one_n3) + (n2*n2 - n2v_sqr)/(four_pi_R*one_n3*one_n3)
+    + df*third;
+  out.d_n2v_sqr = -1/(four_pi_R*one_n3) - 3*n2*f;
+  return out;
+}
+
+// The weight functions for n3 and n2 in reciprocal space, as in
+// src/haskell/FMT.hs, including its smearing by exp(-6 (k dr)^2),
+// which damps the ringing from the sharp edges of the weights.  The
+// vector weight for n2v is -i k w3(k), since n2v = -grad n3.
+inline double white_bear_w3(double R, double dr, double k) {
+  const double kR = k*R, smear = exp(-6*k*k*dr*dr);
+  if (kR < 1e-3) return smear*(4*M_PI/3)*R*R*R*(1 - kR*kR/10);
+  return smear*4*M_PI*(sin(kR) - kR*cos(kR))/(k*k*k);
+}
+
+inline double white_bear_w2(double R, double dr, double k) {
+  const double kR = k*R, smear = exp(-6*k*k*dr*dr);
+  if (kR < 1e-3) return smear*4*M_PI*R*R*(1 - kR*kR/6);
+  return smear*4*M_PI*R*sin(kR)/k;
+}
@@ -38,3 +38,11 @@ long current_memory() {
 void reset_peak_memory() {
   Eigen::djr_mempeak = Eigen::djr_memused;
 }
+
+namespace {
+  void track_memory(long bytes) {
+    Eigen::djr_memused += bytes;
+    if (Eigen::djr_memused > Eigen::djr_mempeak) Eigen::djr_mempeak = Eigen::djr_memused;
+  }
+  const bool tracking = (memory_tracker() = track_memory, true);
+}
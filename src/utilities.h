@@ -5,3 +5,14 @@
 long peak_memory();
 long current_memory();
 void reset_peak_memory();
+
+// The memory of the new Vector class isn't allocated by Eigen, so
+// new/Allocator.h reports it (as a change in bytes) to the
+// memory_tracker, if there is one.  utilities.cpp installs a tracker
+// that includes it in peak_memory and current_memory, so that the
+// header-only new code doesn't need utilities.o to link.
+typedef void (*MemoryTracker)(long bytes);
+inline MemoryTracker &memory_tracker() {
+  static MemoryTracker tracker = 0;
+  return tracker;
+}
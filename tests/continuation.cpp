@@ -0,0 +1,140 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+
+#include <stdio.h>
+#include "new/Continuation.h"
+
+// Screened is a quadratic functional of a density n in a source s,
+// E = 1/2 n*H*n - s*n, with H(k) = m^2 + k^2/(1 + k^2 l^2).  Like the
+// hessian of a real functional, H is bounded at large k and small at
+// small k, so it is the long-wavelength error that is slowest to
+// minimize away, which is the case continuation is meant for.  Its
+// data holds the grid size, then the cell size L, then n and s.
+class Screened : public NewFunctional {
+public:
+  Screened(long myNx, long myNy, long myNz) {
+    data = Vector(4 + 2*myNx*myNy*myNz);
+    data = 0.0;
+    data[0] = myNx;
+    data[1] = myNy;
+    data[2] = myNz;
+  }
+  long Nx() const { return long(data[0]); }
+  long Ny() const { return long(data[1]); }
+  long Nz() const { return long(data[2]); }
+  double &L() const { return data[3]; }
+  Vector n() const { return data.slice(4, Nx()*Ny()*Nz()); }
+  Vector s() const { return data.slice(4 + Nx()*Ny()*Nz(), Nx()*Ny()*Nz()); }
+
+  double energy() const {
+    const Vector nn = n(), Hn = apply_H(), ss = s();
+    return dV()*(0.5*nn.dot(Hn) - ss.dot(nn));
+  }
+  Vector grad() const {
+    const long N = Nx()*Ny()*Nz();
+    const Vector Hn = apply_H(), ss = s();
+    Vector g(data.get_size());
+    g = 0.0;
+    for (long i=0; i<N; i++) g[4 + i] = dV()*(Hn[i] - ss[i]);
+    return g;
+  }
+  void printme(const char *prefix) const {
+    printf("%sScreened on a %ld^3 grid\n", prefix, Nx());
+  }
+private:
+  double dV() const { return L()*L()*L()/(Nx()*Ny()*Nz()); }
+  Vector apply_H() const {
+    const long NzOver2 = Nz()/2 + 1;
+    ComplexVector nk = fft(Nx(), Ny(), Nz(), dV(), n());
+    for (long i=0; i<nk.get_size(); i++) {
+      long x = i/(Ny()*NzOver2), y = (i/NzOver2) % Ny(), z = i % NzOver2;
+      if (x > Nx()/2) x -= Nx();
+      if (y > Ny()/2) y -= Ny();
+      const double ksqr = (x*x + y*y + z*z)*(2*M_PI/L())*(2*M_PI/L());
+      nk[i] *= 0.01 + ksqr/(1 + 0.25*ksqr);
+    }
+    return ifft(Nx(), Ny(), Nz(), dV(), nk);
+  }
+};
+Screened *create(long Nx, long Ny, long Nz) {
+  Screened *f = new Screened(Nx, Ny, Nz);
+  f->L() = 20;
+  const double h = f->L()/Nx;
+  Vector s = f->s();
+  for (long i=0; i<Nx*Ny*Nz; i++) {
+    const double x = h*(i/(Ny*Nz)) - 10, y = h*((i/Nz) % Ny) - 10, z = h*(i % Nz) - 10;
+    s[i] = exp(-((x+1)*(x+1) + y*y + z*z)/8) - 0.5*exp(-((x-1)*(x-1) + y*y + z*z)/8);
+  }
+  return f;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+  const long N = 32;
+  const double precision = 1e-6;
+
+  // First, the plain minimization on the fine grid.
+  Screened *direct = create(N, N, N);
+  int direct_energy_calcs;
+  {
+    Minimize min(direct);
+    min.set_relative_precision(0);
+    min.set_precision(precision);
+    min.conjugate_gradient(true);
+    while (min.improve_energy(quiet)) {}
+    direct_energy_calcs = min.get_energy_calc_count();
+    printf("The direct minimization took %d energy and %d gradient evaluations\n",
+           min.get_energy_calc_count(), min.get_grad_calc_count());
+  }
+
+  Continuation<Screened> c(create);
+  c.add_field(&Screened::n);
+  c.add_level(8, 8, 8, 1e-3);
+  c.add_level(16, 16, 16, 1e-4);
+  c.add_level(N, N, N, precision);
+  c.conjugate_gradient(true);
+  Screened *f = c.minimize(quiet);
+  for (int l=0; l<3; l++) {
+    printf("Level %d took %d energy and %d gradient evaluations\n",
+           l, c.get_energy_calc_count(l), c.get_grad_calc_count(l));
+  }
+  if (c.get_energy_calc_count(2) >= direct_energy_calcs) {
+    printf("FAIL: continuation took %d energy evaluations on the fine grid, rather than fewer than %d\n",
+           c.get_energy_calc_count(2), direct_energy_calcs);
+    errorcode++;
+  }
+
+  const double energy = f->energy(), direct_energy = direct->energy();
+  printf("Energies are %.15g (direct) and %.15g (continuation)\n", direct_energy, energy);
+  if (fabs(energy - direct_energy) > 10*precision) {
+    printf("FAIL: the energies differ by %g\n", energy - direct_energy);
+    errorcode++;
+  }
+  double maxdiff = 0;
+  for (long i=0; i<N*N*N; i++) {
+    maxdiff = std::max(maxdiff, fabs(f->n()[i] - direct->n()[i]));
+  }
+  printf("The solutions differ by at most %g\n", maxdiff);
+  if (maxdiff > 1e-3) {
+    printf("FAIL: the solutions differ too much\n");
+    errorcode++;
+  }
+  delete f;
+  delete direct;
+  return errorcode;
+}
@@ -0,0 +1,126 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+#include <stdio.h>
+#include "Functionals.h"
+#include "OptimizedFunctionals.h"
+#include "ContactDensity.h"
+#include "equation-of-state.h"
+
+int check_memo(const char *name, Functional f, double kT, const Grid &density) {
+  const GridDescription gd(density.description());
+  printf("\nWorking on %s\n", name);
+  int errorcode = 0;
+
+  // First without the memo, then with it.
+  set_convolution_memo_limit(0);
+  Grid g0(gd);
+  g0.setZero();
+  const double e0 = f.integral_and_grad(kT, density, &g0);
+  set_convolution_memo_limit(32);
+  reset_convolution_memo_stats();
+  Grid g1(gd);
+  g1.setZero();
+  const double e1 = f.integral_and_grad(kT, density, &g1);
+  print_convolution_memo_stats("  ");
+
+  if (e1 != e0) {
+    printf("FAIL: the energy changes by %g with the memo\n", e1 - e0);
+    errorcode++;
+  }
+  if (g1 != g0) {
+    printf("FAIL: the gradient changes by %g with the memo\n",
+           (g1 - g0).cwise().abs().maxCoeff());
+    errorcode++;
+  }
+  return errorcode;
+}
+
+int main(int, char **argv) {
+  int errorcode = 0;
+  const double kT = new_water_prop.kT;
+  const double R = new_water_prop.lengthscale;
+
+  Lattice lat(Cartesian(0,5,5), Cartesian(5,0,5), Cartesian(5,5,0));
+  GridDescription gd(lat, 16, 16, 16);
+  Grid density(gd);
+  density = 1e-3*(-0.5*r2(gd)).cwise().exp()
+    + 0.8*new_water_prop.liquid_density*VectorXd::Ones(gd.NxNyNz);
+
+  // The memo is on by default.
+  HardSpheresWB(R).integral(kT, density);
+  if (convolution_memo_stats().saved == 0) {
+    printf("FAIL: the memo is off by default\n");
+    errorcode++;
+  }
+
+  // The hard-sphere and contact-value parts of SaftFluidSlow are
+  // written in terms of many separate weighted densities, so they
+  // should share most of their convolutions.
+  const Functional hs = HardSpheresWB(R);
+  errorcode += check_memo("HardSpheresWB", hs, kT, density);
+  if (convolution_memo_stats().saved == 0) {
+    printf("FAIL: HardSpheresWB saved no convolutions\n");
+    errorcode++;
+  }
+  errorcode += check_memo("HardSpheresWB + n*log(YuWuCorrelation)",
+                          hs + IdealGas() + Identity()*log(YuWuCorrelation(R)), kT, density);
+  if (convolution_memo_stats().saved == 0) {
+    printf("FAIL: the contact value saved no convolutions\n");
+    errorcode++;
+  }
+
+  // SaftFluidSlow adds to these the association free energy, which is
+  // found from n0 and the contact value of YuWuCorrelation_S.
+  // SaftFluidSlow isn't defined in this tree, so we build this part of
+  // it ourselves, leaving out its dispersion term:
+  //
+  //   A = 4 kT n0 (log X - X/2 + 1/2)
+  //   X = (sqrt(1 + 8 n0 Delta) - 1)/(4 n0 Delta)
+  //   Delta = gSigma kappa (exp(epsilon/kT) - 1)
+  //
+  // This is the composed (not generated) path, so it is where the memo
+  // pays off.
+  const Functional n0R = n0(R);
+  const Functional delta = (new_water_prop.kappaAB*(exp(new_water_prop.epsilonAB/kT) - 1))
+    *YuWuCorrelation_S(R);
+  const Functional X = (sqrt(Functional(1) + 8*n0R*delta) - Functional(1))/(4*n0R*delta);
+  const Functional association = (4*kT)*n0R*(log(X) - 0.5*X + Functional(0.5));
+  errorcode += check_memo("approximate SaftFluidSlow (HS + ideal + association)",
+                          hs + IdealGas() + association, kT, density);
+  if (convolution_memo_stats().saved == 0) {
+    printf("FAIL: approximate SaftFluidSlow saved no convolutions\n");
+    errorcode++;
+  }
+
+  // WaterSaft is generated code, which performs its own FFTs rather
+  // than using ConvolveWith, so the memo saves it nothing.
+  errorcode += check_memo("WaterSaft",
+                          WaterSaft(new_water_prop.lengthscale,
+                                    new_water_prop.epsilonAB,
+                                    new_water_prop.kappaAB,
+                                    new_water_prop.epsilon_dispersion,
+                                    new_water_prop.lambda_dispersion,
+                                    new_water_prop.length_scaling, 0),
+                          kT, density);
+  if (convolution_memo_stats().saved != 0 || convolution_memo_stats().computed != 0) {
+    printf("FAIL: the memo was used by the generated WaterSaft\n");
+    errorcode++;
+  }
+
+  if (errorcode == 0) printf("%s passes!\n", argv[0]);
+  return errorcode;
+}
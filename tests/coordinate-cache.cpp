@@ -0,0 +1,79 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+
+#include <stdio.h>
+#include "Grid.h"
+#include "CoordinateCache.h"
+
+double distance_squared(Cartesian r) {
+  return r.squaredNorm();
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  Lattice lat(Cartesian(0,.5,.5), Cartesian(.5,0,.5), Cartesian(.5,.5,0));
+  GridDescription gd(lat, 6, 8, 10);
+
+  int errorcode = 0;
+  // The cached positions should be exactly those from wignerSeitz.
+  const CoordinatePtr r = wigner_seitz_coordinates(gd);
+  for (int x=0; x<gd.Nx; x++) {
+    for (int y=0; y<gd.Ny; y++) {
+      for (int z=0; z<gd.Nz; z++) {
+        const Cartesian h(gd.Lat.wignerSeitz(gd.Lat.toCartesian(Relative(x*gd.dx,y*gd.dy,z*gd.dz))));
+        if ((*r)[x*gd.NyNz + y*gd.Nz + z] != h) {
+          printf("FAIL: wrong position at %d %d %d\n", x, y, z);
+          errorcode++;
+        }
+      }
+    }
+  }
+
+  // Set and the real-space operators should agree with each other,
+  // and should reuse the same table.
+  Grid a(gd), b(gd), c(gd);
+  a.Set(distance_squared);
+  b = r2(gd);
+  c = rx(gd).cwise().square() + ry(gd).cwise().square() + rz(gd).cwise().square();
+  for (int i=0; i<gd.NxNyNz; i++) {
+    if (a[i] != b[i] || fabs(a[i] - c[i]) > 1e-15) {
+      printf("FAIL: r2 is %g, %g and %g at %d\n", a[i], b[i], c[i], i);
+      errorcode++;
+    }
+  }
+  print_coordinate_cache_stats();
+  const CoordinateCacheStats s = coordinate_cache_stats();
+  if (s.misses != 1 || s.tables != 1) {
+    printf("FAIL: expected to compute one table, not %ld (holding %ld)\n", s.misses, s.tables);
+    errorcode++;
+  }
+  if (s.hits < 5) {
+    printf("FAIL: only %ld lookups found the table\n", s.hits);
+    errorcode++;
+  }
+
+  // A different grid needs its own table.
+  GridDescription gd2(lat, 6, 8, 12);
+  Grid d(gd2);
+  d = r2(gd2);
+  if (coordinate_cache_stats().tables != 2) {
+    printf("FAIL: expected two tables, not %ld\n", coordinate_cache_stats().tables);
+    errorcode++;
+  }
+  forget_coordinates();
+  return errorcode;
+}
@@ -0,0 +1,124 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This test checks that the irreducible wedge of a cubic grid
+// reproduces fields with cubic symmetry, and integrals over them, and
+// that symmetrize projects onto such fields.
+
+#include <stdio.h>
+#include <math.h>
+#include "new/CubicSymmetry.h"
+
+// fcc_density returns a sum of gaussians on the sites of an fcc lattice
+// with lattice constant 1, at the point with Cartesian coordinates r.
+double fcc_density(const double r[3]) {
+  double n = 0;
+  for (int a=-3; a<=3; a++) {
+    for (int b=-3; b<=3; b++) {
+      for (int c=-3; c<=3; c++) {
+        if ((a + b + c) & 1) continue; // not an fcc site in units of a/2
+        const double dx = r[0] - 0.5*a, dy = r[1] - 0.5*b, dz = r[2] - 0.5*c;
+        // An anisotropic term with cubic symmetry, so we notice if an
+        // operation is wrong.
+        const double d2 = dx*dx + dy*dy + dz*dz;
+        n += exp(-d2/0.005)*(1 + 10*(dx*dx*dx*dx + dy*dy*dy*dy + dz*dz*dz*dz));
+      }
+    }
+  }
+  return n;
+}
+
+int check_cell(const char *name, long N, CubicSymmetry::Cell cell) {
+  int errors = 0;
+  const CubicSymmetry symmetry(N, cell);
+  const long NNN = N*N*N;
+  Vector n(NNN);
+  for (long i=0; i<NNN; i++) {
+    const long a = i/(N*N), b = (i/N) % N, c = i % N;
+    double r[3];
+    if (cell == CubicSymmetry::cubic_cell) {
+      r[0] = a/double(N); r[1] = b/double(N); r[2] = c/double(N);
+    } else {
+      r[0] = 0.5*(b + c)/N; r[1] = 0.5*(a + c)/N; r[2] = 0.5*(a + b)/N;
+    }
+    n[i] = fcc_density(r);
+  }
+
+  long total = 0;
+  double full_sum = 0, wedge_sum = 0;
+  for (long w=0; w<symmetry.irreducible_size(); w++) {
+    total += symmetry.multiplicity(w);
+    wedge_sum += symmetry.multiplicity(w)*n[symmetry.irreducible(w)];
+  }
+  for (long i=0; i<NNN; i++) full_sum += n[i];
+  printf("%s: %ld irreducible points out of %ld (%.1f times fewer)\n",
+         name, symmetry.irreducible_size(), NNN, NNN/double(symmetry.irreducible_size()));
+  if (total != NNN) {
+    printf("FAIL: multiplicities add up to %ld rather than %ld\n", total, NNN);
+    errors++;
+  }
+  if (fabs(wedge_sum - full_sum) > 1e-12*full_sum) {
+    printf("FAIL: wedge sum %.15g differs from full sum %.15g\n", wedge_sum, full_sum);
+    errors++;
+  }
+  if (!(NNN > 30*symmetry.irreducible_size())) {
+    printf("FAIL: the wedge is too big\n");
+    errors++;
+  }
+  const Vector expanded = symmetry.expand(symmetry.reduce(n));
+  const Vector symmetrized = symmetry.symmetrize(n);
+  for (long i=0; i<NNN; i++) {
+    if (fabs(expanded[i] - n[i]) > 1e-12*fabs(n[i]) ||
+        fabs(symmetrized[i] - n[i]) > 1e-12*fabs(n[i])) {
+      printf("FAIL: the density at %ld is not symmetric: %g vs %g vs %g\n",
+             i, n[i], expanded[i], symmetrized[i]);
+      errors++;
+      break;
+    }
+  }
+
+  // A field without the symmetry becomes symmetric when symmetrized,
+  // keeping its integral, and stays put if symmetrized again.
+  Vector v(NNN + 1);
+  for (long i=0; i<NNN; i++) v[i] = sin(0.1*i) + 0.01*i;
+  v[NNN] = 42;
+  const Vector sv = symmetry.symmetrize(v), ssv = symmetry.symmetrize(sv);
+  double vsum = 0, svsum = 0;
+  for (long i=0; i<NNN; i++) {
+    vsum += v[i];
+    svsum += sv[i];
+    if (fabs(ssv[i] - sv[i]) > 1e-12 ||
+        fabs(sv[i] - sv[symmetry.irreducible(symmetry.orbit(i))]) > 1e-12) {
+      printf("FAIL: symmetrize is not a projection at %ld\n", i);
+      errors++;
+      break;
+    }
+  }
+  if (fabs(vsum - svsum) > 1e-10*fabs(vsum) || sv[NNN] != 42) {
+    printf("FAIL: symmetrize changed the integral (%g vs %g) or scalar (%g)\n",
+           vsum, svsum, sv[NNN]);
+    errors++;
+  }
+  return errors;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+  errorcode += check_cell("cubic cell", 24, CubicSymmetry::cubic_cell);
+  errorcode += check_cell("fcc primitive cell", 25, CubicSymmetry::fcc_primitive_cell);
+  return errorcode;
+}
@@ -0,0 +1,130 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This test checks the cylindrical transforms against the analytic
+// transforms of a gaussian and of its radial gradient, and checks
+// that convolving two gaussians gives the expected gaussian.
+
+#include <stdio.h>
+#include <math.h>
+#include "new/CylindricalTransform.h"
+
+const long Nr = 120, Nz = 64;
+const double R = 8, Lz = 12;
+
+// gaussian returns exp(-(r^2+z^2)/(2 sigma^2)), normalized in 3D, with
+// z centered in the cell.
+Vector gaussian(const Vector &r, double sigma) {
+  Vector out(Nr*Nz);
+  for (long n=0; n<Nr; n++) {
+    for (long q=0; q<Nz; q++) {
+      const double z = q*Lz/Nz - Lz/2;
+      out[n*Nz + q] = exp(-(r[n]*r[n] + z*z)/(2*sigma*sigma))/pow(2*M_PI*sigma*sigma, 1.5);
+    }
+  }
+  return out;
+}
+
+// gaussian_k returns the transform of gaussian, which picks up a
+// phase from being centered at z = Lz/2, times a power of kr.
+ComplexVector gaussian_k(const Vector &kr, double sigma, int power) {
+  ComplexVector out(Nr*(Nz/2+1));
+  for (long n=0; n<Nr; n++) {
+    for (long q=0; q<=Nz/2; q++) {
+      const double kz = 2*M_PI*q/Lz;
+      out[n*(Nz/2+1) + q] = pow(kr[n], power)*exp(-(kr[n]*kr[n] + kz*kz)*sigma*sigma/2)
+        *std::polar(1.0, -kz*Lz/2);
+    }
+  }
+  return out;
+}
+
+int check(const char *name, const Vector &a, const Vector &b, double fraction) {
+  double err = 0, biggest = 0;
+  for (long i=0; i<b.get_size(); i++) {
+    err = fmax(err, fabs(a[i] - b[i]));
+    biggest = fmax(biggest, fabs(b[i]));
+  }
+  printf("%s: relative error %g\n", name, err/biggest);
+  if (!(err <= fraction*biggest)) {
+    printf("FAIL: expected %s to have a relative error under %g\n", name, fraction);
+    return 1;
+  }
+  return 0;
+}
+
+int check(const char *name, const ComplexVector &a, const ComplexVector &b, double fraction) {
+  double err = 0, biggest = 0;
+  for (long i=0; i<b.get_size(); i++) {
+    err = fmax(err, abs(a[i] - b[i]));
+    biggest = fmax(biggest, abs(b[i]));
+  }
+  printf("%s: relative error %g\n", name, err/biggest);
+  if (!(err <= fraction*biggest)) {
+    printf("FAIL: expected %s to have a relative error under %g\n", name, fraction);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+
+  const Vector r = cylindrical_r(Nr, R), kr = cylindrical_kr(Nr, R);
+  const double sigma = 0.7;
+  const Vector g = gaussian(r, sigma);
+
+  {
+    const ComplexVector gk = cylindrical_fft(Nr, Nz, R, Lz, g);
+    errorcode += check("cylindrical_fft of gaussian", gk, gaussian_k(kr, sigma, 0), 1e-10);
+    errorcode += check("cylindrical_ifft of cylindrical_fft",
+                       cylindrical_ifft(Nr, Nz, R, Lz, gk), g, 1e-10);
+  }
+
+  {
+    // The gradient of g has radial component -r g/sigma^2, and should
+    // transform to kr times the transform of g.
+    Vector v(Nr*Nz);
+    for (long n=0; n<Nr; n++) {
+      for (long q=0; q<Nz; q++) v[n*Nz + q] = -r[n]*g[n*Nz + q]/(sigma*sigma);
+    }
+    const ComplexVector vk = cylindrical_vector_fft(Nr, Nz, R, Lz, v);
+    errorcode += check("cylindrical_vector_fft of gradient", vk, gaussian_k(kr, sigma, 1), 1e-10);
+    errorcode += check("cylindrical_vector_ifft of cylindrical_vector_fft",
+                       cylindrical_vector_ifft(Nr, Nz, R, Lz, vk), v, 1e-10);
+  }
+
+  {
+    // Gaussians convolve to a gaussian with the sum of the variances,
+    // although the product of two phases shifts it by Lz/2 in z, which
+    // takes it back to z = 0.
+    const double sigma2 = 0.4;
+    const ComplexVector a = cylindrical_fft(Nr, Nz, R, Lz, g),
+      b = cylindrical_fft(Nr, Nz, R, Lz, gaussian(r, sigma2));
+    ComplexVector ab(Nr*(Nz/2+1));
+    for (long i=0; i<Nr*(Nz/2+1); i++) ab[i] = a[i]*b[i];
+    const Vector expected = gaussian(r, sqrt(sigma*sigma + sigma2*sigma2));
+    Vector shifted(Nr*Nz);
+    for (long n=0; n<Nr; n++) {
+      for (long q=0; q<Nz; q++) shifted[n*Nz + q] = expected[n*Nz + (q + Nz/2) % Nz];
+    }
+    errorcode += check("convolution of gaussians", cylindrical_ifft(Nr, Nz, R, Lz, ab),
+                       shifted, 1e-10);
+  }
+  CylindricalWorkspace::release_all();
+  return errorcode;
+}
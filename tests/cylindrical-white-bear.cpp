@@ -0,0 +1,158 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+
+// This test checks the White Bear fluid on a cylindrical (r, z) grid:
+// that a uniform fluid at the bulk chemical potential is in
+// equilibrium, that the gradient is the derivative of the energy, and
+// that the density around a solute on the axis matches what we find on
+// a radial grid.
+
+#include <stdio.h>
+#include <math.h>
+#include "new/CylindricalWhiteBearFluid.h"
+#include "new/RadialWhiteBearFluid.h"
+#include "new/Minimize.h"
+
+const long Nr = 130, Nz = 120;
+const double Rcyl = 8, Lz = 12;
+const double kT = 1.0, R = 0.5, eta = 0.3;
+
+// bulk_mu returns the chemical potential of the uniform fluid with
+// density n.
+double bulk_mu(double n) {
+  const WhiteBearPhi p = white_bear_phi(R, n*4*M_PI*R*R, n*4*M_PI/3*R*R*R, 0);
+  const double lognQ = 1.5*log(18.01528*1822.8885*kT/(2*M_PI));
+  return kT*(log(n) - lognQ) + kT*(p.d_n2*4*M_PI*R*R + p.d_n3*4*M_PI/3*R*R*R);
+}
+
+// solute_potential is the repulsion of the solute, at distance d from
+// its center, capped so that it stays finite.
+double solute_potential(double d) {
+  const double s6 = pow(1.5/d, 6);
+  return fmin(4*kT*s6*s6, 100*kT);
+}
+
+// contact_density returns the largest density in n.
+double contact_density(const Vector &n) {
+  double contact = 0;
+  for (int i=0; i<n.get_size(); i++) contact = fmax(contact, n[i]);
+  return contact;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+  const double nb = eta/(4*M_PI/3*R*R*R);
+
+  CylindricalWhiteBearFluid f(Nr, Nz, Rcyl, Lz);
+  f.R() = R;
+  f.kT() = kT;
+  f.mu() = bulk_mu(nb);
+  f.Veff() = -kT*log(nb);
+
+  {
+    // The volumes of the grid points should add up to that of the
+    // cylinder, to within the accuracy of the quadrature, which is
+    // about 1/Nr.
+    const Vector vol = f.get_volume();
+    double total = 0;
+    for (long i=0; i<Nr*Nz; i++) total += vol[i];
+    printf("volume %.12g, expected %.12g\n", total, M_PI*Rcyl*Rcyl*Lz);
+    if (!(fabs(total/(M_PI*Rcyl*Rcyl*Lz) - 1) < 1e-2)) {
+      printf("FAIL: the grid points have the wrong volume\n");
+      errorcode++;
+    }
+  }
+  {
+    // The uniform fluid should have (nearly) no gradient, and n3 should
+    // be the packing fraction.
+    const Vector g = f.grad(), vol = f.get_volume(), n3 = f.get_n3();
+    double worst = 0, worst_n3 = 0;
+    for (long i=0; i<Nr*Nz; i++) {
+      worst = fmax(worst, fabs(g[i]/vol[i]));
+      worst_n3 = fmax(worst_n3, fabs(n3[i] - eta));
+    }
+    printf("uniform fluid: gradient per volume %g, n3 error %g\n", worst, worst_n3);
+    if (!(worst < 1e-8 && worst_n3 < 1e-10)) {
+      printf("FAIL: the uniform fluid isn't in equilibrium\n");
+      errorcode++;
+    }
+  }
+
+  // Now we put a solute on the axis at z = Lz/2.  We give it a smooth
+  // repulsive potential rather than a hard wall, so that its shape
+  // doesn't depend on how it lies on the grid.
+  const Vector r = f.get_r(), z = f.get_z();
+  for (long i=0; i<Nr*Nz; i++) {
+    const double d = sqrt(r[i]*r[i] + (z[i] - Lz/2)*(z[i] - Lz/2));
+    f.Vext()[i] = solute_potential(d);
+    f.Veff()[i] = -kT*log(nb) + f.Vext()[i];
+  }
+  {
+    // The direction must vanish in the shell where Veff is held fixed.
+    Vector direction(Nr*Nz);
+    for (long i=0; i<Nr*Nz; i++) {
+      const double d = sqrt(r[i]*r[i] + (z[i] - Lz/2)*(z[i] - Lz/2));
+      direction[i] = r[i] < f.r_fixed() ? exp(-(d - 2.5)*(d - 2.5)) : 0;
+    }
+    errorcode += f.run_finite_difference_test("cylindrical white bear", &direction);
+  }
+
+  Minimize min(&f);
+  min.set_relative_precision(0);
+  min.set_precision(1e-10);
+  min.set_maxiter(500);
+  min.precondition(true);
+  while (min.improve_energy(quiet)) {}
+  min.print_info();
+
+  // The same sphere on a radial grid, with the same smearing of the
+  // weights.
+  const double dr = Lz/Nz;
+  RadialWhiteBearFluid radial(long(Rcyl/dr), dr);
+  radial.R() = R;
+  radial.kT() = kT;
+  radial.mu() = bulk_mu(nb);
+  radial.Veff() = -kT*log(nb);
+  const Vector rr = radial.get_r();
+  for (long i=0; i<radial.Nr(); i++) {
+    radial.Vext()[i] = solute_potential(rr[i]);
+    radial.Veff()[i] = -kT*log(nb) + radial.Vext()[i];
+  }
+  Minimize rmin(&radial);
+  rmin.set_relative_precision(0);
+  rmin.set_precision(1e-12);
+  rmin.set_maxiter(500);
+  rmin.precondition(true);
+  while (rmin.improve_energy(quiet)) {}
+
+  const double contact = contact_density(f.get_n());
+  const double radial_contact = contact_density(radial.get_n());
+  printf("contact density %g, on a radial grid %g, bulk density %g\n",
+         contact, radial_contact, nb);
+  if (!(contact > 1.3*nb)) {
+    printf("FAIL: the fluid doesn't pile up against the solute\n");
+    errorcode++;
+  }
+  if (!(fabs(contact/radial_contact - 1) < 0.05)) {
+    printf("FAIL: the contact density differs from that on a radial grid\n");
+    errorcode++;
+  }
+
+  if (errorcode == 0) printf("%s passes!\n", argv[0]);
+  return errorcode;
+}
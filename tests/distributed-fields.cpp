@@ -0,0 +1,226 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This test checks fields on a grid split among MPI ranks: the
+// integrals, transforms and a minimization must give the same answers
+// as on a single rank.  It runs on one rank as an ordinary test, and
+// may also be run with e.g. "mpirun -np 4" when deft is built with
+// DEFT_MPI.
+
+#include <stdio.h>
+#include <math.h>
+#include "utilities.h"
+#include "new/Minimize.h"
+
+const long Nx = 12, Ny = 8, Nz = 10;
+const double dx = 0.5;
+const double dV = dx*dx*dx;
+
+// wave is a plane wave with 2, 1 and 3 periods along x, y and z.
+double wave(long x, long y, long z) {
+  return cos(2*M_PI*(2.0*x/Nx + 1.0*y/Ny + 3.0*z/Nz));
+}
+const double wave_ksqr = 4*M_PI*M_PI*(4/(Nx*dx*Nx*dx) + 1/(Ny*dx*Ny*dx) + 9/(Nz*dx*Nz*dx));
+
+// ksqr returns the square of the wave vector at point i of our slab
+// in reciprocal space.
+double ksqr(long i) {
+  const long z = i % (Nz/2+1), y = (i/(Nz/2+1)) % Ny;
+  long x = i/((Nz/2+1)*Ny) + slab_x_start(Nx, Ny, Nz);
+  const long ky = (y > Ny/2) ? y - Ny : y;
+  if (x > Nx/2) x -= Nx;
+  return 4*M_PI*M_PI*(x*x/(Nx*dx*Nx*dx) + ky*ky/(Ny*dx*Ny*dx) + z*z/(Nz*dx*Nz*dx));
+}
+
+// Quadratic has its minimum at n = (1 - nabla^2)^-1 b, so with b a
+// plane wave, n is the same wave divided by 1 + k^2.
+class Quadratic : public NewFunctional {
+public:
+  explicit Quadratic(const Vector &myb) : b(myb) {
+    data = Vector(slab_size(Nx, Ny, Nz));
+    data = 0.0;
+  }
+  double energy() const {
+    return sum_over_ranks((0.5*data.dot(L(data)) - b.dot(data))*dV);
+  }
+  Vector grad() const {
+    Vector g = dV*(L(data) - b);
+    return g;
+  }
+  void printme(const char *) const {}
+  Vector get_n() const { return data; }
+private:
+  Vector L(const Vector &x) const {
+    ComplexVector k = fft(Nx, Ny, Nz, dV, x);
+    for (long i=0; i<k.get_size(); i++) k[i] *= 1 + ksqr(i);
+    return ifft(Nx, Ny, Nz, dV, k);
+  }
+  Vector b;
+};
+
+// WithScalar adds to Quadratic a scalar variable c, stored after the
+// field in data, and so held by every rank.  Its energy is minimized
+// at c = 3 + sum n dV.  Its dot counts c only once, as the generated
+// functionals do for their scalars.
+class WithScalar : public NewFunctional {
+public:
+  explicit WithScalar(const Vector &myb) : q(myb) {
+    data = Vector(slab_size(Nx, Ny, Nz) + 1);
+    data = 0.0;
+  }
+  double energy() const {
+    q.set_n(n());
+    const double s = sum_over_ranks(n().sum())*dV;
+    return q.energy() + 0.5*(c() - 3 - s)*(c() - 3 - s);
+  }
+  Vector grad() const {
+    q.set_n(n());
+    const double s = sum_over_ranks(n().sum())*dV;
+    const long N = slab_size(Nx, Ny, Nz);
+    const Vector qg = q.grad();
+    Vector g(N + 1);
+    for (long i=0; i<N; i++) g[i] = qg[i] - (c() - 3 - s)*dV;
+    g[N] = c() - 3 - s;
+    return g;
+  }
+  double dot(const Vector &a, const Vector &b) const {
+    double out = a.dot(b);
+    if (my_rank() != 0) {
+      const long last = slab_size(Nx, Ny, Nz);
+      out -= a[last]*b[last];
+    }
+    return sum_over_ranks(out);
+  }
+  void printme(const char *) const {}
+  Vector n() const { return data.slice(0, slab_size(Nx, Ny, Nz)); }
+  double c() const { return data[slab_size(Nx, Ny, Nz)]; }
+private:
+  class Field : public Quadratic {
+  public:
+    explicit Field(const Vector &b) : Quadratic(b) {}
+    void set_n(const Vector &n) const { data = n; }
+  };
+  Field q;
+};
+
+int main(int argc, char *argv[]) {
+  distributed_init(&argc, &argv);
+  if (my_rank() == 0) printf("Working on %s with %d ranks\n", argv[0], rank_count());
+  int errorcode = 0;
+
+  Vector full(Nx*Ny*Nz), plane(Nx*Ny*Nz);
+  for (long x=0; x<Nx; x++) {
+    for (long y=0; y<Ny; y++) {
+      for (long z=0; z<Nz; z++) {
+        full[(x*Ny + y)*Nz + z] = 1 + wave(x, y, z) + 0.1*sin(2*M_PI*x/Nx) + 0.01*x*y;
+        plane[(x*Ny + y)*Nz + z] = wave(x, y, z);
+      }
+    }
+  }
+  const Vector f = local_slab(Nx, Ny, Nz, full), b = local_slab(Nx, Ny, Nz, plane);
+
+  const double integral = sum_over_ranks(f.sum())*dV;
+  if (fabs(integral - full.sum()*dV) > 1e-13*fabs(integral)) {
+    printf("FAIL: rank %d has the integral %.16g rather than %.16g\n",
+           my_rank(), integral, full.sum()*dV);
+    errorcode++;
+  }
+  Vector difference(Nx*Ny*Nz);
+  difference = gather_field(Nx, Ny, Nz, f) - full;
+  if (difference.norm() != 0) {
+    printf("FAIL: rank %d doesn't gather the field it started with\n", my_rank());
+    errorcode++;
+  }
+
+  // The transform of the plane wave is N/2 at (2,1,3), and zero
+  // everywhere else in our half of reciprocal space.
+  const ComplexVector bk = fft(Nx, Ny, Nz, 1.0, b);
+  double kerror = 0;
+  for (long i=0; i<bk.get_size(); i++) {
+    const long z = i % (Nz/2+1), y = (i/(Nz/2+1)) % Ny;
+    const long x = i/((Nz/2+1)*Ny) + slab_x_start(Nx, Ny, Nz);
+    const double expected = (x == 2 && y == 1 && z == 3) ? Nx*Ny*Nz/2.0 : 0;
+    kerror += std::abs(bk[i] - expected);
+  }
+  kerror = sum_over_ranks(kerror);
+  if (kerror > 1e-10*Nx*Ny*Nz) {
+    printf("FAIL: the transform of a plane wave is off by %g\n", kerror);
+    errorcode++;
+  }
+  Vector roundtrip(f.get_size());
+  roundtrip = ifft(Nx, Ny, Nz, dV, fft(Nx, Ny, Nz, dV, f)) - f;
+  const double rterror = norm_over_ranks(roundtrip);
+  if (rterror > 1e-12*norm_over_ranks(f)) {
+    printf("FAIL: ifft(fft(f)) differs from f by %g\n", rterror);
+    errorcode++;
+  }
+  {
+    // ifft_many must normalize by the whole grid, just as ifft does.
+    const ComplexVector fk = fft(Nx, Ny, Nz, dV, f), bk2 = fft(Nx, Ny, Nz, dV, b);
+    const ComplexVector *ins[] = { &fk, &bk2 };
+    Vector fr, br;
+    Vector *outs[] = { &fr, &br };
+    ifft_many(Nx, Ny, Nz, dV, 2, ins, outs);
+    Vector d(f.get_size());
+    d = fr - f;
+    const double manyerror = norm_over_ranks(d);
+    d = br - b;
+    if (manyerror + norm_over_ranks(d) > 1e-12*(norm_over_ranks(f) + norm_over_ranks(b))) {
+      printf("FAIL: ifft_many differs from ifft by %g\n", manyerror + norm_over_ranks(d));
+      errorcode++;
+    }
+  }
+
+  Quadratic q(b);
+  Minimize min(&q);
+  min.set_relative_precision(0);
+  min.set_precision(1e-14);
+  while (min.improve_energy(silent)) {}
+  Vector nerror(Nx*Ny*Nz);
+  nerror = gather_field(Nx, Ny, Nz, q.get_n()) - plane/(1 + wave_ksqr);
+  // Every rank must compute the energy, since it involves them all.
+  const double energy = q.energy(), expected_energy = -0.25*Nx*Ny*Nz*dV/(1 + wave_ksqr);
+  if (my_rank() == 0) {
+    printf("Minimized energy %.15g (expected %.15g) after %d iterations\n",
+           energy, expected_energy, min.get_iteration_count());
+  }
+  if (nerror.norm() > 1e-6*plane.norm() || fabs(energy - expected_energy) > 1e-10) {
+    printf("FAIL: rank %d minimized to a density off by %g\n", my_rank(), nerror.norm());
+    errorcode++;
+  }
+
+  // With a scalar variable, the minimum is at the same density, and c
+  // is 3, since the density integrates to zero.
+  WithScalar ws(b);
+  Minimize wsmin(&ws);
+  wsmin.set_relative_precision(0);
+  wsmin.set_precision(1e-14);
+  while (wsmin.improve_energy(silent)) {}
+  nerror = gather_field(Nx, Ny, Nz, ws.n()) - plane/(1 + wave_ksqr);
+  if (my_rank() == 0) {
+    printf("Minimized with a scalar to c = %.15g after %d iterations\n",
+           ws.c(), wsmin.get_iteration_count());
+  }
+  if (nerror.norm() > 1e-6*plane.norm() || fabs(ws.c() - 3) > 1e-6) {
+    printf("FAIL: rank %d minimized with a scalar to c = %.15g and a density off by %g\n",
+           my_rank(), ws.c(), nerror.norm());
+    errorcode++;
+  }
+
+  if (errorcode == 0 && my_rank() == 0) printf("%s passes!\n", argv[0]);
+  distributed_finalize();
+  return errorcode;
+}
@@ -0,0 +1,113 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This test checks that transforming in place gives the same answer
+// as an ordinary fft followed by an ifft, and reports how much memory
+// it saves, for both the Grid and the new Vector code.
+
+#include <stdio.h>
+#include <math.h>
+#include "Grid.h"
+#include "ReciprocalGrid.h"
+#include "utilities.h"
+#include "new/Vector.h"
+
+const int N = 32;
+
+// peak_fields reports the peak memory (in units of one real-space
+// field) used since the last reset, beyond what was in use then.
+double peak_fields(long start) {
+  return (peak_memory() - start)/double(N*N*N*sizeof(double));
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+
+  {
+    Lattice lat(Cartesian(0,5,5), Cartesian(5,0,5), Cartesian(5,5,0));
+    GridDescription gd(lat, N, N, N);
+    Grid g(gd);
+    g = (-r2(gd)).cwise().exp();
+
+    reset_peak_memory();
+    long start = current_memory();
+    Grid before = g.fft().ifft();
+    const double peak_before = peak_fields(start);
+
+    before.resize(0);
+    reset_peak_memory();
+    start = current_memory();
+    VectorXd after;
+    {
+      VectorXcd padded;
+      pad_for_fft(gd, g, &padded);
+      fft_in_place(gd, &padded);
+      ifft_in_place(gd, &padded);
+      unpad_from_fft(gd, padded, &after);
+    }
+    const double peak_after = peak_fields(start);
+    printf("Grid fft and ifft: peak memory of %g fields before, %g in place\n",
+           peak_before, peak_after);
+    if (peak_after >= peak_before) {
+      printf("FAIL: transforming a Grid in place doesn't save memory!\n");
+      errorcode++;
+    }
+    for (int i=0; i<gd.NxNyNz; i++) {
+      if (fabs(after[i] - g[i]) > 1e-14) {
+        printf("Grid error of %g\n", after[i] - g[i]);
+        errorcode++;
+      }
+    }
+  }
+
+  {
+    const double dV = 0.01;
+    Vector v(N*N*N);
+    for (int i=0; i<N*N*N; i++) v[i] = exp(-1e-4*i);
+
+    reset_peak_memory();
+    long start = current_memory();
+    Vector before = ifft(N, N, N, dV, fft(N, N, N, dV, v));
+    const double peak_before = peak_fields(start);
+
+    before.free();
+    Vector work = Vector::padded(N, N, N);
+    work = v;
+    reset_peak_memory();
+    start = current_memory();
+    ComplexVector k = fft_in_place(N, N, N, dV, work);
+    Vector after = ifft_in_place(N, N, N, dV, k);
+    const double peak_after = peak_fields(start);
+    printf("Vector fft and ifft: peak memory of %g fields before, %g in place\n",
+           peak_before, peak_after);
+    if (peak_after > 0) {
+      printf("FAIL: transforming a Vector in place shouldn't need any more memory!\n");
+      errorcode++;
+    }
+    if (work.get_size() != 0 || k.get_size() != 0) {
+      printf("FAIL: in-place transforms should leave their input empty\n");
+      errorcode++;
+    }
+    for (int i=0; i<N*N*N; i++) {
+      if (fabs(after[i] - v[i]) > 1e-14) {
+        printf("Vector error of %g\n", after[i] - v[i]);
+        errorcode++;
+      }
+    }
+  }
+  return errorcode;
+}
@@ -0,0 +1,75 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+#include <stdio.h>
+#include "Grid.h"
+#include "ReciprocalGrid.h"
+#include "FFTPlanCache.h"
+#include "Functionals.h"
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  Lattice lat(Cartesian(0,.5,.5), Cartesian(.5,0,.5), Cartesian(.5,.5,0));
+  const int resolution = 8;
+  GridDescription gd(lat, resolution, resolution, resolution);
+  Grid foo(gd);
+  foo = (-30*r2(gd)).cwise().exp();
+  const Grid orig(foo);
+
+  int errorcode = 0;
+  // Neither creating a GridDescription nor creating a convolution
+  // should cause us to plan an fft.
+  Functional conv = StepConvolve(0.1);
+  if (fft_plan_cache_stats().plans != 0) {
+    printf("FAIL: we made %ld plans before doing any ffts\n", fft_plan_cache_stats().plans);
+    errorcode++;
+  }
+  printf("Created %s without planning any ffts.\n", conv.get_name().c_str());
+
+  const FFTPlanCacheStats before = fft_plan_cache_stats();
+  const int num_transforms = 10;
+  for (int i=0; i<num_transforms; i++) {
+    foo = foo.fft().ifft();
+  }
+  const FFTPlanCacheStats after = fft_plan_cache_stats();
+  print_fft_plan_cache_stats();
+
+  const long executions = after.executions - before.executions;
+  const long hits = after.hits - before.hits;
+  if (executions != 2*num_transforms) {
+    printf("FAIL: expected %d transforms, but saw %ld\n", 2*num_transforms, executions);
+    errorcode++;
+  }
+  // We allow a couple of misses, since the plans are made the first
+  // time we transform.
+  if (hits < executions - 2) {
+    printf("FAIL: only %ld of %ld transforms reused a cached plan\n", hits, executions);
+    errorcode++;
+  }
+  if (after.plans > 4) {
+    printf("FAIL: there should be at most four plans, but we have %ld\n", after.plans);
+    errorcode++;
+  }
+
+  for (int i=0; i<gd.NxNyNz; i++) {
+    const double e = foo[i] - orig[i];
+    if (fabs(e) > 1e-14) {
+      printf("Error of %g\n", e);
+      errorcode += 1;
+    }
+  }
+  return errorcode;
+}
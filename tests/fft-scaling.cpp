@@ -0,0 +1,95 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This is a benchmark rather than a test: it reports how much faster
+// a forward plus inverse FFT becomes as we use more threads, for a few
+// typical grid sizes, on both the Eigen Grid and the new Vector code
+// paths.  You may give the maximum number of threads to try as an
+// argument; by default we go up to the number of cores.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "Grid.h"
+#include "ReciprocalGrid.h"
+#include "FFTThreads.h"
+#include "new/Vector.h"
+
+// We need wall-clock time, since cpu time adds up over all threads.
+double wall_time() {
+  struct timeval tv;
+  gettimeofday(&tv, 0);
+  return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+double time_vector_ffts(int N, int repeats) {
+  const double dV = 0.01;
+  Vector rs(long(N)*N*N);
+  for (long i=0; i<rs.get_size(); i++) rs[i] = exp(-1e-4*i);
+  rs = ifft(N, N, N, dV, fft(N, N, N, dV, rs)); // plan outside the timing
+  const double start = wall_time();
+  for (int i=0; i<repeats; i++) {
+    rs = ifft(N, N, N, dV, fft(N, N, N, dV, rs));
+  }
+  return (wall_time() - start)/repeats;
+}
+
+double time_grid_ffts(int N, int repeats) {
+  Lattice lat(Cartesian(0,5,5), Cartesian(5,0,5), Cartesian(5,5,0));
+  GridDescription gd(lat, N, N, N);
+  Grid g(gd);
+  g = (-r2(gd)).cwise().exp();
+  g = g.fft().ifft(); // plan outside the timing
+  const double start = wall_time();
+  for (int i=0; i<repeats; i++) {
+    g = g.fft().ifft();
+  }
+  return (wall_time() - start)/repeats;
+}
+
+int main(int argc, char *argv[]) {
+  int maxthreads = sysconf(_SC_NPROCESSORS_ONLN);
+  if (argc > 1) maxthreads = atoi(argv[1]);
+  if (maxthreads < 1) maxthreads = 1;
+
+  const int sizes[] = { 64, 96, 128, 192 };
+  const int num_sizes = sizeof(sizes)/sizeof(sizes[0]);
+  for (int s=0; s<num_sizes; s++) {
+    const int N = sizes[s];
+    const int repeats = N > 128 ? 4 : 16;
+    printf("\n=== %d^3 grid ===\n", N);
+    printf("%8s %14s %9s %14s %9s\n", "threads", "Vector (s)", "speedup", "Grid (s)", "speedup");
+    double vector_serial = 0, grid_serial = 0;
+    int nthreads = 1;
+    while (true) {
+      set_fft_threads(nthreads);
+      const double tv = time_vector_ffts(N, repeats);
+      const double tg = time_grid_ffts(N, repeats);
+      if (nthreads == 1) {
+        vector_serial = tv;
+        grid_serial = tg;
+      }
+      printf("%8d %14.5f %9.2f %14.5f %9.2f\n", nthreads,
+             tv, vector_serial/tv, tg, grid_serial/tg);
+      fflush(stdout);
+      if (nthreads == maxthreads) break;
+      nthreads = (2*nthreads < maxthreads) ? 2*nthreads : maxthreads;
+    }
+  }
+  return 0;
+}
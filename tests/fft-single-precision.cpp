@@ -0,0 +1,94 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This test checks that single-precision FFTs of a Vector agree with
+// double-precision ones to about single precision, and that switching
+// back to double precision gives us full precision again.  Without
+// DEFT_FFT_SINGLE, asking for single precision should give us double
+// precision.
+
+#include <stdio.h>
+#include <math.h>
+#include "FFTPrecision.h"
+#include "new/Vector.h"
+
+const int Nx = 8, Ny = 12, Nz = 10;
+const double dV = 0.01;
+
+// maxerr returns the largest difference between a and b, relative to
+// the largest element of b.
+double maxerr(const Vector &a, const Vector &b) {
+  double err = 0, biggest = 0;
+  for (int i=0; i<b.get_size(); i++) {
+    err = fmax(err, fabs(a[i] - b[i]));
+    biggest = fmax(biggest, fabs(b[i]));
+  }
+  return err/biggest;
+}
+
+double maxerr(const ComplexVector &a, const ComplexVector &b) {
+  double err = 0, biggest = 0;
+  for (int i=0; i<b.get_size(); i++) {
+    err = fmax(err, abs(a[i] - b[i]));
+    biggest = fmax(biggest, abs(b[i]));
+  }
+  return err/biggest;
+}
+
+int check(const char *name, double err, double lo, double hi) {
+  printf("%s: relative error %g\n", name, err);
+  if (err < lo || err > hi) {
+    printf("FAIL: expected %s to have error between %g and %g\n", name, lo, hi);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+
+  Vector v(Nx*Ny*Nz);
+  for (int i=0; i<Nx*Ny*Nz; i++) v[i] = exp(-0.01*i) + sin(0.3*i);
+
+  const ComplexVector kdouble = fft(Nx, Ny, Nz, dV, v);
+  const Vector vdouble = ifft(Nx, Ny, Nz, dV, kdouble);
+  errorcode += check("double fft and ifft", maxerr(vdouble, v), 0, 1e-13);
+
+#ifdef DEFT_FFT_SINGLE
+  const double lo = 1e-12, hi = 1e-5;
+#else
+  const double lo = 0, hi = 1e-13;
+#endif
+  {
+    const FFTPrecisionScope single(true);
+    const ComplexVector ksingle = fft(Nx, Ny, Nz, dV, v);
+    errorcode += check("single fft", maxerr(ksingle, kdouble), lo, hi);
+    const Vector vsingle = ifft(Nx, Ny, Nz, dV, ksingle);
+    errorcode += check("single fft and ifft", maxerr(vsingle, v), lo, hi);
+
+    Vector work = Vector::padded(Nx, Ny, Nz);
+    work = v;
+    ComplexVector k = fft_in_place(Nx, Ny, Nz, dV, work);
+    const Vector vinplace = ifft_in_place(Nx, Ny, Nz, dV, k);
+    errorcode += check("single fft and ifft in place", maxerr(vinplace, v), lo, hi);
+  }
+
+  const Vector vagain = ifft(Nx, Ny, Nz, dV, fft(Nx, Ny, Nz, dV, v));
+  errorcode += check("double fft and ifft again", maxerr(vagain, v), 0, 1e-13);
+  if (errorcode == 0) printf("%s passes!\n", argv[0]);
+  return errorcode;
+}
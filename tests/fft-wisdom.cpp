@@ -0,0 +1,119 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+#include <stdio.h>
+#include <sys/stat.h>
+#include "new/Vector.h"
+
+// have_wisdom checks whether fftw can make an out-of-place r2c plan of
+// this size from its wisdom alone.
+static bool have_wisdom(int N) {
+  double *r = (double *)fftw_malloc(N*N*N*sizeof(double));
+  fftw_complex *c = (fftw_complex *)fftw_malloc(N*N*(N/2+1)*sizeof(fftw_complex));
+  fftw_plan p = fftw_plan_dft_r2c_3d(N, N, N, r, c, FFTW_MEASURE | FFTW_WISDOM_ONLY);
+  if (p) fftw_destroy_plan(p);
+  fftw_free(r);
+  fftw_free(c);
+  return p != 0;
+}
+
+static void transform(int N) {
+  Vector x(N*N*N);
+  for (int i=0; i<N*N*N; i++) x[i] = i % 7;
+  fft(N, N, N, 1.0, x);
+}
+
+static bool file_exists(const std::string &fname) {
+  struct stat st;
+  return stat(fname.c_str(), &st) == 0 && st.st_size > 0;
+}
+
+int main(int, char **argv) {
+  int errorcode = 0;
+
+  // With no DEFT_FFTW_WISDOM we must not write any files.
+  if (!getenv("DEFT_FFTW_WISDOM") && fft_wisdom_file_setting() != "") {
+    printf("FAIL: we use the wisdom file %s without being asked to\n",
+           fft_wisdom_file_setting().c_str());
+    errorcode++;
+  }
+
+  char dirname[] = "/tmp/deft-wisdom-XXXXXX";
+  if (!mkdtemp(dirname)) {
+    printf("FAIL: cannot create a temporary directory\n");
+    return 1;
+  }
+  const std::string fname = std::string(dirname) + "/wisdom";
+  set_fft_wisdom_file(fname.c_str());
+
+  // Saving wisdom should create the file (and the single-precision
+  // one alongside it, if we have single-precision FFTs).
+  transform(8);
+  save_fft_wisdom();
+  if (!file_exists(fname)) {
+    printf("FAIL: save_fft_wisdom didn't create %s\n", fname.c_str());
+    errorcode++;
+  }
+#ifdef DEFT_FFT_SINGLE
+  if (!file_exists(fname + ".float")) {
+    printf("FAIL: save_fft_wisdom didn't create %s.float\n", fname.c_str());
+    errorcode++;
+  }
+#endif
+
+  // Another process's wisdom (here, wisdom we have forgotten) should be
+  // merged with ours when we save, rather than being overwritten.
+  fftw_forget_wisdom();
+  FFTWorkspace::release_all();
+  transform(6);
+  save_fft_wisdom();
+  fftw_forget_wisdom();
+  fftw_import_wisdom_from_filename(fname.c_str());
+  if (!have_wisdom(8) || !have_wisdom(6)) {
+    printf("FAIL: the saved wisdom for 8^3 (%d) and 6^3 (%d) wasn't merged\n",
+           have_wisdom(8), have_wisdom(6));
+    errorcode++;
+  }
+
+  // While one process holds the lock, no other can take it.
+  const int fd = fft_wisdom_lock(fname, LOCK_EX);
+  if (fd < 0) {
+    printf("FAIL: cannot lock %s.lock\n", fname.c_str());
+    errorcode++;
+  }
+  const int other = fft_wisdom_lock(fname, LOCK_EX | LOCK_NB);
+  if (other >= 0) {
+    printf("FAIL: two of us hold the lock at once\n");
+    fft_wisdom_unlock(other);
+    errorcode++;
+  }
+  fft_wisdom_unlock(fd);
+  const int after = fft_wisdom_lock(fname, LOCK_EX | LOCK_NB);
+  if (after < 0) {
+    printf("FAIL: the lock wasn't released\n");
+    errorcode++;
+  }
+  fft_wisdom_unlock(after);
+
+  set_fft_wisdom_file(0);
+  unlink(fname.c_str());
+  unlink((fname + ".float").c_str());
+  unlink((fname + ".lock").c_str());
+  rmdir(dirname);
+
+  if (errorcode == 0) printf("%s passes!\n", argv[0]);
+  return errorcode;
+}
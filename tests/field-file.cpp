@@ -0,0 +1,129 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+
+#include <stdio.h>
+#include "Grid.h"
+#include "new/Vector.h"
+
+int check(const char *name, double got, double expected, double tolerance) {
+  if (fabs(got - expected) > tolerance) {
+    printf("FAIL: %s gives %.15g rather than %.15g\n", name, got, expected);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+
+  Lattice lat(Cartesian(0,2,2), Cartesian(2,0,2), Cartesian(2,2,0));
+  GridDescription gd(lat, 12, 10, 14);
+  Grid g(gd);
+  for (int x=0; x<gd.Nx; x++) {
+    for (int y=0; y<gd.Ny; y++) {
+      for (int z=0; z<gd.Nz; z++) {
+        g(x,y,z) = 1 + cos(2*M_PI*(x*gd.dx + 2*y*gd.dy)) + 0.5*sin(2*M_PI*z*gd.dz);
+      }
+    }
+  }
+
+  // A Grid survives a round trip exactly.
+  if (!g.DumpBinary("field-file.dat")) {
+    printf("FAIL: DumpBinary failed\n");
+    errorcode++;
+  }
+  // If it can't be written, we hear about it.
+  if (g.DumpBinary("no-such-directory/field-file.dat")) {
+    printf("FAIL: DumpBinary into a missing directory succeeded\n");
+    errorcode++;
+  }
+  Grid g2(gd);
+  if (!g2.LoadBinary("field-file.dat")) {
+    printf("FAIL: LoadBinary failed\n");
+    errorcode++;
+  }
+  for (int i=0; i<gd.NxNyNz; i++) errorcode += check("LoadBinary", g2[i], g[i], 0);
+
+  // Loading it onto a finer grid resamples it.
+  GridDescription fine(lat, 20, 16, 20);
+  Grid g3(fine);
+  if (!g3.LoadBinary("field-file.dat")) {
+    printf("FAIL: LoadBinary onto a finer grid failed\n");
+    errorcode++;
+  }
+  const Grid resampled = g.Resample(fine);
+  for (int i=0; i<fine.NxNyNz; i++) errorcode += check("resampling LoadBinary", g3[i], resampled[i], 1e-14);
+
+  // But it won't load onto another lattice.
+  Lattice other(Cartesian(0,2,2), Cartesian(2,0,2), Cartesian(2,2,0.1));
+  Grid g4(GridDescription(other, 12, 10, 14));
+  g4.setZero();
+  if (g4.LoadBinary("field-file.dat")) {
+    printf("FAIL: LoadBinary accepted the wrong lattice\n");
+    errorcode++;
+  }
+
+  // A mapped file gives the same values without reading them.
+  {
+    MappedFieldFile m("field-file.dat");
+    if (!m.ok() || m.info().Nx != 12 || m.info().Ny != 10 || m.info().Nz != 14 ||
+        m.info().size != gd.NxNyNz || m.info().lattice[2][1] != 2) {
+      printf("FAIL: MappedFieldFile has the wrong header\n");
+      errorcode++;
+    } else {
+      for (int i=0; i<gd.NxNyNz; i++) errorcode += check("MappedFieldFile", m.data()[i], g[i], 0);
+    }
+  }
+
+  // A Vector holding two fields and two scalars also survives.
+  const long Nx = 6, Ny = 4, Nz = 8, N = Nx*Ny*Nz;
+  Vector v(2*N + 2);
+  for (long i=0; i<v.get_size(); i++) v[i] = sin(0.1*i) + 0.01*i;
+  if (!save_field("field-file.dat", Nx, Ny, Nz, 3, 2, 4, v)) {
+    printf("FAIL: save_field failed\n");
+    errorcode++;
+  }
+  FieldFileInfo info;
+  const Vector w = load_field("field-file.dat", &info);
+  if (w.get_size() != v.get_size() || info.Nx != Nx || info.Ny != Ny || info.Nz != Nz ||
+      info.lattice[0][0] != 3 || info.lattice[1][1] != 2 || info.lattice[2][2] != 4 ||
+      info.lattice[0][1] != 0) {
+    printf("FAIL: load_field gives the wrong size or grid\n");
+    errorcode++;
+  } else {
+    for (long i=0; i<v.get_size(); i++) errorcode += check("load_field", w[i], v[i], 0);
+  }
+
+  // Files that aren't field files are rejected.
+  FILE *f = fopen("field-file.dat", "w");
+  fprintf(f, "This is not a field file, though it is long enough to hold a header.\n");
+  for (int i=0; i<300; i++) fputc('x', f);
+  fclose(f);
+  if (load_field("field-file.dat").get_size() != 0 || MappedFieldFile("field-file.dat").ok()) {
+    printf("FAIL: accepted a file that isn't a field file\n");
+    errorcode++;
+  }
+  if (load_field("no-such-field-file.dat").get_size() != 0) {
+    printf("FAIL: accepted a missing file\n");
+    errorcode++;
+  }
+  remove("field-file.dat");
+
+  if (errorcode == 0) printf("%s passes!\n", argv[0]);
+  return errorcode;
+}
@@ -0,0 +1,103 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This test checks that field arithmetic gives the same answers no
+// matter how many threads it uses, and that sums are reproducible bit
+// for bit.
+
+#include <stdio.h>
+#include <math.h>
+#include "new/Vector.h"
+
+const long N = 300001; // not a multiple of the block size
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+
+  Vector a(N), b(N);
+  for (long i=0; i<N; i++) {
+    a[i] = sin(0.001*i) + 1e-9*i;
+    b[i] = 2 + cos(0.0037*i);
+  }
+
+  // integrand is like the lambdas in the generated integrals (see
+  // sum_of), which work out a position from the index.
+  const auto integrand = [&](long i) {
+    int _z = i % 50;
+    const int _n = (i-_z)/50;
+    if (_z > 25) _z -= 50;
+    return a[i]*b[i] + 1e-3*_z*_n;
+  };
+
+  set_field_threads(1);
+  const double sum1 = a.sum(), dot1 = a.dot(b), norm1 = a.norm();
+  const double integral1 = sum_of(N, integrand);
+  const double esum1 = (a - 3*b).sum(), enorm1 = (a + b).norm();
+  Vector serial(N);
+  serial = exp(a) + log(b) - pow(b, 1.5)/2;
+  for (long i=0; i<N; i++) {
+    const double expected = exp(a[i]) + log(b[i]) - pow(b[i], 1.5)/2;
+    if (fabs(serial[i] - expected) > 1e-14*fabs(expected)) {
+      printf("FAIL: exp(a) + log(b) - pow(b, 1.5)/2 gives %.17g rather than %.17g at %ld\n",
+             serial[i], expected, i);
+      errorcode++;
+      break;
+    }
+  }
+  double expected_sum = 0;
+  for (long i=0; i<N; i++) expected_sum += a[i];
+  if (fabs(sum1 - expected_sum) > 1e-12*fabs(expected_sum)) {
+    printf("FAIL: sum is %.17g rather than %.17g\n", sum1, expected_sum);
+    errorcode++;
+  }
+  if (fabs(sum_of(N, [&](long i) { return a[i]; }) - sum1) > 1e-12*fabs(sum1)) {
+    printf("FAIL: sum_of differs from sum\n");
+    errorcode++;
+  }
+
+  for (int threads=2; threads<=5; threads++) {
+    set_field_threads(threads);
+    if (a.sum() != sum1 || a.dot(b) != dot1 || a.norm() != norm1 ||
+        (a - 3*b).sum() != esum1 || (a + b).norm() != enorm1 ||
+        sum_of(N, integrand) != integral1) {
+      printf("FAIL: reductions with %d threads differ from those with one\n", threads);
+      errorcode++;
+    }
+    Vector parallel(N);
+    parallel = exp(a) + log(b) - pow(b, 1.5)/2;
+    parallel -= serial;
+    if (parallel.norm() != 0) {
+      printf("FAIL: elementwise maps with %d threads differ by %g\n", threads, parallel.norm());
+      errorcode++;
+    }
+    Vector c(N);
+    c = a;
+    c *= 2;
+    c += b;
+    c /= 4;
+    for (long i=0; i<N; i++) {
+      if (c[i] != (2*a[i] + b[i])/4) {
+        printf("FAIL: in-place arithmetic with %d threads is wrong at %ld\n", threads, i);
+        errorcode++;
+        break;
+      }
+    }
+  }
+
+  if (errorcode == 0) printf("%s passes!\n", argv[0]);
+  return errorcode;
+}
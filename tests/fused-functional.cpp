@@ -0,0 +1,141 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+#include <stdio.h>
+#include "Functionals.h"
+#include "ContactDensity.h"
+#include "LineMinimizer.h"
+
+int main(int, char **argv) {
+  int errorcode = 0;
+  const double kT = 1e-3;
+  const double R = 2.7;
+
+  Lattice lat(Cartesian(0,5,5), Cartesian(5,0,5), Cartesian(5,5,0));
+  GridDescription gd(lat, 20, 20, 20);
+  Grid density(gd);
+  density = 1e-3*(-0.5*r2(gd)).cwise().exp() + 1e-4*VectorXd::Ones(gd.NxNyNz);
+
+  // A sum of several terms, some of which are compositions, as in the
+  // SAFT functionals.
+  Functional f = IdealGas() + HardSpheresWB(R) + ChemicalPotential(-0.01)
+    + sqr(Gaussian(1.3)) + 0.5*sqr(Identity()) + log(Identity());
+
+  const double e = f.integral(kT, density);
+  Grid g(gd), pg(gd);
+  g.setZero();
+  pg.setZero();
+  f.integralgrad(kT, gd, density, &g, &pg);
+
+  Grid fused_g(gd), fused_pg(gd);
+  fused_g.setZero();
+  fused_pg.setZero();
+  const double fused_e = f.integral_and_grad(kT, gd, density, &fused_g, &fused_pg);
+
+  printf("energy %.16g and fused energy %.16g\n", e, fused_e);
+  if (fused_e != e) {
+    printf("FAIL: the fused energy differs by %g\n", fused_e - e);
+    errorcode++;
+  }
+  if (fused_g != g) {
+    printf("FAIL: the fused gradient differs by %g\n", (fused_g - g).cwise().abs().maxCoeff());
+    errorcode++;
+  }
+  if (fused_pg != pg) {
+    printf("FAIL: the fused pgrad differs by %g\n", (fused_pg - pg).cwise().abs().maxCoeff());
+    errorcode++;
+  }
+
+  // A composition whose outer functional is a sum of several terms
+  // (one of them itself a composition) must add up the energies of
+  // those terms in the same order as integral() does.
+  Functional outer = sqr(Gaussian(0.7)) + 0.37*log(Identity()) + 3.1*Identity();
+  Functional composed = outer(Gaussian(1.3)) + IdealGas();
+  Grid cg(gd), fused_cg(gd);
+  cg.setZero();
+  fused_cg.setZero();
+  const double ce = composed.integral(kT, density);
+  composed.integralgrad(kT, gd, density, &cg);
+  const double fused_ce = composed.integral_and_grad(kT, gd, density, &fused_cg);
+  if (fused_ce != ce || fused_cg != cg) {
+    printf("FAIL: the fused composition differs by %g in energy and %g in gradient\n",
+           fused_ce - ce, (fused_cg - cg).cwise().abs().maxCoeff());
+    errorcode++;
+  }
+
+  // A sum of terms like those of SaftFluidSlow: hard spheres, the ideal
+  // gas, and an association free energy built of products, quotients
+  // and square roots of weighted densities, with a chemical potential.
+  {
+    const double kappa = 0.0286, epsilon = 0.0049, mykT = 1e-3;
+    const Functional n0R = n0(R);
+    const Functional delta = (kappa*(exp(epsilon/mykT) - 1))*YuWuCorrelation_S(R);
+    const Functional X = (sqrt(Functional(1) + 8*n0R*delta) - Functional(1))/(4*n0R*delta);
+    const Functional saft = HardSpheresWB(R) + IdealGas() + ChemicalPotential(-0.01)
+      + (4*mykT)*n0R*(log(X) - 0.5*X + Functional(0.5));
+    Grid sg(gd), spg(gd), fused_sg(gd), fused_spg(gd);
+    sg.setZero();
+    spg.setZero();
+    fused_sg.setZero();
+    fused_spg.setZero();
+    const double se = saft.integral(mykT, density);
+    saft.integralgrad(mykT, gd, density, &sg, &spg);
+    const double fused_se = saft.integral_and_grad(mykT, gd, density, &fused_sg, &fused_spg);
+    printf("SAFT-like energy %.16g and fused energy %.16g\n", se, fused_se);
+    if (fused_se != se || fused_sg != sg || fused_spg != spg) {
+      printf("FAIL: the fused SAFT-like sum differs by %g in energy, %g in gradient and %g in pgrad\n",
+             fused_se - se, (fused_sg - sg).cwise().abs().maxCoeff(),
+             (fused_spg - spg).cwise().abs().maxCoeff());
+      errorcode++;
+    }
+  }
+
+  // A minimizer computes its energy along with its gradient, but must
+  // not return that energy once x has changed.
+  {
+    Grid x(density);
+    Minimizer min = ConjugateGradient(f, gd, kT, &x, QuadraticLineMinimizer);
+    min.grad();
+    if (min.energy() != f.integral(kT, x)) {
+      printf("FAIL: the energy computed with the gradient is %.16g rather than %.16g\n",
+             min.energy(), f.integral(kT, x));
+      errorcode++;
+    }
+    x *= 1.1;
+    if (min.energy() != f.integral(kT, x)) {
+      printf("FAIL: the energy is stale after x changed: %.16g rather than %.16g\n",
+             min.energy(), f.integral(kT, x));
+      errorcode++;
+    }
+  }
+
+  // Adding up the terms of the field into one buffer should give the
+  // same field as adding each term to the sum of those after it.
+  std::vector<const Functional *> terms;
+  for (const Functional *term = &f; term; term = term->next()) terms.push_back(term);
+  VectorXd expected = terms.back()->justMe(gd, kT, density);
+  for (int j=int(terms.size())-2; j>=0; j--) {
+    expected = terms[j]->justMe(gd, kT, density) + expected;
+  }
+  if (f(kT, density) != expected) {
+    printf("FAIL: the summed field differs by %g\n",
+           (f(kT, density) - expected).cwise().abs().maxCoeff());
+    errorcode++;
+  }
+
+  if (errorcode == 0) printf("%s passes!\n", argv[0]);
+  return errorcode;
+}
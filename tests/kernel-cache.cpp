@@ -0,0 +1,114 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+
+#include <stdio.h>
+#include "Grid.h"
+#include "ReciprocalGrid.h"
+#include "KernelCache.h"
+#include "Functionals.h"
+
+int check_same(const char *name, const Grid &a, const Grid &b) {
+  int errors = 0;
+  for (int i=0; i<a.rows(); i++) {
+    if (a[i] != b[i]) errors++;
+  }
+  if (errors) printf("FAIL: %s differs at %d points\n", name, errors);
+  return errors;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  const double kT = 1e-3;
+  Lattice lat(Cartesian(0,.5,.5), Cartesian(.5,0,.5), Cartesian(.5,.5,0));
+  const int resolution = 16;
+  GridDescription gd(lat, resolution, resolution, resolution);
+  Grid foo(gd);
+  foo = (-30*r2(gd)).cwise().exp();
+
+  int errorcode = 0;
+  // The convolution should match one done by hand, with the kernel
+  // evaluated directly.
+  Grid expected(gd);
+  {
+    ReciprocalGrid recip = foo.fft();
+    recip.cwise() *= Eigen::CwiseNullaryOp<step_op<complex>, VectorXcd>(gd.NxNyNzOver2, 1,
+                                                                       step_op<complex>(gd, 0.1));
+    expected = recip.ifft();
+  }
+  Grid bar(gd);
+  bar = StepConvolve(0.1)(kT, foo);
+  errorcode += check_same("first StepConvolve", bar, expected);
+  KernelCacheStats s = kernel_cache_stats();
+  if (s.misses != 1 || s.kernels != 1) {
+    printf("FAIL: expected to compute and cache one kernel, not %ld and %ld\n",
+           s.misses, s.kernels);
+    errorcode++;
+  }
+
+  // Repeating it should reuse the kernel, and give the same answer.
+  const int num_convolutions = 5;
+  for (int i=0; i<num_convolutions; i++) {
+    bar = StepConvolve(0.1)(kT, foo);
+    errorcode += check_same("cached StepConvolve", bar, expected);
+  }
+  s = kernel_cache_stats();
+  print_kernel_cache_stats();
+  if (s.hits != num_convolutions || s.misses != 1) {
+    printf("FAIL: expected %d hits and one miss, not %ld and %ld\n",
+           num_convolutions, s.hits, s.misses);
+    errorcode++;
+  }
+
+  // A different radius, kernel or grid is a different kernel.
+  bar = StepConvolve(0.2)(kT, foo);
+  bar = ShellConvolve(0.1)(kT, foo);
+  bar = Gaussian(0.1)(kT, foo);
+  GridDescription gd2(lat, resolution/2, resolution/2, resolution/2);
+  Grid small(gd2);
+  small = (-30*r2(gd2)).cwise().exp();
+  small = StepConvolve(0.1)(kT, small);
+  s = kernel_cache_stats();
+  print_kernel_cache_stats();
+  if (s.misses != 5 || s.kernels != 5) {
+    printf("FAIL: expected five distinct kernels, not %ld (with %ld misses)\n",
+           s.kernels, s.misses);
+    errorcode++;
+  }
+
+  // Shrinking the limit should forget the least recently used
+  // kernels, without changing any answers.
+  const long kernel_bytes = gd.NxNyNzOver2*sizeof(complex);
+  set_kernel_cache_limit(2*kernel_bytes);
+  s = kernel_cache_stats();
+  print_kernel_cache_stats();
+  if (s.bytes > 2*kernel_bytes || s.evictions == 0) {
+    printf("FAIL: we use %ld bytes after %ld evictions\n", s.bytes, s.evictions);
+    errorcode++;
+  }
+  bar = StepConvolve(0.1)(kT, foo);
+  errorcode += check_same("StepConvolve after eviction", bar, expected);
+  set_kernel_cache_limit(0);
+  bar = StepConvolve(0.1)(kT, foo);
+  errorcode += check_same("uncached StepConvolve", bar, expected);
+  if (kernel_cache_stats().kernels != 0) {
+    printf("FAIL: we still hold %ld kernels with no room\n", kernel_cache_stats().kernels);
+    errorcode++;
+  }
+
+  forget_kernels();
+  return errorcode;
+}
@@ -205,6 +205,10 @@ int main(int, char **argv) {
   // want to test CPU time if we have timings for this particular
   // machine).
   gethostname(hn, 80);
+  // The peak memory we check is that of the functionals themselves, so
+  // we don't let the convolution memo (see tests/convolution-memo.cpp)
+  // hold on to any fields.
+  set_convolution_memo_limit(0);
 
   const double kT = hughes_water_prop.kT; // room temperature in Hartree
   const double eta_one = 3.0/(4*M_PI*R*R*R);
@@ -0,0 +1,121 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This test checks that the FFT precision asked for by a Minimize
+// applies to its own energy and gradient evaluations, and to nothing
+// else: not to FFTs done between its steps, and not to another
+// minimization going on at the same time.
+
+#include <stdio.h>
+#include <math.h>
+#include "new/Minimize.h"
+#include "FFTPrecision.h"
+
+const int N = 8;
+
+// Quadratic is E = 1/2 n*H*n - b*n, where H is applied with FFTs, so
+// that its energy and gradient depend on the FFT precision.  It counts
+// the evaluations done in each precision.
+class Quadratic : public NewFunctional {
+public:
+  Quadratic() : single_evals(0), double_evals(0), last_was_single(false) {
+    data = Vector(N*N*N);
+    data = 0.0;
+  }
+  double energy() const {
+    count();
+    return 0.5*data.dot(apply_H(data)) - source().dot(data);
+  }
+  Vector grad() const {
+    count();
+    return apply_H(data) - source();
+  }
+  void printme(const char *prefix) const {
+    printf("%sQuadratic on a %d^3 grid\n", prefix, N);
+  }
+  mutable int single_evals, double_evals;
+  mutable bool last_was_single;
+private:
+  void count() const {
+    last_was_single = fft_single_precision();
+    if (last_was_single) single_evals++;
+    else double_evals++;
+  }
+  static Vector apply_H(const Vector &x) {
+    ComplexVector k = fft(N, N, N, 1.0, x);
+    for (int i=0; i<k.get_size(); i++) k[i] *= 2.0 + 0.1*(i % 7);
+    return ifft(N, N, N, 1.0, k);
+  }
+  static Vector source() {
+    Vector b(N*N*N);
+    for (int i=0; i<N*N*N; i++) b[i] = sin(i);
+    return b;
+  }
+};
+
+int check_double(const char *when) {
+  if (fft_single_precision()) {
+    printf("FAIL: our FFTs are left in single precision %s\n", when);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+
+  // We step two minimizations in turn, only one of which asks for
+  // single precision.
+  Quadratic qsingle, qdouble;
+  Minimize msingle(&qsingle), mdouble(&qdouble);
+  msingle.set_single_precision_until(1e-6);
+  for (int i=0; i<3; i++) {
+    msingle.improve_energy();
+    errorcode += check_double("between steps");
+    mdouble.improve_energy();
+  }
+  if (qdouble.single_evals) {
+    printf("FAIL: %d evaluations of the double-precision minimization were in single precision\n",
+           qdouble.single_evals);
+    errorcode++;
+  }
+#ifdef DEFT_FFT_SINGLE
+  if (qsingle.single_evals == 0) {
+    printf("FAIL: we never evaluated in single precision\n");
+    errorcode++;
+  }
+#else
+  if (qsingle.single_evals) {
+    printf("FAIL: we evaluated in single precision without DEFT_FFT_SINGLE\n");
+    errorcode++;
+  }
+#endif
+
+  // Once it gets going again, the minimization should finish in
+  // double precision.
+  msingle.set_precision(1e-14);
+  msingle.set_relative_precision(0);
+  while (msingle.improve_energy()) {}
+  errorcode += check_double("after a minimization");
+  if (qsingle.last_was_single) {
+    printf("FAIL: the minimization didn't finish in double precision\n");
+    errorcode++;
+  }
+
+  if (errorcode == 0) printf("%s passes!\n", argv[0]);
+  return errorcode;
+}
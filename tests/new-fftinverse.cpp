@@ -40,5 +40,45 @@ int main(int, char *argv[]) {
       errorcode += 1;
     }
   }
+
+  // Now check that a batched inverse transform gives the same answer,
+  // including when an input is repeated.
+  ComplexVector ks2 = fft(Nx, Ny, Nz, dV, 2*rs);
+  Vector a, b(NxNyNz), c;
+  const ComplexVector *ins[] = { &ks, &ks2, &ks };
+  Vector *outs[] = { &a, &b, &c };
+  ifft_many(Nx, Ny, Nz, dV, 3, ins, outs);
+  c[0] += 1; // this mustn't change a, even though it has the same input
+  for (int i=0;i<NxNyNz;i++) {
+    double e = fabs(a[i] - rs_again[i]) + fabs(b[i] - 2*rs_again[i])
+      + fabs(c[i] - rs_again[i] - (i == 0));
+    if (e > 1e-14) {
+      printf("Batched error of %g\n", e);
+      errorcode += 1;
+    }
+  }
+
+  // More fields than we transform at once are done in several batches.
+  const int K = 9;
+  std::vector<ComplexVector> many(K);
+  std::vector<Vector> many_out(K);
+  const ComplexVector *many_ins[K];
+  Vector *many_outs[K];
+  for (int j=0; j<K; j++) {
+    many[j] = fft(Nx, Ny, Nz, dV, (j+1)*rs);
+    many_ins[j] = &many[j];
+    many_outs[j] = &many_out[j];
+  }
+  ifft_many(Nx, Ny, Nz, dV, K, many_ins, many_outs);
+  for (int j=0; j<K; j++) {
+    for (int i=0;i<NxNyNz;i++) {
+      const double e = fabs(many_out[j][i] - (j+1)*rs_again[i]);
+      if (e > 1e-13) {
+        printf("Error of %g in field %d of %d\n", e, j, K);
+        errorcode += 1;
+        break;
+      }
+    }
+  }
   return errorcode;
 }
@@ -66,6 +66,37 @@ int main(int, char **argv) {
   printf("n2 = %g\n", wb.get_n2()[0]);
   printf("n3 = %g\n", wb.get_n3()[0]);
 
+  // The generated code performs the inverse ffts of the weighted
+  // densities together with ifft_many, so check that each of them
+  // comes out as the right one for a density that isn't uniform.  n0
+  // and n1 are each n2 over a constant, and the total of n3 or n2 is
+  // that of n times the volume or area of a sphere.
+  for (int i=0;i<Nx*Nx*Nx;i++) wb.n()[i] = nval*(1 + 0.5*sin(0.37*i));
+  {
+    const Vector n0 = wb.get_n0(), n1 = wb.get_n1(), n2 = wb.get_n2(), n3 = wb.get_n3();
+    double n0err = 0, n1err = 0, ntot = 0, n2tot = 0, n3tot = 0;
+    for (int i=0;i<Nx*Nx*Nx;i++) {
+      n0err = fmax(n0err, fabs(n0[i] - n2[i]/(4*M_PI*R*R)));
+      n1err = fmax(n1err, fabs(n1[i] - n2[i]/(4*M_PI*R)));
+      ntot += wb.n()[i];
+      n2tot += n2[i];
+      n3tot += n3[i];
+    }
+    printf("n0 error %g, n1 error %g\n", n0err, n1err);
+    if (n0err > 1e-13 || n1err > 1e-13) {
+      printf("FAIL: n0 or n1 is not proportional to n2\n");
+      retval++;
+    }
+    if (fabs(n2tot/(4*M_PI*R*R*ntot) - 1) > 1e-13) {
+      printf("FAIL: the total of n2 is off by %g\n", n2tot/(4*M_PI*R*R*ntot) - 1);
+      retval++;
+    }
+    if (fabs(n3tot/(4*M_PI/3*R*R*R*ntot) - 1) > 1e-13) {
+      printf("FAIL: the total of n3 is off by %g\n", n3tot/(4*M_PI/3*R*R*R*ntot) - 1);
+      retval++;
+    }
+  }
+
   for (int i=0;i<Nx*Nx*Nx/2;i++) wb.n()[i] = 0.1*nval;
   //FIXME:  the following test OUGHT to pass, but currently fails.  :(
   //retval += wb.run_finite_difference_test("WhiteBear");
@@ -0,0 +1,89 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+
+#include <stdio.h>
+#include "new/WhiteBearFluidVeffFast.h"
+#include "new/WhiteBearFluidVeffPlanarFast.h"
+
+// A planar functional should give the same energy per area as the
+// same functional on a 3D grid, for a density that only varies in z,
+// whatever area we give its cell.
+
+static int retval = 0;
+
+static void assert_same(const char *str, double a, double b, double epsilon) {
+  if (2*fabs(a-b)/fabs(a+b) > epsilon) {
+    printf("FAIL: %s differ by %g (%g fractionally)  [%.15g vs %.15g]\n",
+           str, a-b, 2*(a-b)/(a+b), a, b);
+    retval++;
+  } else {
+    printf("PASS: %s are same (%g fractional difference)\n", str, 2*(a-b)/(a+b));
+  }
+}
+
+template <typename Functional>
+static void set_up(Functional *f, double kT, double nb, double Lz) {
+  f->R() = 0.5;
+  f->kT() = kT;
+  f->mu() = 0;
+  f->Vext() = 0;
+  const Vector rz = f->get_rz();
+  for (int i=0; i<rz.get_size(); i++) {
+    f->Veff()[i] = -kT*log(nb*(1 + 0.3*cos(2*M_PI*rz[i]/Lz)));
+  }
+}
+
+int main(int, char **argv) {
+  const double dx = 0.0625, Lz = 4, kT = 1, nb = 0.6; // so Lz/dx is exact
+  const double ax = 1.3, ay = 0.7; // any area will do
+
+  WhiteBearFluidVeff bulk(2*dx, 2*dx, Lz, dx);
+  WhiteBearFluidVeffPlanar planar(ax, ay, Lz, dx);
+  set_up(&bulk, kT, nb, Lz);
+  set_up(&planar, kT, nb, Lz);
+  if (bulk.Nx() != 2 || bulk.Ny() != 2 || planar.Nx() != 1 || planar.Ny() != 1
+      || bulk.Nz() != planar.Nz()) {
+    printf("FAIL: the grids are %ld x %ld x %ld and %ld x %ld x %ld\n",
+           long(bulk.Nx()), long(bulk.Ny()), long(bulk.Nz()),
+           long(planar.Nx()), long(planar.Ny()), long(planar.Nz()));
+    return 1;
+  }
+  const long Nz = planar.Nz();
+
+  assert_same("energies per area", bulk.energy()/(4*dx*dx), planar.energy()/(ax*ay), 1e-12);
+
+  // The gradient of the planar functional with respect to Veff at one
+  // z is that of the bulk one with respect to Veff at every point in
+  // that plane.
+  const Vector bulk_grad = bulk.grad(), planar_grad = planar.grad();
+  Vector summed(Nz);
+  summed = 0;
+  for (long i=0; i<4*Nz; i++) summed[i % Nz] += bulk_grad[i];
+  double worst = 0, biggest = 0;
+  for (long i=0; i<Nz; i++) {
+    worst = fmax(worst, fabs(summed[i]/(4*dx*dx) - planar_grad[i]/(ax*ay)));
+    biggest = fmax(biggest, fabs(planar_grad[i]/(ax*ay)));
+  }
+  printf("gradient differs by %g out of %g\n", worst, biggest);
+  if (worst > 1e-12*biggest) {
+    printf("FAIL: the gradients per area differ\n");
+    retval++;
+  }
+
+  if (retval == 0) printf("%s passes!\n", argv[0]);
+  return retval;
+}
@@ -0,0 +1,118 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+
+#include <stdio.h>
+#include "Grid.h"
+
+double bumpy(Cartesian r) {
+  const double rr = r.norm();
+  return exp(-rr*rr) + 0.3*cos(4*rr) + 0.1*r(0);
+}
+
+// brute_force_projection is the original ShellProjection, which visits
+// every grid point for every radius.
+void brute_force_projection(const Grid &g, const GridDescription &gd,
+                            const VectorXd &R, VectorXd *output) {
+  output->setZero();
+  VectorXd norm(*output);
+  const double wid = 0.5*pow(gd.fineLat.volume(), 1.0/3);
+  const double oowid2 = 1/(wid*wid);
+  for (int x=0; x<gd.Nx; x++) {
+    for (int y=0; y<gd.Ny; y++) {
+      for (int z=0; z<gd.Nz; z++) {
+        Cartesian h(gd.Lat.wignerSeitz(gd.Lat.toCartesian(Relative(x*gd.dx,y*gd.dy,z*gd.dz))));
+        double r = h.norm();
+        for (int ir=0;ir<R.rows();ir++) {
+          double dr = fabs(r-R[ir]);
+          if (dr < 3*wid) {
+            double w = exp(-oowid2*dr*dr);
+            norm[ir] += w;
+            (*output)[ir] += w*g(x,y,z);
+          }
+        }
+      }
+    }
+  }
+  output->cwise() /= norm;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  Lattice lat(Cartesian(0,3,3), Cartesian(3,0,3), Cartesian(3,3,0));
+  GridDescription gd(lat, 30, 30, 30);
+  Grid g(gd);
+  g.Set(bumpy);
+
+  int errorcode = 0;
+  const double dr = 0.05;
+  VectorXd R(60), fast(60), slow(60);
+  for (int i=0; i<R.rows(); i++) R[i] = i*dr;
+  g.ShellProjection(R, &fast);
+  brute_force_projection(g, gd, R, &slow);
+  double maxerr = 0;
+  for (int i=0; i<R.rows(); i++) {
+    const double err = fabs(fast[i] - slow[i]);
+    if (err > maxerr) maxerr = err;
+    if (err > 1e-3) {
+      printf("FAIL: ShellProjection at %g is %.10g rather than %.10g\n", R[i], fast[i], slow[i]);
+      errorcode++;
+    }
+  }
+  printf("ShellProjection differs from the brute-force sum by at most %g\n", maxerr);
+
+  // Without smoothing, RadialAverage is just the mean over each shell.
+  VectorXd avg;
+  g.RadialAverage(0.2, &avg);
+  VectorXd sums(avg.rows()), counts(avg.rows());
+  sums.setZero();
+  counts.setZero();
+  for (int x=0; x<gd.Nx; x++) {
+    for (int y=0; y<gd.Ny; y++) {
+      for (int z=0; z<gd.Nz; z++) {
+        Cartesian h(gd.Lat.wignerSeitz(gd.Lat.toCartesian(Relative(x*gd.dx,y*gd.dy,z*gd.dz))));
+        const int bin = int(h.norm()/0.2);
+        if (bin >= avg.rows()) {
+          printf("FAIL: RadialAverage stops short of %g\n", h.norm());
+          return errorcode + 1;
+        }
+        sums[bin] += g(x,y,z);
+        counts[bin] += 1;
+      }
+    }
+  }
+  for (int i=0; i<avg.rows(); i++) {
+    const double expected = counts[i] ? sums[i]/counts[i] : 0;
+    if (fabs(avg[i] - expected) > 1e-12) {
+      printf("FAIL: RadialAverage of shell %d is %g rather than %g\n", i, avg[i], expected);
+      errorcode++;
+    }
+  }
+
+  // With smoothing, it matches ShellProjection at the shell centers.
+  const double wid = 0.5*pow(gd.fineLat.volume(), 1.0/3);
+  g.RadialAverage(dr, &avg, wid);
+  for (int i=0; i<R.rows(); i++) R[i] = (i + 0.5)*dr;
+  brute_force_projection(g, gd, R, &slow);
+  for (int i=0; i<R.rows(); i++) {
+    if (fabs(avg[i] - slow[i]) > 1e-3) {
+      printf("FAIL: smoothed RadialAverage at %g is %.10g rather than %.10g\n",
+             R[i], avg[i], slow[i]);
+      errorcode++;
+    }
+  }
+  return errorcode;
+}
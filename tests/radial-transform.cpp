@@ -0,0 +1,99 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This test checks the radial transforms against the analytic
+// transforms of a gaussian and of its gradient, and checks that
+// convolving two gaussians gives the expected gaussian.
+
+#include <stdio.h>
+#include <math.h>
+#include "new/RadialTransform.h"
+
+const long Nr = 1000;
+const double dr = 0.01;
+
+// gaussian returns exp(-x^2/(2 sigma^2)), normalized in 3D.
+Vector gaussian(const Vector &x, double sigma) {
+  Vector out(x.get_size());
+  for (long i=0; i<x.get_size(); i++) {
+    out[i] = exp(-x[i]*x[i]/(2*sigma*sigma))/pow(2*M_PI*sigma*sigma, 1.5);
+  }
+  return out;
+}
+
+int check(const char *name, const Vector &a, const Vector &b, double fraction) {
+  double err = 0, biggest = 0;
+  for (long i=0; i<b.get_size(); i++) {
+    err = fmax(err, fabs(a[i] - b[i]));
+    biggest = fmax(biggest, fabs(b[i]));
+  }
+  printf("%s: relative error %g\n", name, err/biggest);
+  if (!(err <= fraction*biggest)) {
+    printf("FAIL: expected %s to have a relative error under %g\n", name, fraction);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+
+  const Vector r = radial_r(Nr, dr), k = radial_k(Nr, dr);
+  const double sigma = 0.7;
+  const Vector g = gaussian(r, sigma);
+
+  {
+    // A normalized gaussian transforms to exp(-k^2 sigma^2/2).
+    Vector expected(Nr);
+    for (long j=0; j<Nr; j++) expected[j] = exp(-k[j]*k[j]*sigma*sigma/2);
+    const Vector gk = radial_fft(dr, g);
+    errorcode += check("radial_fft of gaussian", gk, expected, 1e-12);
+    errorcode += check("radial_ifft of radial_fft", radial_ifft(dr, gk), g, 1e-12);
+  }
+
+  {
+    // The gradient of g has radial component -r g/sigma^2, and should
+    // transform to k times the transform of g.
+    Vector v(Nr), expected(Nr);
+    for (long i=0; i<Nr; i++) v[i] = -r[i]*g[i]/(sigma*sigma);
+    for (long j=0; j<Nr; j++) expected[j] = k[j]*exp(-k[j]*k[j]*sigma*sigma/2);
+    const Vector vk = radial_vector_fft(dr, v);
+    errorcode += check("radial_vector_fft of gradient", vk, expected, 1e-12);
+    errorcode += check("radial_vector_ifft of radial_vector_fft",
+                       radial_vector_ifft(dr, vk), v, 1e-11);
+    // The divergence of the gradient, computed in reciprocal space,
+    // should match the laplacian of g.
+    Vector laplacian(Nr);
+    for (long i=0; i<Nr; i++) {
+      laplacian[i] = (r[i]*r[i]/(sigma*sigma) - 3)*g[i]/(sigma*sigma);
+    }
+    Vector divk(Nr);
+    for (long j=0; j<Nr; j++) divk[j] = -k[j]*vk[j];
+    errorcode += check("divergence of gradient", radial_ifft(dr, divk), laplacian, 1e-10);
+  }
+
+  {
+    // Gaussians convolve to a gaussian with the sum of the variances.
+    const double sigma2 = 0.4;
+    const Vector a = radial_fft(dr, g), b = radial_fft(dr, gaussian(r, sigma2));
+    Vector ab(Nr);
+    for (long j=0; j<Nr; j++) ab[j] = a[j]*b[j];
+    errorcode += check("convolution of gaussians", radial_ifft(dr, ab),
+                       gaussian(r, sqrt(sigma*sigma + sigma2*sigma2)), 1e-12);
+  }
+  return errorcode;
+}
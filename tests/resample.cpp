@@ -0,0 +1,104 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+
+#include <stdio.h>
+#include "Grid.h"
+#include "new/Vector.h"
+
+// A smooth periodic field, as a function of relative coordinates, with
+// modes well below the Nyquist frequency of the grids we use.
+double smooth(double x, double y, double z) {
+  return 1 + cos(2*M_PI*(x + 2*y)) + 0.5*sin(2*M_PI*(3*z - y)) + 0.25*cos(2*M_PI*(2*x - z));
+}
+
+int check(const char *name, double got, double expected, double tolerance) {
+  if (fabs(got - expected) > tolerance) {
+    printf("FAIL: %s gives %.15g rather than %.15g\n", name, got, expected);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+
+  Lattice lat(Cartesian(0,2,2), Cartesian(2,0,2), Cartesian(2,2,0));
+  GridDescription coarse(lat, 12, 10, 12), fine(lat, 20, 16, 26);
+  Grid g(coarse);
+  for (int x=0; x<coarse.Nx; x++) {
+    for (int y=0; y<coarse.Ny; y++) {
+      for (int z=0; z<coarse.Nz; z++) g(x,y,z) = smooth(x*coarse.dx, y*coarse.dy, z*coarse.dz);
+    }
+  }
+
+  // Refining and then coarsening a band-limited field is exact.
+  const Grid g2 = g.Resample(fine);
+  for (int x=0; x<fine.Nx; x++) {
+    for (int y=0; y<fine.Ny; y++) {
+      for (int z=0; z<fine.Nz; z++) {
+        errorcode += check("Grid::Resample", g2(x,y,z),
+                           smooth(x*fine.dx, y*fine.dy, z*fine.dz), 1e-12);
+      }
+    }
+  }
+  const Grid g3 = g2.Resample(coarse);
+  for (int i=0; i<coarse.NxNyNz; i++) errorcode += check("coarsening", g3[i], g[i], 1e-12);
+
+  // Batched interpolation agrees with interpolating one point at a
+  // time, including outside the cell, and is exact at grid points.
+  const int npoints = 50;
+  VectorXd rx(npoints), ry(npoints), rz(npoints);
+  for (int i=0; i<npoints; i++) {
+    rx[i] = 0.37*i - 5.1;
+    ry[i] = 0.1*(i % 7) + 0.013*i;
+    rz[i] = -0.29*i + 3.3;
+  }
+  rx[0] = 2*coarse.dx; ry[0] = 3*coarse.dy; rz[0] = -coarse.dz;
+  const VectorXd values = g.Interpolate(rx, ry, rz);
+  for (int i=0; i<npoints; i++) {
+    errorcode += check("Grid::Interpolate", values[i], g(Relative(rx[i], ry[i], rz[i])), 0);
+  }
+  errorcode += check("Interpolate at a grid point", values[0], g(2, 3, coarse.Nz-1), 1e-14);
+
+  // The same for the new Vector.
+  const long Nx = 12, Ny = 10, Nz = 12, Mx = 20, My = 16, Mz = 26;
+  Vector v(Nx*Ny*Nz);
+  for (long i=0; i<Nx*Ny*Nz; i++) {
+    v[i] = smooth(double(i/(Ny*Nz))/Nx, double((i/Nz) % Ny)/Ny, double(i % Nz)/Nz);
+  }
+  const Vector v2 = resample(Nx, Ny, Nz, v, Mx, My, Mz);
+  for (long i=0; i<Mx*My*Mz; i++) {
+    errorcode += check("resample", v2[i],
+                       smooth(double(i/(My*Mz))/Mx, double((i/Mz) % My)/My, double(i % Mz)/Mz),
+                       1e-12);
+  }
+  const Vector v3 = resample(Mx, My, Mz, v2, Nx, Ny, Nz);
+  for (long i=0; i<Nx*Ny*Nz; i++) errorcode += check("coarsening a Vector", v3[i], v[i], 1e-12);
+
+  Vector x(npoints), y(npoints), z(npoints);
+  for (int i=0; i<npoints; i++) {
+    x[i] = rx[i];
+    y[i] = ry[i];
+    z[i] = rz[i];
+  }
+  const Vector vi = interpolate(Nx, Ny, Nz, v, x, y, z);
+  for (int i=0; i<npoints; i++) errorcode += check("interpolate", vi[i], values[i], 1e-14);
+
+  if (errorcode == 0) printf("All resampling tests pass!\n");
+  return errorcode;
+}
@@ -0,0 +1,140 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This test checks that the lazy arithmetic on Vector and
+// ComplexVector gives the same answers as computing one operation at
+// a time, and that it doesn't allocate temporary arrays.
+
+#include <stdio.h>
+#include <math.h>
+#include "utilities.h"
+#include "new/Vector.h"
+
+const long N = 10000;
+
+int check(const char *name, double got, double expected) {
+  if (fabs(got - expected) > 1e-13*(1 + fabs(expected))) {
+    printf("FAIL: %s gives %.15g rather than %.15g\n", name, got, expected);
+    return 1;
+  }
+  return 0;
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+
+  Vector a(N), b(N), c(N);
+  for (long i=0; i<N; i++) {
+    a[i] = sin(0.01*i);
+    b[i] = cos(0.03*i) + 2;
+    c[i] = 1e-3*i;
+  }
+
+  {
+    const Vector x = a + 2*b - c/4 + (-a)*3.0 + 1.0;
+    for (long i=0; i<N; i++) {
+      errorcode += check("a + 2*b - c/4 - 3*a + 1", x[i], a[i] + 2*b[i] - c[i]/4 - 3*a[i] + 1);
+    }
+    errorcode += check("sum", (a - b).sum(), a.sum() - b.sum());
+    errorcode += check("dot", a.dot(b + c), a.dot(b) + a.dot(c));
+    errorcode += check("dot of an expression", (b + c).dot(a), a.dot(b) + a.dot(c));
+    Vector amb(N);
+    amb = a - b;
+    errorcode += check("norm", (a - b).norm(), amb.norm());
+  }
+
+  // An empty Vector is zero in a sum.
+  {
+    const Vector empty;
+    const Vector x = empty + a - 2*empty;
+    if (x.get_size() != N) {
+      printf("FAIL: adding an empty Vector changes the size to %ld\n", x.get_size());
+      errorcode++;
+    }
+    for (long i=0; i<N; i++) errorcode += check("empty + a", x[i], a[i]);
+    const Vector y = -(empty + 1.0) + b;
+    for (long i=0; i<N; i++) errorcode += check("-(empty + 1) + b", y[i], b[i]);
+    const Vector z = empty*3.0;
+    if (z.get_size() != 0) {
+      printf("FAIL: an empty Vector times 3 has size %ld\n", z.get_size());
+      errorcode++;
+    }
+  }
+
+  // Updating a Vector in terms of itself, as conjugate gradient does.
+  {
+    Vector d(N);
+    d = c;
+    const double beta = 0.3;
+    d = -a + beta*d;
+    for (long i=0; i<N; i++) errorcode += check("d = -a + beta*d", d[i], -a[i] + beta*c[i]);
+    d += 2*a;
+    for (long i=0; i<N; i++) errorcode += check("d += 2*a", d[i], a[i] + beta*c[i]);
+  }
+
+  // Operands that overlap the target at another offset are read as
+  // they were before the assignment.
+  {
+    Vector v(N);
+    v = a;
+    Vector head = v.slice(0, N-1), tail = v.slice(1, N-1);
+    head = tail + head;
+    for (long i=0; i<N-1; i++) errorcode += check("overlapping slices", v[i], a[i+1] + a[i]);
+    errorcode += check("last element", v[N-1], a[N-1]);
+  }
+
+  // A chain of operations needs no memory beyond its result.
+  {
+    Vector x(N);
+    reset_peak_memory();
+    const long start = current_memory();
+    x = a + 2*b - c/4 + 3*(a - c);
+    x += 0.5*b - c;
+    const double d = x.dot(a - b);
+    const long extra = peak_memory() - start;
+    if (extra > 0) {
+      printf("FAIL: arithmetic used %ld bytes of temporaries\n", extra);
+      errorcode++;
+    }
+    double expected = 0;
+    for (long i=0; i<N; i++) {
+      const double xi = a[i] + 2*b[i] - c[i]/4 + 3*(a[i] - c[i]) + 0.5*b[i] - c[i];
+      errorcode += check("x", x[i], xi);
+      expected += xi*(a[i] - b[i]);
+    }
+    errorcode += check("x.dot(a - b)", d, expected);
+  }
+
+  // The same for ComplexVector.
+  {
+    ComplexVector p(N), q(N);
+    for (long i=0; i<N; i++) {
+      p[i] = std::complex<double>(sin(0.01*i), 1);
+      q[i] = std::complex<double>(2, cos(0.03*i));
+    }
+    const std::complex<double> s(0.5, -2);
+    const ComplexVector r = s*p - q*2.0 + (-p);
+    for (long i=0; i<N; i++) {
+      const std::complex<double> expected = s*p[i] - 2.0*q[i] - p[i];
+      errorcode += check("complex real part", r[i].real(), expected.real());
+      errorcode += check("complex imaginary part", r[i].imag(), expected.imag());
+    }
+  }
+
+  if (errorcode == 0) printf("%s passes!\n", argv[0]);
+  return errorcode;
+}
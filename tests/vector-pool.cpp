@@ -0,0 +1,91 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This test checks that the memory of temporary Vectors and
+// ComplexVectors is recycled through the pool, without changing what
+// peak_memory() reports, and that the pool respects its limit.
+
+#include <stdio.h>
+#include "utilities.h"
+#include "new/Vector.h"
+
+const long N = 10000;
+
+double step(const Vector &a, const Vector &b) {
+  Vector t(N); // a temporary, as in generated code
+  t = 3.0*a + b;
+  return t.sum();
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+
+  Vector a(N), b(N);
+  a = 1.0;
+  b = 2.0;
+  vector_pool().empty();
+
+  reset_peak_memory();
+  const long start = current_memory();
+  double total = 0;
+  for (int i=0; i<10; i++) total += step(a, b);
+  if (total != 10*5.0*N) {
+    printf("FAIL: recycled arrays give the wrong sum %g\n", total);
+    errorcode++;
+  }
+  VectorPoolStats s = vector_pool().stats();
+  print_vector_pool_stats();
+  if (s.misses != 1 || s.hits != 9) {
+    printf("FAIL: expected 1 miss and 9 hits, not %ld and %ld\n", s.misses, s.hits);
+    errorcode++;
+  }
+  if (s.pooled_bytes != long(N*sizeof(double)) || s.peak_pooled_bytes != s.pooled_bytes) {
+    printf("FAIL: the pool should hold exactly one array, not %ld bytes\n", s.pooled_bytes);
+    errorcode++;
+  }
+  if (current_memory() != start || peak_memory() - start != long(N*sizeof(double))) {
+    printf("FAIL: pooled arrays shouldn't count as memory in use\n");
+    errorcode++;
+  }
+
+  {
+    // A ComplexVector of the same number of bytes reuses the same array.
+    ComplexVector c(N/2);
+    c = 0;
+    if (vector_pool().stats().hits != 10) {
+      printf("FAIL: ComplexVector doesn't share the pool with Vector\n");
+      errorcode++;
+    }
+  }
+
+  vector_pool().set_limit(N*sizeof(double)/2);
+  if (vector_pool().stats().pooled_bytes != 0) {
+    printf("FAIL: lowering the limit doesn't free pooled arrays\n");
+    errorcode++;
+  }
+  step(a, b);
+  s = vector_pool().stats();
+  if (s.pooled_bytes != 0 || s.misses != 2) {
+    printf("FAIL: the pool holds arrays beyond its limit\n");
+    errorcode++;
+  }
+  vector_pool().set_limit(256*1024*1024);
+  vector_pool().empty();
+
+  if (errorcode == 0) printf("%s passes!\n", argv[0]);
+  return errorcode;
+}
@@ -0,0 +1,124 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+// This test checks that convolving with the wall transforms is the
+// same as an ordinary periodic convolution of the field mirrored at
+// the walls, and that the odd transforms give the z derivative.
+
+#include <stdio.h>
+#include <math.h>
+#include "new/WallTransform.h"
+
+const long Nx = 6, Ny = 4, Nz = 20;
+const double Lx = 3, Ly = 2, Lz = 5;
+const double dV = Lx*Ly*Lz/(Nx*Ny*Nz);
+
+int check(const char *name, const Vector &a, const Vector &b, double fraction) {
+  double err = 0, biggest = 0;
+  for (long i=0; i<b.get_size(); i++) {
+    err = fmax(err, fabs(a[i] - b[i]));
+    biggest = fmax(biggest, fabs(b[i]));
+  }
+  printf("%s: relative error %g\n", name, err/biggest);
+  if (!(err <= fraction*biggest)) {
+    printf("FAIL: expected %s to have a relative error under %g\n", name, fraction);
+    return 1;
+  }
+  return 0;
+}
+
+// kernel is a smooth even function of k, standing in for a weight
+// function.
+double kernel(double kx, double ky, double kz) {
+  return exp(-0.1*(kx*kx + ky*ky + kz*kz));
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+
+  // A field with no particular symmetry, which the wall transforms
+  // treat as mirrored at z = 0 and z = Lz.
+  Vector f(Nx*Ny*Nz), mirrored(Nx*Ny*2*Nz);
+  for (long x=0; x<Nx; x++) {
+    for (long y=0; y<Ny; y++) {
+      for (long z=0; z<Nz; z++) {
+        const double v = exp(-0.1*z)*(1 + 0.3*cos(2*M_PI*x/Nx + 0.5) + 0.2*sin(2*M_PI*y/Ny))
+          + 0.05*((x*7 + y*3 + z*11) % 5);
+        f[(x*Ny + y)*Nz + z] = v;
+        mirrored[(x*Ny + y)*2*Nz + z] = v;
+        mirrored[(x*Ny + y)*2*Nz + 2*Nz-1-z] = v;
+      }
+    }
+  }
+
+  const ComplexVector fk = fft_walls(Nx, Ny, Nz, dV, f);
+  errorcode += check("ifft_walls of fft_walls", ifft_walls(Nx, Ny, Nz, dV, fk), f, 1e-13);
+
+  {
+    ComplexVector wk(fk.get_size()), dzk(fk.get_size()), dxk(fk.get_size());
+    for (long i=0; i<fk.get_size(); i++) {
+      double k[3];
+      walls_k(Nx, Ny, Nz, Lx, Ly, Lz, i, k);
+      wk[i] = kernel(k[0], k[1], k[2])*fk[i];
+      dzk[i] = -k[2]*wk[i];
+      // The x derivative is ambiguous at the Nyquist frequency, so
+      // we leave it out, here and below.
+      const bool nyquist = i/Nz/(Ny/2+1) == Nx/2;
+      dxk[i] = nyquist ? 0 : std::complex<double>(0, k[0])*wk[i];
+    }
+    const Vector w = ifft_walls(Nx, Ny, Nz, dV, wk);
+    const Vector dwdz = ifft_walls_odd(Nx, Ny, Nz, dV, dzk);
+    const Vector dwdx = ifft_walls(Nx, Ny, Nz, dV, dxk);
+
+    // Do the same convolution and derivatives with the ordinary
+    // periodic transform on the doubled cell.
+    ComplexVector mk = fft(Nx, Ny, 2*Nz, dV, mirrored);
+    ComplexVector mdzk(mk.get_size()), mdxk(mk.get_size());
+    for (long i=0; i<mk.get_size(); i++) {
+      const long z = i % (Nz+1), n = i/(Nz+1);
+      long y = n % Ny, x = n/Ny;
+      if (x > Nx/2) x -= Nx;
+      if (y > Ny/2) y -= Ny;
+      const double kx = 2*M_PI*x/Lx, ky = 2*M_PI*y/Ly, kz = M_PI*z/Lz;
+      mk[i] *= kernel(kx, ky, kz);
+      mdzk[i] = std::complex<double>(0, kz)*mk[i];
+      mdxk[i] = (x == Nx/2) ? 0 : std::complex<double>(0, kx)*mk[i];
+    }
+    const Vector mw = ifft(Nx, Ny, 2*Nz, dV, mk);
+    const Vector mdwdz = ifft(Nx, Ny, 2*Nz, dV, mdzk);
+    const Vector mdwdx = ifft(Nx, Ny, 2*Nz, dV, mdxk);
+    Vector expected(Nx*Ny*Nz), expected_dz(Nx*Ny*Nz), expected_dx(Nx*Ny*Nz);
+    for (long row=0; row<Nx*Ny; row++) {
+      for (long z=0; z<Nz; z++) {
+        expected[row*Nz + z] = mw[row*2*Nz + z];
+        expected_dz[row*Nz + z] = mdwdz[row*2*Nz + z];
+        expected_dx[row*Nz + z] = mdwdx[row*2*Nz + z];
+      }
+    }
+    errorcode += check("mirrored convolution", w, expected, 1e-12);
+    errorcode += check("z derivative of convolution", dwdz, expected_dz, 1e-12);
+    errorcode += check("x derivative of convolution", dwdx, expected_dx, 1e-12);
+
+    // Since the z derivative has no Nyquist term, the odd transforms
+    // should take it there and back again.
+    errorcode += check("ifft_walls_odd of fft_walls_odd",
+                       ifft_walls_odd(Nx, Ny, Nz, dV, fft_walls_odd(Nx, Ny, Nz, dV, dwdz)),
+                       dwdz, 1e-12);
+  }
+  WallWorkspace::release_all();
+  return errorcode;
+}
@@ -0,0 +1,110 @@
+// Deft is a density functional package developed by the research
+// group of Professor David Roundy
+//
+// Copyright 2010 The Deft Authors
+//
+// Deft is free software; you can redistribute it and/or modify it
+// under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or
+// (at your option) any later version.
+//
+// You should have received a copy of the GNU General Public License
+// along with deft; if not, write to the Free Software Foundation,
+// Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+//
+// Please see the file AUTHORS for a list of authors.
+
+
+// This test checks the White Bear fluid between mirror walls: that a
+// uniform fluid at the bulk chemical potential is in equilibrium, that
+// the gradient is the derivative of the energy, and that the contact
+// density at a hard wall is the pressure over kT, as the contact
+// theorem says it should be.
+
+#include <stdio.h>
+#include <math.h>
+#include "new/WallsWhiteBearFluid.h"
+#include "new/Minimize.h"
+
+const double Lz = 10, dz = 0.01;
+const double kT = 1.0, R = 0.5, eta = 0.3;
+
+// bulk_mu returns the chemical potential of the uniform fluid with
+// density n.
+double bulk_mu(double n) {
+  const WhiteBearPhi p = white_bear_phi(R, n*4*M_PI*R*R, n*4*M_PI/3*R*R*R, 0);
+  const double lognQ = 1.5*log(18.01528*1822.8885*kT/(2*M_PI));
+  return kT*(log(n) - lognQ) + kT*(p.d_n2*4*M_PI*R*R + p.d_n3*4*M_PI/3*R*R*R);
+}
+
+int main(int, char *argv[]) {
+  printf("Working on %s\n", argv[0]);
+  int errorcode = 0;
+  const double nb = eta/(4*M_PI/3*R*R*R);
+
+  WallsWhiteBearFluid f(1, 1, Lz, dz);
+  const long Nz = f.Nz();
+  f.R() = R;
+  f.kT() = kT;
+  f.mu() = bulk_mu(nb);
+  f.Veff() = -kT*log(nb);
+
+  {
+    // The uniform fluid should have (nearly) no gradient, and n3 should
+    // be the packing fraction, right up to the walls.
+    const Vector g = f.grad(), n3 = f.get_n3();
+    double worst = 0, worst_n3 = 0;
+    for (long i=0; i<Nz; i++) {
+      worst = fmax(worst, fabs(g[i]/dz));
+      worst_n3 = fmax(worst_n3, fabs(n3[i] - eta));
+    }
+    printf("uniform fluid: gradient per volume %g, n3 error %g\n", worst, worst_n3);
+    if (!(worst < 1e-8 && worst_n3 < 1e-10)) {
+      printf("FAIL: the uniform fluid isn't in equilibrium\n");
+      errorcode++;
+    }
+  }
+
+  // Now we make z = 0 a hard wall, so no sphere can come within R of
+  // it.
+  const Vector z = f.get_z();
+  for (long i=0; i<Nz; i++) {
+    if (z[i] < R) {
+      f.Vext()[i] = 100*kT;
+      f.Veff()[i] = 100*kT;
+    }
+  }
+  {
+    Vector direction(Nz);
+    for (long i=0; i<Nz; i++) direction[i] = exp(-(z[i] - 1.5)*(z[i] - 1.5));
+    errorcode += f.run_finite_difference_test("walls white bear", &direction);
+  }
+
+  Minimize min(&f);
+  min.set_relative_precision(0);
+  min.set_precision(1e-12);
+  min.set_maxiter(500);
+  min.precondition(true);
+  while (min.improve_energy(quiet)) {}
+  min.print_info();
+
+  // The Carnahan-Starling pressure, which is that of the White Bear
+  // functional.
+  const double pressure = nb*kT*(1 + eta + eta*eta - eta*eta*eta)/pow(1 - eta, 3);
+  const Vector n = f.get_n();
+  double contact = 0;
+  for (long i=0; i<Nz; i++) contact = fmax(contact, n[i]);
+  printf("contact density %g, pressure/kT %g, bulk density %g\n", contact, pressure/kT, nb);
+  printf("density at the midplane is %g\n", n[Nz-1]);
+  if (!(fabs(contact/(pressure/kT) - 1) < 0.05)) {
+    printf("FAIL: the contact density isn't the pressure over kT\n");
+    errorcode++;
+  }
+  if (!(fabs(n[Nz-1] - nb) < 1e-3*nb)) {
+    printf("FAIL: the density doesn't return to its bulk value\n");
+    errorcode++;
+  }
+
+  if (errorcode == 0) printf("%s passes!\n", argv[0]);
+  return errorcode;
+}